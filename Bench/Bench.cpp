@@ -0,0 +1,396 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Micro-benchmarks for the parser's hot paths.
+// Every benchmark runs on a synthetic PNG built from a fixed seed,
+// so numbers are comparable between runs and machines.
+//
+// Each benchmark is warmed up, then timed over several repetitions.
+// Results are printed as one JSON object per line:
+//   {"name":..., "reps":..., "iters":..., "ns_per_op":..., "ns_per_op_min":..., "bytes_per_sec":...}
+// where ns_per_op is the median over all repetitions.
+//
+// Inflate and decode are also run over every PNG under a directory
+// written by see_png_gencorpus, when one is passed with --corpus.
+//
+// Usage: see_png_bench [--reps N] [--min-ms N] [--corpus DIR] [name-filter]
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include <Carrier.hpp>
+#include <Chunks.hpp>
+#include <Crc.hpp>
+#include <PngWriter.hpp>
+#include <FlatBuffer.hpp>
+#include <Inflate.hpp>
+#include <Decode.hpp>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <print>
+
+#if defined(SEE_PNG_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace spng;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+  // Where results go. Separate from stdout, since some of the
+  // benchmarked functions (hexdump) print to the console.
+  FILE* results = stdout;
+
+  struct Options {
+    size_t reps       = 15;
+    size_t min_ms     = 20;   // Minimum duration of a single repetition.
+    std::string filter;
+    std::string corpus;   // see_png_gencorpus output, optional.
+  };
+
+  // Keeps the compiler from optimizing away
+  // results that are never otherwise used.
+  template<typename T>
+  SPNG_FORCEINLINE auto keep(const T& val) -> void {
+#if defined(__clang__) || defined(__GNUC__)
+    asm volatile("" : : "g"(&val) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &val;
+#endif
+  }
+
+  // Small deterministic PRNG (xorshift64*),
+  // so inputs are identical on every run.
+  struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    auto next() -> uint64_t {
+      state ^= state >> 12;
+      state ^= state << 25;
+      state ^= state >> 27;
+      return state * 0x2545F4914F6CDD1DULL;
+    }
+  };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A structurally valid PNG: IHDR, num_text tEXt chunks,
+// num_idat IDAT chunks of idat_size random bytes, IEND.
+// The IDAT contents aren't a real zlib stream, which
+// doesn't matter to anything measured here.
+static auto make_png(const size_t num_text, const size_t num_idat, const size_t idat_size) -> FlatBuffer::Buffer {
+  Rng rng;
+  PngWriter png;
+  png.ihdr(1024, 1024, 8, Ihdr::ColorType::TruecolorAlpha);
+
+  for(size_t i = 0; i < num_text; i++) {
+    const auto text = std::format("Comment{}", i);
+    FlatBuffer::Buffer data(text.begin(), text.end());
+    data.emplace_back(0);
+    for(size_t j = 0; j < 48; j++) {
+      data.emplace_back(static_cast<uint8_t>('a' + rng.next() % 26));
+    }
+    png.chunk("tEXt", data);
+  }
+
+  for(size_t i = 0; i < num_idat; i++) {
+    FlatBuffer::Buffer data(idat_size);
+    for(auto& byte : data) byte = static_cast<uint8_t>(rng.next());
+    png.chunk("IDAT", data);
+  }
+
+  png.iend();
+  return png.take();
+}
+
+// An RGBA8 image written the way see_png_gencorpus writes its
+// files: filter type 0 scanlines in a stored zlib stream.
+static auto make_image(const uint32_t width, const uint32_t height) -> FlatBuffer::Buffer {
+  FlatBuffer::Buffer raw;
+  raw.reserve(static_cast<size_t>(height) * (width * 4 + 1));
+  for(uint32_t y = 0; y < height; y++) {
+    raw.emplace_back(0);
+    for(uint32_t x = 0; x < width; x++) {
+      raw.emplace_back(static_cast<uint8_t>(x));
+      raw.emplace_back(static_cast<uint8_t>(y));
+      raw.emplace_back(static_cast<uint8_t>(x + y));
+      raw.emplace_back(0xFF);
+    }
+  }
+
+  PngWriter png;
+  png.ihdr(width, height, 8, Ihdr::ColorType::TruecolorAlpha);
+  png.chunk("IDAT", zlib_store(raw));
+  png.iend();
+  return png.take();
+}
+
+// The IDAT payloads of a PNG, in file order.
+static auto idat_parts(const Carrier& carrier) -> std::vector<std::span<const uint8_t>> {
+  std::vector<std::span<const uint8_t>> parts;
+  for(const auto& chunk : carrier.chunks()) {
+    if(chunk.type() == Chunk::Type::IDAT) {
+      parts.emplace_back(carrier.payload(chunk));
+    }
+  }
+
+  return parts;
+}
+
+static auto inflate_idat(const std::span<const std::span<const uint8_t>> parts) -> size_t {
+  Inflater inflater;
+  return inflater.run(parts, [](const std::span<const uint8_t> out) { keep(out.size()); });
+}
+
+static auto decode_rgba8(const Carrier& carrier) -> void {
+  Decoder decoder(carrier, Decoder::Format::Rgba8);
+  decoder.decode_rows([](const uint32_t, const std::span<const uint8_t> row) { keep(row.size()); });
+}
+
+// A corpus loaded into memory, so file I/O isn't timed.
+struct Corpus {
+  std::vector<std::unique_ptr<Carrier>> files;
+  std::vector<std::vector<std::span<const uint8_t>>> idat;
+  size_t inflated = 0;  // Total inflated IDAT size.
+  size_t decoded  = 0;  // Total RGBA8 output size.
+};
+
+// Every PNG under dir, in path order. Files that don't decode,
+// e.g. those corrupted with --corrupt-pct, are skipped.
+static auto load_corpus(const std::string& dir) -> Corpus {
+  std::vector<std::filesystem::path> paths;
+  for(const auto& entry : std::filesystem::recursive_directory_iterator(dir)) {
+    if(entry.is_regular_file() && entry.path().extension() == ".png") {
+      paths.emplace_back(entry.path());
+    }
+  }
+  std::ranges::sort(paths);
+
+  Corpus corpus;
+  for(const auto& path : paths) {
+    std::ifstream in(path, std::ios::binary);
+    const FlatBuffer::Buffer data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    try {
+      auto carrier = std::make_unique<Carrier>(data);
+      auto parts   = idat_parts(*carrier);
+      const auto inflated = inflate_idat(parts);
+      decode_rgba8(*carrier);
+
+      const auto ihdr = carrier->metadata();
+      corpus.inflated += inflated;
+      corpus.decoded  += static_cast<size_t>(ihdr.width()) * ihdr.height() * 4;
+      corpus.files.emplace_back(std::move(carrier));
+      corpus.idat.emplace_back(std::move(parts));
+    } catch(const std::exception&) {
+      continue;
+    }
+  }
+
+  return corpus;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Runs "op" in batches until a single batch takes at least
+// opts.min_ms, then times opts.reps such batches.
+// bytes_per_op may be 0 when throughput isn't meaningful.
+static auto run(const Options& opts,
+  const std::string_view name,
+  const size_t bytes_per_op,
+  const std::function<void()>& op
+) -> void {
+  if(!opts.filter.empty() && name.find(opts.filter) == std::string_view::npos) {
+    return;
+  }
+
+  const auto min_ns = static_cast<double>(opts.min_ms) * 1e6;
+  auto time_batch = [&](const size_t iters) -> double {
+    const auto start = Clock::now();
+    for(size_t i = 0; i < iters; i++) op();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  };
+
+  // Warmup doubles as calibration.
+  size_t iters = 1;
+  while(time_batch(iters) < min_ns && iters < (size_t(1) << 40)) {
+    iters *= 2;
+  }
+
+  std::vector<double> per_op;
+  per_op.reserve(opts.reps);
+  for(size_t r = 0; r < opts.reps; r++) {
+    per_op.emplace_back(time_batch(iters) / static_cast<double>(iters));
+  }
+
+  std::ranges::sort(per_op);
+  const double median = per_op.at(per_op.size() / 2);
+  const double bps    = bytes_per_op ? static_cast<double>(bytes_per_op) * 1e9 / median : 0.0;
+
+  std::println(results,
+    R"({{"name":"{}","reps":{},"iters":{},"ns_per_op":{:.2f},"ns_per_op_min":{:.2f},"bytes_per_sec":{:.0f}}})",
+    name, opts.reps, iters, median, per_op.front(), bps);
+  std::fflush(results);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static auto parse_options(const int argc, char** argv) -> Options {
+  Options opts;
+  for(int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if(arg == "--reps" && i + 1 < argc) {
+      opts.reps = std::max<size_t>(1, std::stoul(argv[++i]));
+    } else if(arg == "--min-ms" && i + 1 < argc) {
+      opts.min_ms = std::stoul(argv[++i]);
+    } else if(arg == "--corpus" && i + 1 < argc) {
+      opts.corpus = argv[++i];
+    } else {
+      opts.filter = arg;
+    }
+  }
+
+  return opts;
+}
+
+// Keeps a handle to the real stdout for results, then points
+// stdout at the null device. Returns false if this isn't possible,
+// in which case benchmarks that print are skipped.
+static auto silence_stdout() -> bool {
+#if defined(SEE_PNG_POSIX)
+  std::fflush(stdout);
+  const int saved = ::dup(STDOUT_FILENO);
+  const int null  = ::open("/dev/null", O_WRONLY);
+  if(saved < 0 || null < 0) {
+    return false;
+  }
+
+  results = ::fdopen(saved, "w");
+  ::dup2(null, STDOUT_FILENO);
+  ::close(null);
+  return results != nullptr;
+#else
+  return false;
+#endif
+}
+
+int main(const int argc, char** argv) {
+  const Options opts = parse_options(argc, argv);
+  if(!opts.corpus.empty() && !std::filesystem::is_directory(opts.corpus)) {
+    std::println(stderr, "Corpus directory {} not found.", opts.corpus);
+    return 1;
+  }
+
+  const bool silenced = silence_stdout();
+  if(!silenced) {
+    results = stdout;
+  }
+
+  // Small file with lots of chunks: stresses per-chunk
+  // overhead. Large file with few chunks: stresses throughput.
+  const auto many_chunks = make_png(2000, 16, 256);
+  const auto big_chunks  = make_png(4, 8, 1U << 20);
+  const auto many_bytes  = std::as_bytes(std::span(many_chunks));
+
+  const Carrier owned(many_chunks);
+  const Carrier big(big_chunks);
+  const auto& ihdr   = owned.chunks().front();
+  const auto& text   = owned.chunks().at(1);
+  const auto& idat   = big.chunks().at(5);
+  const Carrier borrowed(many_bytes);
+  const auto& b_ihdr = borrowed.chunks().front();
+
+  run(opts, "chunk.type", 0, [&] {
+    keep(ihdr.type());
+  });
+
+  run(opts, "chunk.type.borrowed", 0, [&] {
+    keep(b_ihdr.type());
+  });
+
+  run(opts, "chunk.length", 0, [&] {
+    keep(ihdr.length());
+  });
+
+  run(opts, "chunk.length.borrowed", 0, [&] {
+    keep(b_ihdr.length());
+  });
+
+  run(opts, "chunk.next", 0, [&] {
+    keep(text.next());
+  });
+
+  run(opts, "chunk.next.walk_all", many_chunks.size(), [&] {
+    auto curr = std::optional<Chunk>(ihdr);
+    size_t count = 0;
+    while(curr.has_value()) {
+      curr = curr->next();
+      ++count;
+    }
+    keep(count);
+  });
+
+  run(opts, "carrier.construct.owned", many_chunks.size(), [&] {
+    const Carrier c(many_chunks);
+    keep(c.chunks().size());
+  });
+
+  run(opts, "carrier.construct.borrowed", many_chunks.size(), [&] {
+    const Carrier c(many_bytes);
+    keep(c.chunks().size());
+  });
+
+  run(opts, "crc32.8MiB", big_chunks.size(), [&] {
+    keep(crc32(big_chunks));
+  });
+
+  run(opts, "chunk.crc_ok.1MiB", idat.length(), [&] {
+    keep(idat.crc_ok());
+  });
+
+  const auto image_file = make_image(1024, 1024);
+  const Carrier image(image_file);
+  const auto image_idat = idat_parts(image);
+  const size_t image_raw = inflate_idat(image_idat);
+
+  run(opts, "inflate.stored.4MiB", image_raw, [&] {
+    keep(inflate_idat(image_idat));
+  });
+
+  run(opts, "decode.rgba8.1024x1024", size_t(1024) * 1024 * 4, [&] {
+    decode_rgba8(image);
+  });
+
+  if(!opts.corpus.empty()) {
+    const auto corpus = load_corpus(opts.corpus);
+    if(corpus.files.empty()) {
+      std::println(stderr, "No decodable PNG files in {}.", opts.corpus);
+      return 1;
+    }
+
+    run(opts, "inflate.corpus", corpus.inflated, [&] {
+      for(const auto& parts : corpus.idat) {
+        keep(inflate_idat(parts));
+      }
+    });
+
+    run(opts, "decode.corpus.rgba8", corpus.decoded, [&] {
+      for(const auto& carrier : corpus.files) {
+        decode_rgba8(*carrier);
+      }
+    });
+  }
+
+  if(silenced) {
+    run(opts, "chunk.hexdump.text", text.length(), [&] {
+      text.hexdump();
+    });
+  }
+
+  return 0;
+}
@@ -3,6 +3,8 @@
 #include <Chunks.hpp>
 #include <FlatBuffer.hpp>
 #include <vector>
+#include <span>
+#include <cstddef>
 
 namespace spng {
   class Carrier;
@@ -20,12 +22,29 @@ public:
   auto print_summary() const -> void;
   [[nodiscard]] auto metadata()  const -> Ihdr;
   [[nodiscard]] auto chunks()    const -> const std::vector<Chunk>&;
+  [[nodiscard]] auto size()      const -> size_t;
+  [[nodiscard]] auto bytes()     const -> std::span<const FlatBuffer::Byte>;
+
+  // The data of one of this Carrier's chunks,
+  // without its header or CRC.
+  [[nodiscard]] auto payload(const Chunk& chunk) const -> std::span<const FlatBuffer::Byte>;
 
   explicit Carrier(const InFileRef& file);
   explicit Carrier(const FlatBuffer::Buffer& file);
+
+  // Takes shared ownership of an already loaded file,
+  // e.g. the result of InFileRef::read(). No copy is made.
+  explicit Carrier(FlatBuffer::Shared file);
+
+  // Borrowing constructor: parses the caller's bytes in place,
+  // without copying them and without any shared/weak pointers.
+  // The bytes MUST stay alive and unmodified for as long as this
+  // Carrier, or any Chunk obtained from it, is in use.
+  explicit Carrier(std::span<const std::byte> file);
 private:
   std::vector<Chunk> chunks_;
-  FlatBuffer::Shared buff_;
+  FlatBuffer::Shared buff_;  // Owned file contents. Null when borrowing.
+  FlatBuffer::View view_;    // The file contents, owned or borrowed.
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -40,4 +59,18 @@ inline auto spng::Carrier::chunks() const
   return chunks_;
 }
 
+inline auto spng::Carrier::size() const -> size_t {
+  return view_.size();
+}
+
+inline auto spng::Carrier::bytes() const
+-> std::span<const FlatBuffer::Byte> {
+  return { view_.data(), view_.size() };
+}
+
+inline auto spng::Carrier::payload(const Chunk& chunk) const
+-> std::span<const FlatBuffer::Byte> {
+  return bytes().subspan(chunk.offset_ + sizeof(Chunk::Header), chunk.length());
+}
+
 #endif //CARRIER_HPP
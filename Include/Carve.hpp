@@ -0,0 +1,32 @@
+#ifndef CARVE_HPP
+#define CARVE_HPP
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace spng::Carve {
+  // One complete PNG found inside a larger blob.
+  struct Extent {
+    size_t   offset = 0;  // Of the signature, from the start of the blob.
+    size_t   size   = 0;  // Up to and including IEND's CRC.
+    size_t   chunks = 0;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+  };
+
+  struct Result {
+    std::vector<Extent> found;
+    size_t rejected = 0;  // Signatures not followed by a complete PNG.
+  };
+
+  // Searches any blob (disk image, archive, memory dump...)
+  // for PNG signatures, 16 bytes at a time where SSE2 is
+  // available, and walks the chunks after each one with a
+  // borrowing Carrier, in place, to find where that image
+  // ends. The search resumes after the end of each image
+  // found, so PNGs nested inside another are not reported.
+  auto scan(std::span<const uint8_t> blob) -> Result;
+}
+
+#endif //CARVE_HPP
@@ -0,0 +1,15 @@
+#ifndef CENSUS_HPP
+#define CENSUS_HPP
+#include <Carrier.hpp>
+
+// Whole-run chunk census for --census: per chunk type counts,
+// payload size distribution, unknown types, and how much of the
+// input is ancillary data. Each thread fills its own hash table;
+// the tables are merged once, when the report is printed.
+
+namespace spng::Census {
+  auto add(const Carrier& carrier) -> void;
+  auto print_report() -> void;
+}
+
+#endif //CENSUS_HPP
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A compact, columnar binary format for persisting the
+// chunk layout of many PNG files at once. Everything is
+// fixed-width and little-endian, so a reader can map the
+// file and index straight into the column arrays without
+// parsing anything.
+//
+// Layout (all sections are 8 byte aligned):
+//   Header                      (see ChunkIndex::Header)
+//   FileRecord[num_files]       one per indexed PNG
+//   uint32_t fourcc[num_chunks] chunk type read as big-endian, IHDR = 0x49484452
+//   uint64_t offset[num_chunks] offset of the chunk header
+//   uint32_t length[num_chunks] length of the chunk data
+//   uint32_t crc[num_chunks]    stored CRC-32
+//   uint8_t  status[num_chunks] ChunkIndex::Status bits
+//   char     strings[]          file paths, not null terminated
+//
+// The chunks of file N live at [first_chunk, first_chunk + chunk_count)
+// in every column.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef CHUNKINDEX_HPP
+#define CHUNKINDEX_HPP
+#include <Carrier.hpp>
+#include <MappedFile.hpp>
+#include <CompileAttrs.hpp>
+#include <Endian.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <mutex>
+#include <cstring>
+
+namespace spng::ChunkIndex {
+  PACKED_STRUCT(Header, {
+    char magic[8];            // "SPNGIDX\0"
+    uint32_t version;         // Format version, currently 1.
+    uint32_t reserved;        // Always 0.
+    uint64_t num_files;       // Number of FileRecords.
+    uint64_t num_chunks;      // Number of entries in each column.
+    uint64_t files_offset;    // Offset to the FileRecord array.
+    uint64_t fourcc_offset;   // Offset to the fourcc column.
+    uint64_t offset_offset;   // Offset to the chunk offset column.
+    uint64_t length_offset;   // Offset to the length column.
+    uint64_t crc_offset;      // Offset to the CRC column.
+    uint64_t status_offset;   // Offset to the status column.
+    uint64_t strings_offset;  // Offset to the string table.
+    uint64_t strings_size;    // Size of the string table in bytes.
+  });
+
+  PACKED_STRUCT(FileRecord, {
+    uint64_t path_offset;     // Offset of the path inside the string table.
+    uint32_t path_length;     // Length of the path in bytes.
+    uint32_t chunk_count;     // Number of chunks belonging to this file.
+    uint64_t first_chunk;     // Index of the file's first chunk in each column.
+    uint64_t file_size;       // Size of the PNG file in bytes.
+  });
+
+  enum Status : uint8_t {
+    None     = 0U,
+    CrcOk    = 1U,            // The stored CRC matches the chunk contents.
+    Known    = 1U << 1,       // The chunk type is in SEE_PNG_CHUNK_LIST.
+    Critical = 1U << 2,       // The chunk type is critical (uppercase first letter).
+  };
+
+  // Read-only description of a single indexed file.
+  struct File {
+    std::string_view path;
+    uint64_t first_chunk = 0;
+    uint32_t chunk_count = 0;
+    uint64_t file_size   = 0;
+  };
+
+  constexpr char     magic[8] = { 'S', 'P', 'N', 'G', 'I', 'D', 'X', '\0' };
+  constexpr uint32_t version  = 1;
+
+  class Writer;
+  class Reader;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Accumulates chunk layouts in memory and
+// serializes them with write(). add() may be
+// called from several threads at once.
+class spng::ChunkIndex::Writer {
+public:
+  auto add(const std::string& path, const Carrier& carrier) -> void;
+  auto write(const std::string& out_path) const -> void;
+
+  [[nodiscard]] auto num_files()  const -> size_t;
+  [[nodiscard]] auto num_chunks() const -> size_t;
+private:
+  mutable std::mutex lock_;
+  std::vector<FileRecord> files_;
+  std::vector<uint32_t> fourcc_;
+  std::vector<uint64_t> offset_;
+  std::vector<uint32_t> length_;
+  std::vector<uint32_t> crc_;
+  std::vector<uint8_t>  status_;
+  std::string strings_;
+};
+
+// Maps an index file written by Writer and exposes
+// the columns directly. No per-file or per-chunk
+// parsing happens after the header has been validated.
+class spng::ChunkIndex::Reader {
+public:
+  [[nodiscard]] auto num_files()  const -> uint64_t;
+  [[nodiscard]] auto num_chunks() const -> uint64_t;
+  [[nodiscard]] auto file(uint64_t i) const -> File;
+
+  // Per-chunk column accessors. "i" is a
+  // global chunk index, see File::first_chunk.
+  [[nodiscard]] auto fourcc(uint64_t i)      const -> uint32_t;
+  [[nodiscard]] auto type_string(uint64_t i) const -> std::string;
+  [[nodiscard]] auto offset(uint64_t i)      const -> uint64_t;
+  [[nodiscard]] auto length(uint64_t i)      const -> uint32_t;
+  [[nodiscard]] auto crc(uint64_t i)         const -> uint32_t;
+  [[nodiscard]] auto status(uint64_t i)      const -> uint8_t;
+
+  explicit Reader(const std::string& in_path);
+private:
+  template<typename T>
+  [[nodiscard]] auto _column(uint64_t col_offset, uint64_t i) const -> T;
+
+  MappedFile map_;
+  Header header_ = {};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+auto spng::ChunkIndex::Reader::_column(const uint64_t col_offset, const uint64_t i) const -> T {
+  if(i >= header_.num_chunks) {
+    throw std::out_of_range("Chunk index out of range.");
+  }
+
+  // memcpy instead of a pointer cast, the mapping
+  // is only guaranteed to be aligned for the columns
+  // if the writer padded them correctly.
+  T val;
+  std::memcpy(&val, map_.bytes().data() + col_offset + i * sizeof(T), sizeof(T));
+  return maybe_bitswap(val, Endian::Little);
+}
+
+inline auto spng::ChunkIndex::Reader::num_files() const -> uint64_t {
+  return header_.num_files;
+}
+
+inline auto spng::ChunkIndex::Reader::num_chunks() const -> uint64_t {
+  return header_.num_chunks;
+}
+
+inline auto spng::ChunkIndex::Reader::fourcc(const uint64_t i) const -> uint32_t {
+  return _column<uint32_t>(header_.fourcc_offset, i);
+}
+
+inline auto spng::ChunkIndex::Reader::offset(const uint64_t i) const -> uint64_t {
+  return _column<uint64_t>(header_.offset_offset, i);
+}
+
+inline auto spng::ChunkIndex::Reader::length(const uint64_t i) const -> uint32_t {
+  return _column<uint32_t>(header_.length_offset, i);
+}
+
+inline auto spng::ChunkIndex::Reader::crc(const uint64_t i) const -> uint32_t {
+  return _column<uint32_t>(header_.crc_offset, i);
+}
+
+inline auto spng::ChunkIndex::Reader::status(const uint64_t i) const -> uint8_t {
+  return _column<uint8_t>(header_.status_offset, i);
+}
+
+#endif //CHUNKINDEX_HPP
@@ -17,6 +17,9 @@
 #include <optional>
 #include <filesystem>
 #include <array>
+#include <vector>
+#include <string>
+#include <span>
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #define SEE_PNG_CHUNK_LIST        \
@@ -52,10 +55,12 @@ namespace spng {
   class Gama;
   class Plte;
   class Hist;
+  class Trns;
   class Time;
   class Splt;
   class Text;
   class Itxt;
+  class Iccp;
 }
 
 namespace spng {
@@ -67,6 +72,7 @@ namespace spng {
 
 class spng::Chunk {
 protected:
+  [[nodiscard]] auto _lock() const -> FlatBuffer::Pin;
   auto _throw_bad_chunk() const -> void;
   auto _default_print_impl() const -> void;
 public:
@@ -97,7 +103,13 @@ public:
   [[nodiscard]] auto length()      const -> uint32_t;
   [[nodiscard]] auto checksum()    const -> uint32_t;
 
+  // CRC-32 recomputed over the chunk type and data,
+  // and whether it matches the stored checksum().
+  [[nodiscard]] auto computed_checksum() const -> uint32_t;
+  [[nodiscard]] auto crc_ok()            const -> bool;
+
   FlatBuffer::Weak buff_; // weak pointer to the file buff
+  FlatBuffer::View view_; // borrowed bytes, only set for borrowing Carriers.
   size_t offset_ = 0;     // offset to the start of the chunk header.
 
   virtual ~Chunk() = default;
@@ -165,6 +177,7 @@ public:
   });
 
   [[nodiscard]] auto num_entries() const -> size_t;
+  [[nodiscard]] auto entries()     const -> std::vector<Entry>;
   auto print() const -> void override;
 
   ~Plte() override = default;
@@ -230,21 +243,77 @@ public:
     : Chunk(buff) {}
 };
 
+// Embedded ICC profile: a name, then the profile
+// itself, zlib compressed. Only the 128 byte profile
+// header is parsed, the tag table is left alone.
+class spng::Iccp final : public Chunk {
+public:
+  struct Profile {
+    uint32_t size = 0;                 // As declared by the header.
+    bool size_ok  = true;              // False if that isn't the decompressed size.
+    std::string cmm;                   // Preferred CMM type, e.g. "lcms".
+    uint8_t version_major = 0;
+    uint8_t version_minor = 0;
+    std::string device_class;          // e.g. "mntr", "prtr", "spac".
+    std::string color_space;           // e.g. "RGB ", "GRAY", "CMYK".
+    std::string pcs;                   // Profile connection space, "XYZ " or "Lab ".
+    std::array<uint8_t, 16> id{};      // MD5 profile ID, all zero if not computed.
+  };
+
+  auto print()                            const -> void override;
+  [[nodiscard]] auto name()               const -> std::string;
+  [[nodiscard]] auto profile_data()       const -> FlatBuffer::Buffer;
+  [[nodiscard]] auto profile()            const -> Profile;
+
+  // Offset of the compressed profile within the chunk data.
+  [[nodiscard]] auto compressed_offset()  const -> size_t;
+
+  // Parses the header of an uncompressed profile.
+  // Throws std::runtime_error if it isn't one. A
+  // wrong declared size is only noted in size_ok.
+  static auto parse_profile(std::span<const uint8_t> data) -> Profile;
+
+  ~Iccp() override = default;
+  explicit Iccp(const FlatBuffer::Shared& buff)
+    : Chunk(buff) {}
+};
+
 class spng::Splt final : public Chunk {
 public:
+  // The whole chunk, decoded in one pass. Entries are
+  // stored as a structure of arrays, one vector per
+  // field, widened to 16 bits whatever the sample depth.
+  struct Table {
+    std::string name;
+    uint8_t sample_depth = 0;
+    std::vector<uint16_t> red;
+    std::vector<uint16_t> green;
+    std::vector<uint16_t> blue;
+    std::vector<uint16_t> alpha;
+    std::vector<uint16_t> frequency;
+
+    [[nodiscard]] auto size() const -> size_t { return frequency.size(); }
+  };
+
   auto print()                       const -> void override;
   [[nodiscard]] auto sample_depth()  const -> uint8_t;
   [[nodiscard]] auto name()          const -> std::string;
   [[nodiscard]] auto num_entries()   const -> size_t;
+  [[nodiscard]] auto entries()       const -> Table;
 
   ~Splt() override = default;
   explicit Splt(const FlatBuffer::Shared& buff)
     : Chunk(buff) {}
+private:
+  // Validates the name, sample depth and entry size in
+  // one scan of the payload, returning the name length.
+  auto _layout(const FlatBuffer::View& view, uint8_t& depth, size_t& count) const -> size_t;
 };
 
 class spng::Hist final : public Chunk {
 public:
   [[nodiscard]] auto num_entries() const -> size_t;
+  [[nodiscard]] auto frequencies() const -> std::vector<uint16_t>;
   auto print() const -> void override;
 
   ~Hist() override = default;
@@ -252,6 +321,23 @@ public:
     : Chunk(buff) {}
 };
 
+// Transparency. For indexed images it holds one alpha
+// value per palette entry (possibly fewer, the rest are
+// opaque). For gray and truecolor images it holds the one
+// colour that is fully transparent, as 16-bit samples.
+// Which one applies depends on IHDR, not the chunk itself.
+class spng::Trns final : public Chunk {
+public:
+  auto print() const -> void override;
+  [[nodiscard]] auto palette_alpha() const -> std::vector<uint8_t>;
+  [[nodiscard]] auto gray_key()      const -> uint16_t;
+  [[nodiscard]] auto rgb_key()       const -> std::array<uint16_t, 3>;
+
+  ~Trns() override = default;
+  explicit Trns(const FlatBuffer::Shared& buff)
+    : Chunk(buff) {}
+};
+
 class spng::Chrm final : public Chunk {
 public:
   PACKED_STRUCT(Layout, {
@@ -347,12 +433,13 @@ public:
 
 template<class T> requires spng::IsChunk<T>
 auto spng::Chunk::as() const -> T {
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   if(ptr == nullptr) {
     throw std::runtime_error("Invalid file buffer.");
   }
 
-  T new_chunk(ptr);
+  T new_chunk(ptr.owner());
+  new_chunk.view_   = this->view_;
   new_chunk.offset_ = this->offset_;
   return new_chunk;
 }
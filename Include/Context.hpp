@@ -11,17 +11,40 @@ namespace spng {
 
 class spng::Context {
 public:
-  enum Flags : uint8_t {
+  enum Flags : uint16_t {
     None     = 0U,
     Verbose  = 1U,
     Silent   = 1U << 1,
     NoSumm   = 1U << 2,
+    CrcCheck = 1U << 3,
+    Stats    = 1U << 4,
+    PerfCtrs = 1U << 5,
+    Census   = 1U << 6,
+    InPlace  = 1U << 7,
+    PixStats = 1U << 8,
+    Hash     = 1U << 9,
+    Palette  = 1U << 10,
+    Profiles = 1U << 11,
+    Carve    = 1U << 12,
+    CarveOut = 1U << 13,
   };
 
   std::vector<std::string> ifilenames_;
   std::vector<std::string> extract_chunks_;
   std::vector<std::string> dump_chunks_;
-  uint8_t flags_ = None;
+  std::vector<std::string> strip_chunks_;
+  std::string export_index_;
+  std::string trace_path_;
+  std::string raw_format_;
+  std::string grep_;        // --grep pattern, TEXT or KEYWORD=TEXT.
+  std::string text_index_;  // Text index to build or update, or to query.
+  std::string query_;       // --query pattern, same syntax as --grep.
+  std::string where_;       // --where expression, see Predicate.
+  std::string serve_;       // Unix socket path to serve requests on.
+  std::string watch_;       // Directory to watch for new files.
+  uint16_t flags_ = None;
+  uint32_t jobs_ = 1;       // Worker threads, 0 means one per hardware thread.
+  uint32_t idat_size_ = 0;  // Size to rechunk IDAT data into, 0 to leave as is.
 
   [[nodiscard]] SPNG_NOINLINE
   static auto get() -> Context&;
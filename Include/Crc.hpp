@@ -0,0 +1,23 @@
+#ifndef CRC_HPP
+#define CRC_HPP
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+namespace spng {
+  // Computes the CRC-32 (ISO 3309, as used by PNG) of the given bytes.
+  // Pass the result of a previous call as "crc" to continue a running
+  // checksum over several non-contiguous ranges.
+  auto crc32(std::span<const uint8_t> bytes, uint32_t crc = 0) -> uint32_t;
+
+  // Computes the Adler-32 checksum used by zlib streams.
+  // Like crc32(), "adler" continues a previous checksum.
+  auto adler32(std::span<const uint8_t> bytes, uint32_t adler = 1) -> uint32_t;
+
+  // Given the Adler-32 of two consecutive ranges (each started
+  // from 1) and the length of the second, returns the Adler-32
+  // of both together. Lets ranges be checksummed in parallel.
+  auto adler32_combine(uint32_t first, uint32_t second, size_t second_len) -> uint32_t;
+}
+
+#endif //CRC_HPP
@@ -0,0 +1,173 @@
+#ifndef DECODE_HPP
+#define DECODE_HPP
+#include <Carrier.hpp>
+#include <Chunks.hpp>
+#include <FlatBuffer.hpp>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <span>
+#include <array>
+#include <cstdint>
+
+namespace spng {
+  class Decoder;
+
+  // Reverses one of the five PNG scanline filters in place.
+  // prev is the previous unfiltered row of the same pass, or
+  // all zeroes for the first one. bpp is the number of bytes
+  // per complete pixel, rounded up to 1.
+  auto unfilter_row(uint8_t filter,
+    std::span<uint8_t> row,
+    std::span<const uint8_t> prev,
+    size_t bpp) -> void;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Decodes the image data of a parsed PNG into raw pixels.
+// Rows are produced one at a time while the IDAT stream is
+// inflated, so for non-interlaced images memory use is a few
+// rows, no matter how large the image is. Adam7 images can't
+// be streamed that way (the last pass fills in every other row),
+// so they are decoded into a full-size buffer first.
+// Every valid colour type / bit depth combination is supported,
+// including palette expansion with PLTE and tRNS.
+// Corrupt image data throws std::runtime_error.
+class spng::Decoder {
+public:
+  enum class Format : uint8_t {
+    Rgba8,   // 4 bytes per pixel.
+    Rgba16,  // 4 uint16_t per pixel, in host byte order.
+    Native,  // Unfiltered samples exactly as stored: packed, 16-bit big-endian.
+  };
+
+  using RowSink = std::function<void(uint32_t y, std::span<const uint8_t> row)>;
+
+  // Passes every output row to sink, from top to bottom.
+  auto decode_rows(const RowSink& sink) -> void;
+
+  // Decodes the whole image, row_bytes() * height() bytes.
+  [[nodiscard]] auto decode() -> FlatBuffer::Buffer;
+
+  [[nodiscard]] auto width()      const -> uint32_t;
+  [[nodiscard]] auto height()     const -> uint32_t;
+  [[nodiscard]] auto bit_depth()  const -> uint8_t;
+  [[nodiscard]] auto color_type() const -> Ihdr::ColorType;
+  [[nodiscard]] auto channels()   const -> uint8_t;
+  [[nodiscard]] auto interlaced() const -> bool;
+  [[nodiscard]] auto format()     const -> Format;
+  [[nodiscard]] auto row_bytes()  const -> size_t;
+
+  // Lets decode_rows() inflate on up to this many threads.
+  // That's only possible when the encoder left full-flush
+  // points in the stream: the pieces between them are
+  // inflated in parallel and verified (no references
+  // across pieces, combined Adler-32), then unfiltered
+  // in order. Otherwise, or if any check fails, it falls
+  // back to one serial pass. Parallel decoding holds the
+  // whole inflated image in memory, so images that would
+  // inflate to more than max_buffered bytes always take
+  // the serial, streaming pass.
+  auto set_threads(unsigned threads, size_t max_buffered = default_max_buffered) -> void;
+
+  static constexpr size_t default_max_buffered = size_t(64) << 20;
+
+  // Possible flush points (00 00 FF FF) found in the
+  // image data by the last decode, and how many pieces
+  // it was inflated in. 0 pieces means it ran serially.
+  // The data is only searched when a parallel decode
+  // could happen, otherwise there's no count.
+  [[nodiscard]] auto restart_points()    const -> std::optional<size_t>;
+  [[nodiscard]] auto parallel_segments() const -> size_t;
+
+  static auto format_from_string(std::string_view name) -> std::optional<Format>;
+  static auto format_name(Format format) -> std::string_view;
+
+  Decoder(const Carrier& carrier, Format format);
+private:
+  auto _inflate_parallel(std::span<const std::span<const uint8_t>> parts, size_t max_output) -> bool;
+  auto _feed(std::span<const uint8_t> data) -> void;
+  auto _next_pass() -> void;
+  auto _row_done() -> void;
+  auto _convert(std::span<const uint8_t> src, uint32_t count, uint8_t* dst) const -> void;
+
+  const Carrier& carrier_;
+  Format format_;
+  uint32_t width_  = 0;
+  uint32_t height_ = 0;
+  uint8_t depth_   = 0;
+  uint8_t chans_   = 0;
+  Ihdr::ColorType color_ = Ihdr::ColorType::GrayScale;
+  bool interlaced_ = false;
+
+  // Palette expanded to RGBA, with tRNS applied.
+  std::array<std::array<uint8_t, 4>, 256> palette_{};
+  size_t palette_size_ = 0;
+
+  // tRNS colour key for gray / truecolor images.
+  std::array<uint16_t, 3> key_{};
+  bool has_key_ = false;
+
+  unsigned threads_       = 1;
+  size_t max_buffered_    = default_max_buffered;
+  std::optional<size_t> restart_points_;
+  size_t segments_        = 0;
+
+  // Decoding state.
+  const RowSink* sink_ = nullptr;
+  size_t pass_       = 0;
+  uint32_t pass_w_   = 0;
+  uint32_t pass_h_   = 0;
+  uint32_t pass_y_   = 0;
+  size_t filled_     = 0;  // Bytes of cur_ filled so far.
+  FlatBuffer::Buffer cur_;    // Filter type byte + filtered row.
+  FlatBuffer::Buffer prev_;   // Previous unfiltered row of this pass, same layout as cur_.
+  FlatBuffer::Buffer out_;    // One converted row.
+  FlatBuffer::Buffer image_;  // Whole image, Adam7 only.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::Decoder::width() const -> uint32_t {
+  return width_;
+}
+
+inline auto spng::Decoder::height() const -> uint32_t {
+  return height_;
+}
+
+inline auto spng::Decoder::bit_depth() const -> uint8_t {
+  return depth_;
+}
+
+inline auto spng::Decoder::color_type() const -> Ihdr::ColorType {
+  return color_;
+}
+
+inline auto spng::Decoder::channels() const -> uint8_t {
+  return chans_;
+}
+
+inline auto spng::Decoder::interlaced() const -> bool {
+  return interlaced_;
+}
+
+inline auto spng::Decoder::format() const -> Format {
+  return format_;
+}
+
+inline auto spng::Decoder::set_threads(const unsigned threads, const size_t max_buffered) -> void {
+  threads_      = threads;
+  max_buffered_ = max_buffered;
+}
+
+inline auto spng::Decoder::restart_points() const -> std::optional<size_t> {
+  return restart_points_;
+}
+
+inline auto spng::Decoder::parallel_segments() const -> size_t {
+  return segments_;
+}
+
+#endif //DECODE_HPP
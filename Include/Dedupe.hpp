@@ -0,0 +1,20 @@
+#ifndef DEDUPE_HPP
+#define DEDUPE_HPP
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Duplicate detection for --hash: every file's chunk stream
+// hash and decoded pixel hash are recorded, then grouped by
+// pixel hash once all files are done. Files in a group show
+// the same image; those that also share the chunk hash are
+// byte-for-byte copies, the rest differ only in metadata or
+// compression. Grouping is one hash table pass, no pairwise
+// comparisons.
+
+namespace spng::Dedupe {
+  auto add(const std::string& file, size_t size, uint64_t chunk_hash, uint64_t pixel_hash) -> void;
+  auto print_report() -> void;
+}
+
+#endif //DEDUPE_HPP
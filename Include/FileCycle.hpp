@@ -1,9 +1,38 @@
 #ifndef FILECYCLE_HPP
 #define FILECYCLE_HPP
 #include <string>
+#include <vector>
+#include <span>
+#include <cstddef>
 
 namespace spng {
+  class Carrier;
+
   auto do_file_cycle(const std::string& file) -> bool;
+
+  // Same as do_file_cycle, for a file that's already in memory,
+  // such as a member of a mapped archive. It's parsed in place,
+  // and name is what gets reported.
+  auto do_buffer_cycle(const std::string& name, std::span<const std::byte> bytes) -> bool;
+
+  // Throws std::runtime_error for the first chunk whose CRC-32
+  // doesn't match. Shared with the --serve daemon, so both
+  // check files the same way.
+  auto verify_crcs(const Carrier& carrier) -> void;
+
+  // Runs do_file_cycle over every file, on as many threads
+  // as Context::jobs_ asks for. The .png members of .tar
+  // archives are inspected in place, one job each. Stops
+  // at the first failure, unless a census is being taken
+  // or a directory watched.
+  auto run_file_cycles(const std::vector<std::string>& files) -> bool;
+
+  // Run once after every input has been processed.
+  // Writes any whole-run outputs (e.g. the chunk index).
+  auto finish_file_cycles() -> bool;
+
+  // Answers Context::query_ from the text index alone.
+  auto run_text_query() -> bool;
 }
 
 #endif //FILECYCLE_HPP
@@ -4,6 +4,8 @@
 #include <memory>
 #include <cstdint>
 #include <stdexcept>
+#include <span>
+#include <cstddef>
 
 static_assert(sizeof(uint8_t) == 1);
 namespace spng::FlatBuffer {
@@ -12,11 +14,63 @@ namespace spng::FlatBuffer {
   using Shared = std::shared_ptr<Buffer>;
   using Weak   = std::weak_ptr<Buffer>;
 
+  // Non-owning, bounds checked view over bytes that
+  // belong to someone else (e.g. a caller's network buffer).
+  class View;
+
+  // A view plus, optionally, the Shared buffer it points into.
+  // Holding one keeps an owned buffer alive while it's in use,
+  // and behaves like a pointer to the View.
+  class Pin;
+
   // Factories and such
   inline auto make_shared(size_t size) -> Shared;
   inline auto make_weak(const Shared &shared) -> Weak;
+  inline auto make_view(std::span<const std::byte> bytes) -> View;
 }
 
+class spng::FlatBuffer::View {
+public:
+  [[nodiscard]] auto at(const size_t i) const -> const Byte& {
+    if(i >= size_) {
+      throw std::out_of_range("FlatBuffer::View index out of range.");
+    }
+    return data_[i];
+  }
+
+  [[nodiscard]] auto data()  const -> const Byte* { return data_; }
+  [[nodiscard]] auto size()  const -> size_t      { return size_; }
+  [[nodiscard]] auto empty() const -> bool        { return size_ == 0; }
+
+  View() = default;
+  View(const Byte* data, const size_t size)
+    : data_(data), size_(size) {}
+  explicit View(const Buffer& buff)
+    : data_(buff.data()), size_(buff.size()) {}
+private:
+  const Byte* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+class spng::FlatBuffer::Pin {
+public:
+  [[nodiscard]] auto owner() const -> const Shared& { return owner_; }
+  auto operator->() const -> const View* { return &view_; }
+  auto operator*()  const -> const View& { return view_; }
+
+  explicit operator bool() const { return view_.data() != nullptr; }
+  auto operator==(std::nullptr_t) const -> bool { return view_.data() == nullptr; }
+
+  Pin() = default;
+  explicit Pin(const View& view)
+    : view_(view) {}
+  explicit Pin(Shared owner)
+    : owner_(std::move(owner)), view_(*owner_) {}
+private:
+  Shared owner_;
+  View view_;
+};
+
 namespace fb = spng::FlatBuffer;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -37,4 +91,8 @@ inline auto fb::make_weak(const Shared &shared) -> Weak {
   return { shared };
 }
 
+inline auto fb::make_view(const std::span<const std::byte> bytes) -> View {
+  return { reinterpret_cast<const Byte*>(bytes.data()), bytes.size() };
+}
+
 #endif //FLATBUFFER_HPP
@@ -0,0 +1,36 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+#include <span>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace spng {
+  class Xxh64;
+
+  // Computes the 64-bit xxHash (XXH64) of the given bytes.
+  // Fast, non-cryptographic: fine for spotting duplicates,
+  // not for anything an attacker controls.
+  auto xxh64(std::span<const uint8_t> bytes, uint64_t seed = 0) -> uint64_t;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Streaming XXH64, for input that arrives in pieces
+// (e.g. decoded rows). Gives the same result as xxh64()
+// over the concatenation of everything passed to update().
+class spng::Xxh64 {
+public:
+  auto update(std::span<const uint8_t> bytes) -> void;
+  [[nodiscard]] auto digest() const -> uint64_t;
+
+  explicit Xxh64(uint64_t seed = 0);
+private:
+  uint64_t seed_;
+  std::array<uint64_t, 4> acc_{};
+  std::array<uint8_t, 32> buf_{};
+  size_t buffered_ = 0;
+  uint64_t total_  = 0;
+};
+
+#endif //HASH_HPP
@@ -6,7 +6,6 @@
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-namespace fs = std::filesystem;
 namespace spng {
   class InFileRef;
 }
@@ -20,7 +19,7 @@ public:
   [[nodiscard]] auto name() const -> std::string;
   explicit InFileRef(const std::string &file_name);
 private:
-  fs::path path_;
+  std::filesystem::path path_;
 };
 
 #endif //INFILEREF_HPP
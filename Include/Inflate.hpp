@@ -0,0 +1,106 @@
+#ifndef INFLATE_HPP
+#define INFLATE_HPP
+#include <FlatBuffer.hpp>
+#include <functional>
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace spng {
+  class Inflater;
+
+  // Decompresses a whole zlib stream held in memory,
+  // e.g. the contents of a zTXt or iCCP chunk.
+  auto inflate_zlib(std::span<const uint8_t> in, size_t max_output = 0) -> FlatBuffer::Buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Streaming DEFLATE (RFC 1951) decoder, with the zlib (RFC 1950)
+// header and Adler-32 trailer checked by default. The input may be
+// split over any number of ranges (e.g. consecutive IDAT chunks),
+// and output is handed to the sink in pieces as it's produced, so
+// only the 32 KiB window plus a small buffer is ever held here.
+// Huffman codes are decoded with a 9-bit lookup table, falling back
+// to a canonical code search for longer codes.
+// Corrupt or truncated streams throw std::runtime_error.
+class spng::Inflater {
+public:
+  using Sink = std::function<void(std::span<const uint8_t>)>;
+
+  // Decompresses the stream formed by concatenating parts.
+  // More than max_output bytes of output is treated as
+  // corruption, 0 means no limit. Returns the output size.
+  auto run(std::span<const std::span<const uint8_t>> parts, const Sink& sink) -> size_t;
+
+  // Decodes one piece of a raw DEFLATE stream that was cut at a
+  // flush point: it has to end exactly after an empty stored block,
+  // and may not contain the final block. Back references may not
+  // reach before the start of the piece, which holds for pieces
+  // starting right after a full flush. Throws std::runtime_error
+  // if any of this isn't true. Returns the output size.
+  auto run_segment(std::span<const std::span<const uint8_t>> parts, const Sink& sink) -> size_t;
+
+  // Input bytes used by the last run(), including the zlib header
+  // and trailer. Anything after that wasn't part of the stream.
+  [[nodiscard]] auto consumed() const -> size_t;
+
+  explicit Inflater(bool zlib = true, size_t max_output = 0);
+private:
+  struct Huffman {
+    static constexpr int fast_bits = 9;
+    std::array<uint16_t, 1 << fast_bits> fast{};  // (length << 9) | symbol, 0 if not in the table.
+    std::array<uint16_t, 16> first_code{};
+    std::array<uint16_t, 16> first_symbol{};
+    std::array<int32_t, 17> max_code{};
+    std::array<uint8_t, 288> size{};
+    std::array<uint16_t, 288> value{};
+
+    auto build(std::span<const uint8_t> lengths) -> void;
+  };
+
+  auto _start(std::span<const std::span<const uint8_t>> parts, const Sink& sink) -> void;
+  auto _block(bool& final) -> void;
+  auto _refill() -> void;
+  auto _bits(int count) -> uint32_t;
+  auto _decode(const Huffman& huff) -> uint32_t;
+  auto _stored_block() -> void;
+  auto _dynamic_tables() -> void;
+  auto _huffman_block(const Huffman& lit, const Huffman& dist) -> void;
+  auto _reserve(size_t count) -> void;
+  auto _flush() -> void;
+
+  bool zlib_;
+  size_t max_output_;
+
+  // Input: the parts, and a bit buffer filled LSB first.
+  std::span<const std::span<const uint8_t>> parts_;
+  size_t part_     = 0;
+  size_t part_pos_ = 0;
+  uint64_t bitbuf_ = 0;
+  int bitcount_    = 0;
+  size_t padding_  = 0;  // Zero bytes fed in past the end of the input.
+  size_t pulled_   = 0;  // Real input bytes moved into the bit buffer.
+  size_t consumed_ = 0;
+
+  // Output: window_ holds the last 32 KiB already flushed,
+  // followed by whatever has been decoded since.
+  FlatBuffer::Buffer window_;
+  size_t out_pos_   = 0;
+  size_t flushed_   = 0;
+  size_t total_out_ = 0;
+  uint32_t adler_   = 1;
+  const Sink* sink_ = nullptr;
+
+  Huffman lit_;
+  Huffman dist_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::Inflater::consumed() const -> size_t {
+  return consumed_;
+}
+
+#endif //INFLATE_HPP
@@ -0,0 +1,53 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+#include <FlatBuffer.hpp>
+#include <string>
+#include <span>
+#include <cstdint>
+
+namespace spng {
+  class MappedFile;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A read-only view of an entire file. On POSIX systems
+// the file is memory mapped, so nothing is copied until
+// a page is actually touched. Elsewhere we fall back to
+// reading the file into a buffer.
+class spng::MappedFile {
+public:
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] auto bytes() const -> std::span<const FlatBuffer::Byte>;
+  [[nodiscard]] auto size()  const -> size_t;
+  [[nodiscard]] auto name()  const -> const std::string&;
+
+  explicit MappedFile(const std::string& file_name);
+  ~MappedFile();
+private:
+  std::string name_;
+  const FlatBuffer::Byte* data_ = nullptr;
+  size_t size_ = 0;
+#if !defined(SEE_PNG_POSIX)
+  FlatBuffer::Shared fallback_;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::MappedFile::bytes() const
+-> std::span<const FlatBuffer::Byte> {
+  return { data_, size_ };
+}
+
+inline auto spng::MappedFile::size() const -> size_t {
+  return size_;
+}
+
+inline auto spng::MappedFile::name() const -> const std::string& {
+  return name_;
+}
+
+#endif //MAPPEDFILE_HPP
@@ -0,0 +1,62 @@
+#ifndef OUTFILE_HPP
+#define OUTFILE_HPP
+#include <FlatBuffer.hpp>
+#include <string>
+#include <span>
+#include <vector>
+#include <memory>
+#include <iosfwd>
+#include <cstdint>
+
+namespace spng {
+  class OutFile;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A file being written from existing byte ranges. On POSIX
+// systems ranges are queued and handed to writev() in batches,
+// so nothing is copied into an intermediate buffer. Ranges
+// must stay alive until the next flush(), or commit().
+// An atomic OutFile writes to a temporary file next to the
+// target, and only replaces the target on commit(). If the
+// OutFile is destroyed before then, the temporary is removed
+// and the target is left untouched.
+class spng::OutFile {
+public:
+  OutFile(const OutFile&)            = delete;
+  OutFile& operator=(const OutFile&) = delete;
+
+  auto write(std::span<const FlatBuffer::Byte> range) -> OutFile&;
+  auto flush() -> void;
+  auto commit() -> void;
+
+  [[nodiscard]] auto written() const -> size_t;
+  [[nodiscard]] auto name()    const -> const std::string&;
+
+  explicit OutFile(const std::string& file_name, bool atomic = false);
+  ~OutFile();
+private:
+  std::string name_;
+  std::string temp_name_;  // Empty unless atomic.
+  std::vector<std::span<const FlatBuffer::Byte>> pending_;
+  size_t written_ = 0;
+  bool committed_ = false;
+#if defined(SEE_PNG_POSIX)
+  int fd_ = -1;
+#else
+  std::unique_ptr<std::ofstream> stream_;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::OutFile::written() const -> size_t {
+  return written_;
+}
+
+inline auto spng::OutFile::name() const -> const std::string& {
+  return name_;
+}
+
+#endif //OUTFILE_HPP
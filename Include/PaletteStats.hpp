@@ -0,0 +1,69 @@
+#ifndef PALETTESTATS_HPP
+#define PALETTESTATS_HPP
+#include <Carrier.hpp>
+#include <Chunks.hpp>
+#include <span>
+#include <array>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+namespace spng {
+  class PaletteStats;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Palette usage of an indexed image: how many pixels use each
+// PLTE entry, joined with the entry's tRNS alpha and hIST
+// frequency. Shows which entries are unused, duplicated or
+// fully transparent, and how small the palette could get.
+// Fed one Decoder::Format::Native row at a time.
+class spng::PaletteStats {
+public:
+  struct Entry {
+    std::array<uint8_t, 4> rgba{};   // Alpha from tRNS, 255 if it has no value.
+    uint64_t uses = 0;               // Pixels with this index.
+    std::optional<uint16_t> hist;    // From hIST, if there is one.
+    int32_t duplicate_of = -1;       // First entry with the same RGBA, or -1.
+  };
+
+  struct Summary {
+    size_t entries      = 0;  // PLTE size.
+    size_t used         = 0;
+    size_t duplicates   = 0;  // Used entries that repeat an earlier used one.
+    size_t transparent  = 0;  // Entries with alpha 0.
+    size_t distinct     = 0;  // Distinct RGBA values actually used.
+    size_t trns_size    = 0;  // Alpha values stored in tRNS.
+    size_t trns_needed  = 0;  // Needed if non-opaque entries came first.
+    size_t hist_stale   = 0;  // Entries where hIST and usage disagree on zero.
+    uint64_t out_of_range = 0;  // Pixels with an index past the palette.
+    uint8_t depth       = 0;
+    uint8_t min_depth   = 0;  // Smallest index depth that fits the distinct colours.
+    bool has_hist       = false;
+  };
+
+  auto add_row(std::span<const uint8_t> row) -> void;
+
+  [[nodiscard]] auto entries() const -> std::vector<Entry>;
+  [[nodiscard]] auto summary() const -> Summary;
+
+  // The carrier must be an indexed colour image with a PLTE chunk.
+  explicit PaletteStats(const Carrier& carrier);
+private:
+  uint8_t depth_  = 8;
+  uint32_t width_ = 0;
+  std::vector<Plte::Entry> palette_;
+  std::vector<uint8_t> alpha_;
+  std::vector<uint16_t> hist_;
+  bool has_hist_  = false;
+
+  // Counts of whole bytes, split four ways so that runs of
+  // the same value don't serialize on one counter. Below
+  // 8 bits a byte holds several indices, which are only
+  // separated once, in entries().
+  std::array<std::array<uint64_t, 256>, 4> bytes_{};
+  std::array<uint64_t, 256> tail_{};  // Indices from partial trailing bytes.
+};
+
+#endif //PALETTESTATS_HPP
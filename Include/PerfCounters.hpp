@@ -0,0 +1,47 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+#include <CompileAttrs.hpp>
+#include <array>
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+// Hardware performance counters via Linux perf_event_open(),
+// for --perf-counters. Each thread lazily opens its own counter
+// group, counting only that thread in user space. On other
+// platforms, or when the kernel refuses (perf_event_paranoid,
+// containers, VMs without a PMU), enable() fails and the
+// reason is kept for the report.
+
+namespace spng::Perf {
+  enum class Event : uint8_t {
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    Count,
+  };
+
+  using Sample = std::array<uint64_t, size_t(Event::Count)>;
+
+  // Returns false if counters aren't usable at all.
+  auto enable() -> bool;
+
+  // Reads the calling thread's counters (scaled for multiplexing).
+  // Returns false if this thread's counters couldn't be opened.
+  auto read(Sample& out) -> bool;
+
+  // Whether an individual event could be opened. Some PMUs
+  // lack e.g. cache-miss events even when cycles work.
+  auto supported(Event ev) -> bool;
+
+  auto event_name(Event ev) -> const char*;
+  auto unavailable_reason() -> const std::string&;
+
+  inline std::atomic<bool> enabled_ = false;
+  SPNG_FORCEINLINE auto enabled() -> bool {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+}
+
+#endif //PERFCOUNTERS_HPP
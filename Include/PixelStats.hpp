@@ -0,0 +1,91 @@
+#ifndef PIXELSTATS_HPP
+#define PIXELSTATS_HPP
+#include <FlatBuffer.hpp>
+#include <span>
+#include <array>
+#include <vector>
+#include <cstdint>
+
+namespace spng {
+  class PixelStats;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Statistics over decoded pixels, fed one row at a time in
+// Decoder::Format::Rgba8 (or Rgba16 when wide). Answers the
+// questions that matter when re-encoding: is the alpha channel
+// needed, is the image really grayscale, how many bits per
+// sample are actually used, and would it fit in a palette.
+// Opacity and grayscale checks use SSE2 where it's available.
+class spng::PixelStats {
+public:
+  using Histogram = std::array<uint64_t, 256>;
+
+  // Unique colours are counted exactly up to this many.
+  static constexpr size_t max_unique = size_t(1) << 20;
+
+  auto add_row(std::span<const uint8_t> row) -> void;
+
+  // For 16-bit input the histograms are of the high byte.
+  [[nodiscard]] auto histogram(size_t channel) const -> const Histogram&;
+  [[nodiscard]] auto pixels()        const -> uint64_t;
+  [[nodiscard]] auto unique_colors() const -> size_t;  // Stops counting at max_unique.
+  [[nodiscard]] auto unique_capped() const -> bool;    // There were more than max_unique.
+  [[nodiscard]] auto opaque()        const -> bool;    // Alpha is always at its maximum.
+  [[nodiscard]] auto binary_alpha()  const -> bool;    // Alpha is always zero or maximum.
+  [[nodiscard]] auto grayscale()     const -> bool;    // R == G == B everywhere.
+  [[nodiscard]] auto bits_used()     const -> uint8_t; // Smallest of 1/2/4/8/16 that's lossless.
+
+  explicit PixelStats(bool wide = false);
+private:
+  auto _add_unique(uint64_t color) -> void;
+  auto _grow() -> void;
+
+  bool wide_;
+  uint64_t pixels_ = 0;
+  std::array<std::array<Histogram, 2>, 4> hist_{};  // Two per channel, for odd and even pixels.
+  mutable std::array<Histogram, 4> merged_{};
+  mutable bool merged_valid_ = false;
+
+  bool opaque_    = true;
+  bool binary_    = true;
+  bool gray_      = true;
+  bool fits_8bit_ = true;  // 16-bit input only: every sample is a multiple of 257.
+
+  // Open addressing set of colours seen. The all-ones
+  // colour doubles as the empty marker and is tracked
+  // separately.
+  std::vector<uint64_t> colors_;
+  size_t num_colors_  = 0;
+  bool has_all_ones_  = false;
+  bool colors_full_   = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::PixelStats::pixels() const -> uint64_t {
+  return pixels_;
+}
+
+inline auto spng::PixelStats::unique_colors() const -> size_t {
+  return num_colors_ + (has_all_ones_ ? 1 : 0);
+}
+
+inline auto spng::PixelStats::unique_capped() const -> bool {
+  return colors_full_;
+}
+
+inline auto spng::PixelStats::opaque() const -> bool {
+  return opaque_;
+}
+
+inline auto spng::PixelStats::binary_alpha() const -> bool {
+  return binary_;
+}
+
+inline auto spng::PixelStats::grayscale() const -> bool {
+  return gray_;
+}
+
+#endif //PIXELSTATS_HPP
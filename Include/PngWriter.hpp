@@ -0,0 +1,52 @@
+#ifndef PNGWRITER_HPP
+#define PNGWRITER_HPP
+#include <Chunks.hpp>
+#include <FlatBuffer.hpp>
+#include <string_view>
+#include <span>
+#include <cstdint>
+
+namespace spng {
+  class PngWriter;
+
+  // Wraps raw bytes in a zlib stream made of stored
+  // (uncompressed) deflate blocks. The result is valid
+  // for IDAT, zTXt, iCCP etc. but is not any smaller.
+  auto zlib_store(std::span<const uint8_t> raw) -> FlatBuffer::Buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Assembles a PNG file in memory, one chunk at a time.
+// Lengths and CRCs are filled in automatically; no checks
+// are made on chunk order or contents, so this can also
+// be used to produce deliberately broken files.
+class spng::PngWriter {
+public:
+  auto chunk(std::string_view type, std::span<const uint8_t> data) -> PngWriter&;
+  auto ihdr(uint32_t width,
+    uint32_t height,
+    uint8_t bit_depth,
+    Ihdr::ColorType color,
+    Ihdr::Interlace interlace = Ihdr::Interlace::None) -> PngWriter&;
+  auto iend() -> PngWriter&;
+
+  [[nodiscard]] auto buffer() const -> const FlatBuffer::Buffer&;
+  [[nodiscard]] auto take() -> FlatBuffer::Buffer;
+
+  PngWriter();
+private:
+  FlatBuffer::Buffer out_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::PngWriter::buffer() const -> const FlatBuffer::Buffer& {
+  return out_;
+}
+
+inline auto spng::PngWriter::take() -> FlatBuffer::Buffer {
+  return std::move(out_);
+}
+
+#endif //PNGWRITER_HPP
@@ -0,0 +1,74 @@
+#ifndef PREDICATE_HPP
+#define PREDICATE_HPP
+#include <Carrier.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace spng {
+  class Predicate;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A boolean expression over a parsed file, such as
+//   width > 4096 && has(iCCP) && !crc_ok
+// compiled once into a small stack bytecode, then evaluated
+// against each Carrier's chunk list and IHDR fields. Nothing
+// is decoded, and CRCs are only computed if crc_ok is reached.
+//
+// Grammar, loosest binding first:
+//   expr    := and ('||' and)*
+//   and     := compare ('&&' compare)*
+//   compare := unary (('=='|'!='|'<'|'<='|'>'|'>=') unary)?
+//   unary   := '!' unary | NUMBER[K|M] | FIELD | FUNC '(' TYPE ')' | '(' expr ')'
+// FIELD is one of width, height, depth, color_type, interlaced,
+// size (file size in bytes), chunks (number of chunks), crc_ok.
+// FUNC is has, count (number of TYPE chunks) or bytes (their
+// total payload size). TYPE is a four letter chunk name.
+class spng::Predicate {
+public:
+  [[nodiscard]] auto matches(const Carrier& carrier) const -> bool;
+  [[nodiscard]] auto source() const -> const std::string&;
+
+  // Throws std::runtime_error, naming the
+  // column, if the expression doesn't parse.
+  explicit Predicate(std::string_view source);
+private:
+  enum class Op : uint8_t {
+    Push,      // value
+    Field,     // value is a Field
+    Has,       // value is the chunk type, as stored
+    Count,
+    Bytes,
+    Not,
+    Eq, Ne, Lt, Le, Gt, Ge,
+    AndJump,   // If the top is false jump to value, else pop it.
+    OrJump,    // If the top is true jump to value, else pop it.
+    Truth,     // Top becomes 0 or 1.
+  };
+
+  enum class Field : uint8_t {
+    Width, Height, Depth, ColorType, Interlaced, Size, Chunks, CrcOk,
+  };
+
+  struct Instr {
+    Op op = Op::Push;
+    int64_t value = 0;
+  };
+
+  class Parser;
+
+  std::vector<Instr> code_;
+  size_t max_stack_ = 0;
+  std::string source_;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline auto spng::Predicate::source() const -> const std::string& {
+  return source_;
+}
+
+#endif //PREDICATE_HPP
@@ -0,0 +1,17 @@
+#ifndef PROFILES_HPP
+#define PROFILES_HPP
+#include <Carrier.hpp>
+
+// Whole-run ICC profile interning for --profiles. Every
+// iCCP profile is decompressed and keyed by a hash of its
+// content, so the same profile compressed differently still
+// counts as one. The report shows each distinct profile, how
+// many files embed it, and the bytes spent on repeats.
+// Identical compressed streams are only inflated once.
+
+namespace spng::Profiles {
+  auto add(const Carrier& carrier) -> void;
+  auto print_report() -> void;
+}
+
+#endif //PROFILES_HPP
@@ -0,0 +1,97 @@
+#ifndef REWRITE_HPP
+#define REWRITE_HPP
+#include <Carrier.hpp>
+#include <OutFile.hpp>
+#include <concepts>
+#include <vector>
+
+// Writing modified copies of a parsed PNG. Retained
+// chunks are written straight out of the Carrier's buffer,
+// so the Carrier must outlive the OutFile's commit().
+
+namespace spng::Rewrite {
+  // Bytes a chunk occupies in the file, header and CRC included.
+  inline auto raw_size(const Chunk& chunk) -> size_t {
+    return sizeof(Chunk::Header) + chunk.length() + sizeof(uint32_t);
+  }
+
+  // Writes the signature and every chunk that keep() returns
+  // true for, unchanged and in their original order.
+  // Returns the number of chunks that were left out.
+  template<typename T> requires std::predicate<T, const Chunk&>
+  auto filter_chunks(const Carrier& carrier, T&& keep, OutFile& out) -> size_t;
+
+  struct RechunkResult {
+    size_t dropped  = 0;  // Chunks left out by keep().
+    size_t idat_in  = 0;  // IDAT chunks in the original.
+    size_t idat_out = 0;  // IDAT chunks written.
+  };
+
+  // Like filter_chunks(), but each run of IDAT chunks is replaced
+  // by chunks of idat_size bytes (the last one may be smaller)
+  // carrying the same compressed stream. Nothing is decompressed,
+  // the data is still written straight from the Carrier's buffer.
+  // IDAT chunks are always kept.
+  template<typename T> requires std::predicate<T, const Chunk&>
+  auto rechunk_idat(const Carrier& carrier, T&& keep, uint32_t idat_size, OutFile& out) -> RechunkResult;
+
+  // Writes IDAT chunks of idat_size bytes holding the concatenation
+  // of parts. Returns the number of chunks written.
+  auto write_idat(std::span<const std::span<const FlatBuffer::Byte>> parts,
+    uint32_t idat_size,
+    OutFile& out) -> size_t;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T> requires std::predicate<T, const spng::Chunk&>
+auto spng::Rewrite::filter_chunks(const Carrier& carrier, T&& keep, OutFile& out) -> size_t {
+  const auto bytes = carrier.bytes();
+  size_t dropped = 0;
+
+  out.write(bytes.first(8));
+  for(const auto& chunk : carrier.chunks()) {
+    if(!keep(chunk)) {
+      ++dropped;
+      continue;
+    }
+    out.write(bytes.subspan(chunk.offset_, raw_size(chunk)));
+  }
+
+  return dropped;
+}
+
+template<typename T> requires std::predicate<T, const spng::Chunk&>
+auto spng::Rewrite::rechunk_idat(const Carrier& carrier, T&& keep, const uint32_t idat_size, OutFile& out)
+-> RechunkResult {
+  const auto bytes   = carrier.bytes();
+  const auto& chunks = carrier.chunks();
+  std::vector<std::span<const FlatBuffer::Byte>> parts;
+  RechunkResult res;
+
+  out.write(bytes.first(8));
+  for(size_t i = 0; i < chunks.size(); i++) {
+    if(chunks[i].type() != Chunk::Type::IDAT) {
+      if(keep(chunks[i])) {
+        out.write(bytes.subspan(chunks[i].offset_, raw_size(chunks[i])));
+      } else {
+        ++res.dropped;
+      }
+      continue;
+    }
+
+    // Gather the data of the whole run.
+    parts.clear();
+    for( ; i < chunks.size() && chunks[i].type() == Chunk::Type::IDAT; i++) {
+      parts.emplace_back(bytes.subspan(chunks[i].offset_ + sizeof(Chunk::Header), chunks[i].length()));
+    }
+
+    --i;
+    res.idat_in  += parts.size();
+    res.idat_out += write_idat(parts, idat_size, out);
+  }
+
+  return res;
+}
+
+#endif //REWRITE_HPP
@@ -0,0 +1,27 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+#include <string>
+
+// Long-running mode for --serve. Listens on a Unix domain
+// socket, so callers pay for process startup once instead of
+// per image. Each connection sends requests, one per line:
+//   <path>\n          inspect a file on the server's disk
+//   RAW <n>\n<bytes>  inspect n bytes of PNG sent inline
+// and gets one NDJSON object back per request, in request
+// order. Requests may be pipelined: a connection's reader keeps
+// accepting them while earlier ones are still being worked on,
+// up to a fixed number in flight. Work goes to a shared pool of
+// Context::jobs_ threads through a bounded queue, so a flood of
+// requests blocks the readers (and in turn the clients) rather
+// than growing memory. RAW payloads are also held to a byte
+// budget, per connection and for the whole server: a reader
+// waits for earlier payloads to be inspected before it reads
+// the next one. POSIX only.
+
+namespace spng::Server {
+  // Runs until the process is interrupted. Returns false
+  // if the socket couldn't be set up.
+  auto run(const std::string& socket_path) -> bool;
+}
+
+#endif //SERVER_HPP
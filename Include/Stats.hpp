@@ -0,0 +1,133 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+#include <CompileAttrs.hpp>
+#include <Trace.hpp>
+#include <PerfCounters.hpp>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+// Run statistics for --stats. Every thread accumulates
+// into its own block of counters, which are only merged
+// when the report is printed, so recording is a couple
+// of plain adds with no locking or shared cache lines.
+// Everything here is a no-op until enable() is called.
+// Phases are also recorded as trace spans when tracing is on,
+// and the Parse/Verify phases sample hardware counters when
+// those are enabled.
+
+namespace spng::Stats {
+  enum class Phase : uint8_t {
+    Read,     // InFileRef::read()
+    Parse,    // Carrier construction (signature + chunk gathering)
+    Verify,   // CRC verification
+    Print,    // Verbose chunk output and summaries
+    Dump,     // Chunk hexdumps
+    Extract,  // Chunk::extract_to()
+    Export,   // Adding to the chunk index
+    Rewrite,  // Writing stripped copies
+    Decode,   // Inflating and unfiltering pixels
+    Hash,     // Hashing the chunk stream for --hash
+    Search,   // Text chunk search for --grep
+    Filter,   // Evaluating the --where predicate
+    Count,
+  };
+
+  enum class Counter : uint8_t {
+    Files,
+    BytesRead,
+    ChunksParsed,
+    BytesDumped,
+    BytesExtracted,
+    BytesSaved,
+    BytesDecoded,
+    FilesSkipped,
+    Count,
+  };
+
+  enum class Error : uint8_t {
+    Io,
+    Corruption,
+    Internal,
+    Count,
+  };
+
+  class ScopedPhase;
+  class ScopedFile;
+
+  auto enable() -> void;
+  auto add(Counter counter, uint64_t amnt = 1) -> void;
+  auto add_error(Error kind) -> void;
+  auto add_phase_time(Phase phase, uint64_t ns) -> void;
+  auto add_phase_counters(Phase phase, const Perf::Sample& begin, const Perf::Sample& end) -> void;
+  auto add_file_time(uint64_t ns) -> void;
+  auto phase_name(Phase phase) -> const char*;
+
+  // Merges every thread's counters and prints them.
+  auto print_report() -> void;
+
+  inline std::atomic<bool> enabled_ = false;
+  SPNG_FORCEINLINE auto enabled() -> bool {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Times the enclosing scope and attributes it to a phase.
+class spng::Stats::ScopedPhase {
+public:
+  ScopedPhase(const ScopedPhase&)            = delete;
+  ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+  explicit ScopedPhase(const Phase phase)
+    : phase_(phase), active_(enabled() || Trace::enabled()) {
+    if(!active_) return;
+    counting_ = Perf::enabled()
+      && (phase == Phase::Parse || phase == Phase::Verify)
+      && Perf::read(perf_start_);
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedPhase() {
+    if(!active_) return;
+    const auto end = std::chrono::steady_clock::now();
+    if(counting_) {
+      Perf::Sample perf_end;
+      if(Perf::read(perf_end)) add_phase_counters(phase_, perf_start_, perf_end);
+    } if(enabled()) {
+      add_phase_time(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count());
+    } if(Trace::enabled()) {
+      Trace::record(phase_name(phase_), start_, end);
+    }
+  }
+private:
+  Phase phase_;
+  bool active_;
+  bool counting_ = false;
+  Perf::Sample perf_start_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Times the enclosing scope as one file's end-to-end latency.
+class spng::Stats::ScopedFile {
+public:
+  ScopedFile(const ScopedFile&)            = delete;
+  ScopedFile& operator=(const ScopedFile&) = delete;
+
+  ScopedFile()
+    : active_(enabled()) {
+    if(active_) start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedFile() {
+    if(!active_) return;
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    add_file_time(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+  }
+private:
+  bool active_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif //STATS_HPP
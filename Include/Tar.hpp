@@ -0,0 +1,26 @@
+#ifndef TAR_HPP
+#define TAR_HPP
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace spng::Tar {
+  // One regular file stored in an archive.
+  struct Member {
+    std::string name;        // Full path, after pax / GNU long names.
+    size_t      offset = 0;  // Of the contents, from the start of the archive.
+    size_t      size   = 0;
+  };
+
+  // Lists the regular files in a tar archive without copying
+  // anything, so members can be parsed in place from a mapped
+  // archive. Understands ustar (and its name prefix), pax
+  // extended headers (path, size) and GNU long names. Throws
+  // std::runtime_error on a bad header checksum, or a member
+  // that runs past the end of the archive.
+  auto members(std::span<const uint8_t> archive) -> std::vector<Member>;
+}
+
+#endif //TAR_HPP
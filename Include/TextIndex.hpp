@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// An on-disk inverted index over the tEXt, zTXt and iTXt
+// chunks of many PNG files, so metadata queries can be
+// answered without opening a single PNG. Like ChunkIndex,
+// everything is fixed-width and little-endian, and a reader
+// maps the file and uses the sections in place.
+//
+// Layout (all sections are 8 byte aligned):
+//   Header                         (see TextIndex::Header)
+//   FileRecord[num_files]          sorted by path
+//   TextRecord[num_texts]          every text chunk, grouped by file
+//   KeyRecord[num_keys]            distinct keywords, sorted by bytes
+//   GramRecord[num_grams]          distinct value trigrams, sorted
+//   uint32_t postings[num_postings] file ids, ascending within each list
+//   char     strings[]             paths, keywords and (inflated) values
+//
+// A query narrows the files down with the keyword posting list
+// and/or the posting lists of every trigram in the searched text,
+// then confirms each candidate against the values stored here.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef TEXTINDEX_HPP
+#define TEXTINDEX_HPP
+#include <Carrier.hpp>
+#include <MappedFile.hpp>
+#include <CompileAttrs.hpp>
+#include <Endian.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <mutex>
+#include <cstring>
+
+namespace spng::TextIndex {
+  PACKED_STRUCT(Header, {
+    char magic[8];            // "SPNGTXI\0"
+    uint32_t version;         // Format version, currently 1.
+    uint32_t reserved;        // Always 0.
+    uint64_t num_files;
+    uint64_t num_texts;
+    uint64_t num_keys;
+    uint64_t num_grams;
+    uint64_t num_postings;
+    uint64_t files_offset;
+    uint64_t texts_offset;
+    uint64_t keys_offset;
+    uint64_t grams_offset;
+    uint64_t postings_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+  });
+
+  PACKED_STRUCT(FileRecord, {
+    uint64_t path_offset;     // Offset of the path inside the string table.
+    uint32_t path_length;
+    uint32_t text_count;      // Number of text chunks in this file.
+    uint64_t first_text;      // Index of the file's first TextRecord.
+    uint64_t file_size;       // Size and modification time when indexed,
+    int64_t  mtime;           // used to skip unchanged files on update.
+  });
+
+  PACKED_STRUCT(TextRecord, {
+    uint32_t file;            // Owning file id.
+    uint32_t keyword_length;
+    uint64_t keyword_offset;
+    uint64_t value_offset;
+    uint64_t value_length;
+  });
+
+  PACKED_STRUCT(KeyRecord, {
+    uint64_t string_offset;
+    uint32_t string_length;
+    uint32_t posting_count;
+    uint64_t first_posting;
+  });
+
+  PACKED_STRUCT(GramRecord, {
+    uint32_t gram;            // Three bytes, first one in bits 16-23.
+    uint32_t posting_count;
+    uint64_t first_posting;
+  });
+
+  // Read-only views into a mapped index.
+  struct File {
+    std::string_view path;
+    uint64_t first_text = 0;
+    uint32_t text_count = 0;
+    uint64_t file_size  = 0;
+    int64_t  mtime      = 0;
+  };
+
+  struct Text {
+    uint32_t file = 0;
+    std::string_view keyword;
+    std::string_view value;
+  };
+
+  // One text chunk that satisfied a query.
+  struct Hit {
+    uint32_t file  = 0;
+    uint64_t text  = 0;
+    size_t   at    = 0;     // Where in the value the text was found.
+    bool keyword   = false; // Matched on the keyword, not the value.
+  };
+
+  constexpr char     magic[8] = { 'S', 'P', 'N', 'G', 'T', 'X', 'I', '\0' };
+  constexpr uint32_t version  = 1;
+
+  class Writer;
+  class Reader;
+
+  // Modification time of a file as stored in FileRecord::mtime.
+  auto mtime_of(const std::string& path) -> int64_t;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Collects text chunks in memory and serializes them, with the
+// keyword and trigram postings, in write(). Files already in an
+// older index can be carried over without extracting their text again.
+// add() and carry() may be called from several threads at once.
+class spng::TextIndex::Writer {
+public:
+  auto add(const std::string& path, const Carrier& carrier) -> void;
+  auto carry(const Reader& old, uint32_t file) -> void;
+  auto clear() -> void;
+
+  // The output is replaced atomically, so it
+  // may be the index that was carried from.
+  auto write(const std::string& out_path) const -> void;
+
+  [[nodiscard]] auto num_files() const -> size_t;
+  [[nodiscard]] auto num_texts() const -> size_t;
+private:
+  struct PendingText {
+    std::string keyword;
+    std::string value;
+  };
+
+  struct PendingFile {
+    std::string path;
+    uint64_t file_size = 0;
+    int64_t mtime      = 0;
+    std::vector<PendingText> texts;
+  };
+
+  mutable std::mutex lock_;
+  std::vector<PendingFile> files_;
+};
+
+// Maps an index written by Writer. The header and sections
+// are validated once; lookups then binary search the sorted
+// records and read posting lists in place.
+class spng::TextIndex::Reader {
+public:
+  [[nodiscard]] auto num_files() const -> uint64_t;
+  [[nodiscard]] auto num_texts() const -> uint64_t;
+  [[nodiscard]] auto file(uint64_t i) const -> File;
+  [[nodiscard]] auto text(uint64_t i) const -> Text;
+
+  // The file id for a path, or -1 if it isn't in the index.
+  [[nodiscard]] auto find_file(std::string_view path) const -> int64_t;
+
+  // Answers TEXT (anywhere in a keyword or value) or KEYWORD=TEXT
+  // (in a value under exactly that keyword), the same way --grep
+  // does. Hits are in file order.
+  [[nodiscard]] auto query(std::string_view pattern) const -> std::vector<Hit>;
+
+  explicit Reader(const std::string& in_path);
+private:
+  template<typename T>
+  [[nodiscard]] auto _read(uint64_t offset) const -> T;
+  [[nodiscard]] auto _string(uint64_t offset, uint64_t length) const -> std::string_view;
+  [[nodiscard]] auto _postings(uint64_t first, uint32_t count) const -> std::vector<uint32_t>;
+  [[nodiscard]] auto _key_postings(std::string_view keyword) const -> std::vector<uint32_t>;
+  [[nodiscard]] auto _gram_postings(uint32_t gram) const -> std::vector<uint32_t>;
+
+  MappedFile map_;
+  Header header_ = {};
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+auto spng::TextIndex::Reader::_read(const uint64_t offset) const -> T {
+  T val;
+  std::memcpy(&val, map_.bytes().data() + offset, sizeof(T));
+  return maybe_bitswap(val, Endian::Little);
+}
+
+inline auto spng::TextIndex::Reader::num_files() const -> uint64_t {
+  return header_.num_files;
+}
+
+inline auto spng::TextIndex::Reader::num_texts() const -> uint64_t {
+  return header_.num_texts;
+}
+
+#endif //TEXTINDEX_HPP
@@ -0,0 +1,33 @@
+#ifndef TEXTSEARCH_HPP
+#define TEXTSEARCH_HPP
+#include <Chunks.hpp>
+#include <span>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace spng {
+  struct TextChunk;
+
+  // Position of the first occurrence of needle in haystack,
+  // or npos. An empty needle matches at 0. Uses SSE2 where
+  // available: candidate positions are those where both the
+  // first and the last byte of the needle match, 16 at a time,
+  // and only those are compared in full.
+  inline constexpr size_t npos = static_cast<size_t>(-1);
+  auto find_bytes(std::span<const uint8_t> haystack, std::span<const uint8_t> needle) -> size_t;
+
+  // Splits the payload of a tEXt, zTXt or iTXt chunk into its
+  // keyword and value, pointing into the payload. Returns
+  // std::nullopt for any other chunk type, and throws
+  // std::runtime_error if the chunk is malformed.
+  auto split_text(Chunk::Type type, std::span<const uint8_t> payload) -> std::optional<TextChunk>;
+}
+
+struct spng::TextChunk {
+  std::span<const uint8_t> keyword;
+  std::span<const uint8_t> value;  // Still zlib compressed if compressed is set.
+  bool compressed = false;
+};
+
+#endif //TEXTSEARCH_HPP
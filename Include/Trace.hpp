@@ -0,0 +1,72 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+#include <CompileAttrs.hpp>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// Optional event tracing, written out in the Chrome trace-event
+// JSON format (load it in chrome://tracing or ui.perfetto.dev).
+// Each thread records completed spans into its own fixed-size
+// ring buffer; when a buffer is full the oldest spans are dropped.
+// Nothing is recorded until enable() is called.
+
+namespace spng::Trace {
+  using Clock = std::chrono::steady_clock;
+
+  class Span;
+
+  // Starts recording. "capacity" is the number
+  // of spans kept per thread.
+  auto enable(size_t capacity = size_t(1) << 16) -> void;
+
+  // Records a completed span. "name" must outlive the
+  // trace (string literals), "detail" is shown as an arg.
+  auto record(const char* name, Clock::time_point begin, Clock::time_point end, std::string detail = {}) -> void;
+
+  // Merges every thread's spans and writes them to "path".
+  auto write_json(const std::string& path) -> void;
+
+  // Escapes a string for use inside a JSON string literal.
+  auto json_escape(std::string_view str) -> std::string;
+
+  inline std::atomic<bool> enabled_ = false;
+  SPNG_FORCEINLINE auto enabled() -> bool {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Records the enclosing scope as a span.
+class spng::Trace::Span {
+public:
+  Span(const Span&)            = delete;
+  Span& operator=(const Span&) = delete;
+
+  explicit Span(const char* name)
+    : name_(name), active_(enabled()) {
+    if(active_) begin_ = Clock::now();
+  }
+
+  Span(const char* name, std::string detail)
+    : name_(name), active_(enabled()) {
+    if(active_) {
+      detail_ = std::move(detail);
+      begin_  = Clock::now();
+    }
+  }
+
+  ~Span() {
+    if(active_) record(name_, begin_, Clock::now(), std::move(detail_));
+  }
+private:
+  const char* name_;
+  bool active_;
+  std::string detail_;
+  Clock::time_point begin_;
+};
+
+#endif //TRACE_HPP
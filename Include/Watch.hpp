@@ -0,0 +1,21 @@
+#ifndef WATCH_HPP
+#define WATCH_HPP
+#include <string>
+
+// Watch mode for --watch. Uses inotify to notice .png files
+// that were closed after writing, or moved into a watched
+// directory (subdirectories included, also ones created
+// later). Events for the same file are debounced: a file is
+// only inspected once it has been quiet for a short while, so
+// a writer that closes and reopens it a few times costs one
+// pass. Files that become due together go through
+// run_file_cycles() as one batch, on Context::jobs_ threads.
+// Linux only.
+
+namespace spng::Watch {
+  // Runs until the process is interrupted. Returns false
+  // if the directory couldn't be watched.
+  auto run(const std::string& dir) -> bool;
+}
+
+#endif //WATCH_HPP
@@ -2,16 +2,46 @@
 #include <ConManip.hpp>
 #include <Context.hpp>
 #include <Panic.hpp>
+#include <Decode.hpp>
+#include <Predicate.hpp>
 #include <print>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <ranges>
 #include <filesystem>
+#include <charconv>
+#include <cctype>
+#include <iterator>
+#include <algorithm>
 
 // ~ Flag List ~
 // -v --verbose
 // -ec --extract-chunks chunk1,chunk2,chunk3
 // -dc --dump-chunks chunk1,chunk2,chunk3
+// -vc --verify-crc
+// -ei --export-index out.idx
+// -st --stats
+// -tr --trace out.json
+// -pc --perf-counters
+// -cs --census
+// -j --jobs N
+// -sp --strip chunk1,chunk2|ancillary
+// -ri --rechunk-idat SIZE[K|M]
+// -ip --in-place
+// -rp --raw-pixels rgba8|rgba16|native
+// -ps --pixel-stats
+// -hs --hash
+// -pa --palette
+// -pr --profiles
+// -gr --grep TEXT|KEYWORD=TEXT
+// -ti --text-index out.txi
+// -q --query TEXT|KEYWORD=TEXT
+// -wh --where EXPRESSION
+// -sv --serve SOCKET
+// -w --watch DIR
+// -cv --carve
+// -ce --carve-extract
 // Last argument is input files
 // More can be added later.
 
@@ -37,6 +67,124 @@ static constexpr spng::FlagDescriptor flag_list[] {{
   .lf   = "--no-summary",
   .sf   = "-ns",
   .desc = "Don't display any chunk summaries.",
+},{
+  .lf   = "--verify-crc",
+  .sf   = "-vc",
+  .desc = "Treat chunks with a mismatched CRC-32 as corruption.",
+},{
+  .lf   = "--export-index",
+  .sf   = "-ei",
+  .desc = "Write a binary chunk index of every input "
+          "file to the given path.",
+},{
+  .lf   = "--stats",
+  .sf   = "-st",
+  .desc = "Print counters, per-phase timings and per-file "
+          "latency percentiles after all files are processed.",
+},{
+  .lf   = "--trace",
+  .sf   = "-tr",
+  .desc = "Record a timeline of every file and stage, written "
+          "to the given path as Chrome trace-event JSON.",
+},{
+  .lf   = "--perf-counters",
+  .sf   = "-pc",
+  .desc = "Add hardware counters (cycles, instructions, cache and "
+          "branch misses) for parsing and CRC checks to --stats. Linux only.",
+},{
+  .lf   = "--census",
+  .sf   = "-cs",
+  .desc = "Print per chunk type counts, payload sizes and "
+          "ancillary overhead across all input files. "
+          "Bad files are reported and skipped.",
+},{
+  .lf   = "--jobs",
+  .sf   = "-j",
+  .desc = "Number of files to process in parallel. "
+          "0 uses one thread per core. Defaults to 1.",
+},{
+  .lf   = "--strip",
+  .sf   = "-sp",
+  .desc = "Comma delimited ancillary chunk names to remove, or \"ancillary\" "
+          "for all of them. Writes <FILENAME>.stripped.png",
+},{
+  .lf   = "--rechunk-idat",
+  .sf   = "-ri",
+  .desc = "Split the image data into IDAT chunks of the given size "
+          "(e.g. 256K, 1M) without recompressing. Writes <FILENAME>.rechunked.png",
+},{
+  .lf   = "--in-place",
+  .sf   = "-ip",
+  .desc = "With --strip or --rechunk-idat, atomically replace "
+          "each input file instead of writing a new one.",
+},{
+  .lf   = "--raw-pixels",
+  .sf   = "-rp",
+  .desc = "Decode the image to raw pixels (rgba8, rgba16 or native), "
+          "saved in the form <FILENAME>.<FORMAT>.raw",
+},{
+  .lf   = "--pixel-stats",
+  .sf   = "-ps",
+  .desc = "Decode the image and report per-channel histograms, alpha usage, "
+          "grayscale, bit depth actually used and unique colour count.",
+},{
+  .lf   = "--hash",
+  .sf   = "-hs",
+  .desc = "Print a hash of each file's chunk stream and of its decoded pixels, "
+          "then group files showing the same image.",
+},{
+  .lf   = "--palette",
+  .sf   = "-pa",
+  .desc = "For indexed images, report unused, duplicate and transparent palette "
+          "entries, stale tRNS/hIST data and the smallest index depth that fits.",
+},{
+  .lf   = "--profiles",
+  .sf   = "-pr",
+  .desc = "Report every distinct embedded ICC profile across all input "
+          "files, and the bytes spent on duplicate copies.",
+},{
+  .lf   = "--grep",
+  .sf   = "-gr",
+  .desc = "Search tEXt, zTXt and iTXt keywords and values for TEXT, or only "
+          "values under KEYWORD for KEYWORD=TEXT. Prints only matches (implies --silent).",
+},{
+  .lf   = "--text-index",
+  .sf   = "-ti",
+  .desc = "Build an index of every text chunk in the input files at the given path. "
+          "If it already exists, only the text of new or modified files is indexed again.",
+},{
+  .lf   = "--query",
+  .sf   = "-q",
+  .desc = "Look up TEXT or KEYWORD=TEXT in the index given by --text-index, "
+          "without reading any PNG files. Takes no input files.",
+},{
+  .lf   = "--where",
+  .sf   = "-wh",
+  .desc = "Only process files matching an expression over width, height, depth, "
+          "color_type, interlaced, size, chunks, crc_ok, has(TYPE), count(TYPE) and "
+          "bytes(TYPE), e.g. \"width > 4096 && has(iCCP) && !crc_ok\". "
+          "With --silent, matching file names are printed.",
+},{
+  .lf   = "--serve",
+  .sf   = "-sv",
+  .desc = "Listen on the given Unix socket instead of taking input files. Each line sent is "
+          "a file path, or \"RAW <size>\" followed by the PNG bytes; each gets one line "
+          "of JSON back, in order. Honours --verify-crc and --where. Uses --jobs workers. POSIX only.",
+},{
+  .lf   = "--watch",
+  .sf   = "-w",
+  .desc = "Instead of taking input files, inspect every .png file written or moved "
+          "into the given directory from now on, until interrupted. Linux only.",
+},{
+  .lf   = "--carve",
+  .sf   = "-cv",
+  .desc = "Treat the inputs as arbitrary binary files (disk images, dumps, archives) "
+          "and report the offset and size of every PNG embedded in them.",
+},{
+  .lf   = "--carve-extract",
+  .sf   = "-ce",
+  .desc = "Like --carve, and also save each PNG found "
+          "in the form <FILENAME>.<OFFSET>.png",
 }};
 
 auto spng::print_help() -> void {
@@ -61,7 +209,122 @@ auto spng::print_help() -> void {
 
   std::println("see_png -v file1.png,file2.png");
   std::println("see_png --verbose --dump_chunks IHDR,IEND,IDAT myfile.png");
-  std::println("see_png --extract-chunks tEXt --silent myfile.png\n");
+  std::println("see_png --extract-chunks tEXt --silent myfile.png");
+  std::println("see_png --silent --export-index chunks.idx file1.png,file2.png");
+  std::println("see_png --silent --census --jobs 0 images/");
+  std::println("see_png --strip tEXt,zTXt,iTXt,tIME --in-place myfile.png");
+  std::println("see_png --silent --rechunk-idat 1M --in-place --jobs 0 images/");
+  std::println("see_png --silent --hash --jobs 0 images/");
+  std::println("see_png --silent --profiles --jobs 0 images/");
+  std::println("see_png --grep Software=GIMP --jobs 0 images/");
+  std::println("see_png --silent --text-index text.txi --jobs 0 images/");
+  std::println("see_png --text-index text.txi --query Software=GIMP");
+  std::println("see_png --silent --where \"bytes(tEXt) > 64K || !crc_ok\" images/");
+  std::println("see_png --serve /tmp/see_png.sock --verify-crc --jobs 0");
+  std::println("see_png --watch uploads/ --verify-crc --no-summary");
+  std::println("see_png --carve-extract disk.img,memory.dmp");
+  std::println("see_png --silent --hash --jobs 0 photos.tar\n");
+}
+
+// Parses a byte count with an optional K or M (KiB, MiB) suffix.
+static auto parse_size(const std::string& str, uint32_t& out) -> bool {
+  uint64_t val = 0;
+  const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), val);
+  if(ec != std::errc()) {
+    return false;
+  }
+
+  const std::string_view suffix(end, str.data() + str.size());
+  if(suffix == "K" || suffix == "k") {
+    val <<= 10;
+  } else if(suffix == "M" || suffix == "m") {
+    val <<= 20;
+  } else if(!suffix.empty()) {
+    return false;
+  }
+
+  if(val > UINT32_MAX) {
+    return false;
+  }
+
+  out = static_cast<uint32_t>(val);
+  return true;
+}
+
+// Replace any directory in the input list with
+// every .png file found beneath it, in sorted order.
+// When carving, every file is taken.
+static auto expand_input_dirs() -> bool {
+  auto& inputs = spng::Context::get().ifilenames_;
+  const bool any_file = spng::Context::get().flags_ & spng::Context::Carve;
+  std::vector<std::string> expanded;
+  expanded.reserve(inputs.size());
+
+  for(auto& input : inputs) {
+    std::error_code ec;
+    if(!std::filesystem::is_directory(input, ec)) {
+      expanded.emplace_back(std::move(input));
+      continue;
+    }
+
+    std::vector<std::string> found;
+    auto it = std::filesystem::recursive_directory_iterator(input, ec);
+    for( ; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+      auto ext = it->path().extension().string();
+      std::ranges::transform(ext, ext.begin(), [](const char ch) { return std::tolower(ch); });
+      if((any_file || ext == ".png") && it->is_regular_file(ec)) {
+        found.emplace_back(it->path().string());
+      }
+    }
+
+    if(ec) {
+      spng::set_console(spng::ConFg::Red);
+      std::print("FILE I/O ");
+      spng::reset_console();
+      std::println(":: Could not walk directory \"{}\": {}", input, ec.message());
+      return false;
+    }
+
+    std::ranges::sort(found);
+    std::ranges::move(found, std::back_inserter(expanded));
+  }
+
+  inputs = std::move(expanded);
+  return true;
+}
+
+// The first flag given whose output is only written after
+// the last input file, or nothing.
+static auto whole_run_flag() -> std::string_view {
+  const auto& ctx = spng::Context::get();
+  if(ctx.flags_ & spng::Context::Census)   return "--census";
+  if(ctx.flags_ & spng::Context::Hash)     return "--hash";
+  if(ctx.flags_ & spng::Context::Profiles) return "--profiles";
+  if(ctx.flags_ & spng::Context::Stats)    return "--stats";
+  if(ctx.flags_ & spng::Context::PerfCtrs) return "--perf-counters";
+  if(!ctx.trace_path_.empty())             return "--trace";
+  if(!ctx.export_index_.empty())           return "--export-index";
+  if(!ctx.text_index_.empty())             return "--text-index";
+  return {};
+}
+
+// The first flag given that --serve has no way to honour:
+// it only parses, checks CRCs and evaluates --where, and
+// replies with JSON instead of printing or writing files.
+static auto unserved_flag() -> std::string_view {
+  const auto& ctx = spng::Context::get();
+  if(ctx.flags_ & spng::Context::Verbose)  return "--verbose";
+  if(!ctx.extract_chunks_.empty())         return "--extract-chunks";
+  if(!ctx.dump_chunks_.empty())            return "--dump-chunks";
+  if(!ctx.strip_chunks_.empty())           return "--strip";
+  if(ctx.idat_size_ != 0)                  return "--rechunk-idat";
+  if(ctx.flags_ & spng::Context::InPlace)  return "--in-place";
+  if(!ctx.raw_format_.empty())             return "--raw-pixels";
+  if(ctx.flags_ & spng::Context::PixStats) return "--pixel-stats";
+  if(ctx.flags_ & spng::Context::Palette)  return "--palette";
+  if(!ctx.grep_.empty())                   return "--grep";
+  if(ctx.flags_ & spng::Context::Carve)    return "--carve";
+  return {};
 }
 
 auto spng::init_context_from_args(const int argc, char** argv) -> bool {
@@ -70,6 +333,8 @@ auto spng::init_context_from_args(const int argc, char** argv) -> bool {
 
   std::vector<std::string> strings;
   size_t ind = 0;
+  bool jobs_passed = false;
+  bool carve_passed = false;  // Carve alone is also set by --carve-extract.
 
   // Copy into a vector, so that we can
   // get useful bounds checking.
@@ -126,6 +391,276 @@ auto spng::init_context_from_args(const int argc, char** argv) -> bool {
       return true;
     }
 
+    if(strings.at(ind) == "--verify-crc" || strings.at(ind) == "-vc") {
+      if(Context::get().flags_ & Context::CrcCheck) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::CrcCheck;
+      return true;
+    }
+
+    if(strings.at(ind) == "--stats" || strings.at(ind) == "-st") {
+      if(Context::get().flags_ & Context::Stats) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Stats;
+      return true;
+    }
+
+    if(strings.at(ind) == "--perf-counters" || strings.at(ind) == "-pc") {
+      if(Context::get().flags_ & Context::PerfCtrs) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::PerfCtrs;
+      return true;
+    }
+
+    if(strings.at(ind) == "--census" || strings.at(ind) == "-cs") {
+      if(Context::get().flags_ & Context::Census) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Census;
+      return true;
+    }
+
+    if(strings.at(ind) == "--pixel-stats" || strings.at(ind) == "-ps") {
+      if(Context::get().flags_ & Context::PixStats) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::PixStats;
+      return true;
+    }
+
+    if(strings.at(ind) == "--hash" || strings.at(ind) == "-hs") {
+      if(Context::get().flags_ & Context::Hash) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Hash;
+      return true;
+    }
+
+    if(strings.at(ind) == "--palette" || strings.at(ind) == "-pa") {
+      if(Context::get().flags_ & Context::Palette) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Palette;
+      return true;
+    }
+
+    if(strings.at(ind) == "--profiles" || strings.at(ind) == "-pr") {
+      if(Context::get().flags_ & Context::Profiles) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Profiles;
+      return true;
+    }
+
+    if(strings.at(ind) == "--carve" || strings.at(ind) == "-cv") {
+      if(carve_passed) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Carve;
+      carve_passed = true;
+      return true;
+    }
+
+    if(strings.at(ind) == "--carve-extract" || strings.at(ind) == "-ce") {
+      if(Context::get().flags_ & Context::CarveOut) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::Carve | Context::CarveOut;
+      return true;
+    }
+
+    if(strings.at(ind) == "--in-place" || strings.at(ind) == "-ip") {
+      if(Context::get().flags_ & Context::InPlace) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().flags_ |= Context::InPlace;
+      return true;
+    }
+
+    if(strings.at(ind) == "--strip" || strings.at(ind) == "-sp") {
+      if(!Context::get().strip_chunks_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      const auto chunk_names = strings.at(ind + 1);
+      for(const auto& name : std::ranges::views::split(chunk_names, ',')) {
+        Context::get().strip_chunks_.emplace_back(name.begin(), name.end());
+      }
+      ++ind;
+
+      // A file without its critical chunks isn't a PNG anymore.
+      // Bit 5 of the first byte is set for ancillary chunks.
+      for(const auto& name : Context::get().strip_chunks_) {
+        if(name == "ancillary") continue;
+        if(name.size() != 4 || !(name.front() & 0x20)) {
+          set_console(ConFg::Red);
+          std::print("INVALID argument ");
+          reset_console();
+          std::println(":: Can only strip ancillary chunks, not \"{}\".", name);
+          return false;
+        }
+      }
+      return true;
+    }
+
+    if(strings.at(ind) == "--rechunk-idat" || strings.at(ind) == "-ri") {
+      if(Context::get().idat_size_ != 0) {
+        ealready_passed();
+        return false;
+      }
+      ++ind;
+      if(!parse_size(strings.at(ind), Context::get().idat_size_)
+        || Context::get().idat_size_ == 0
+        || Context::get().idat_size_ > 0x7FFFFFFFU) {
+        einvalid_arg();
+        return false;
+      }
+      return true;
+    }
+
+    if(strings.at(ind) == "--jobs" || strings.at(ind) == "-j") {
+      if(jobs_passed) {
+        ealready_passed();
+        return false;
+      }
+      const auto& value = strings.at(ind + 1);
+      const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), Context::get().jobs_);
+      if(ec != std::errc() || end != value.data() + value.size()) {
+        ++ind;
+        einvalid_arg();
+        return false;
+      }
+      jobs_passed = true;
+      ++ind;
+      return true;
+    }
+
+    if(strings.at(ind) == "--raw-pixels" || strings.at(ind) == "-rp") {
+      if(!Context::get().raw_format_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      ++ind;
+      if(!Decoder::format_from_string(strings.at(ind))) {
+        einvalid_arg();
+        return false;
+      }
+      Context::get().raw_format_ = strings.at(ind);
+      return true;
+    }
+
+    if(strings.at(ind) == "--grep" || strings.at(ind) == "-gr") {
+      if(!Context::get().grep_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      ++ind;
+      if(strings.at(ind).empty()) {
+        einvalid_arg();
+        return false;
+      }
+      Context::get().grep_ = strings.at(ind);
+      return true;
+    }
+
+    if(strings.at(ind) == "--where" || strings.at(ind) == "-wh") {
+      if(!Context::get().where_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      ++ind;
+      // Compiled here only to report mistakes early.
+      try {
+        (void)Predicate(strings.at(ind));
+      } catch(const std::runtime_error& e) {
+        set_console(ConFg::Red);
+        std::print("INVALID expression ");
+        reset_console();
+        std::println(":: {}", e.what());
+        return false;
+      }
+      Context::get().where_ = strings.at(ind);
+      return true;
+    }
+
+    if(strings.at(ind) == "--watch" || strings.at(ind) == "-w") {
+      if(!Context::get().watch_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().watch_ = strings.at(ind + 1);
+      ++ind;
+      return true;
+    }
+
+    if(strings.at(ind) == "--serve" || strings.at(ind) == "-sv") {
+      if(!Context::get().serve_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().serve_ = strings.at(ind + 1);
+      ++ind;
+      return true;
+    }
+
+    if(strings.at(ind) == "--query" || strings.at(ind) == "-q") {
+      if(!Context::get().query_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      ++ind;
+      if(strings.at(ind).empty()) {
+        einvalid_arg();
+        return false;
+      }
+      Context::get().query_ = strings.at(ind);
+      return true;
+    }
+
+    if(strings.at(ind) == "--text-index" || strings.at(ind) == "-ti") {
+      if(!Context::get().text_index_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().text_index_ = strings.at(ind + 1);
+      ++ind;
+      return true;
+    }
+
+    if(strings.at(ind) == "--trace" || strings.at(ind) == "-tr") {
+      if(!Context::get().trace_path_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().trace_path_ = strings.at(ind + 1);
+      ++ind;
+      return true;
+    }
+
+    if(strings.at(ind) == "--export-index" || strings.at(ind) == "-ei") {
+      if(!Context::get().export_index_.empty()) {
+        ealready_passed();
+        return false;
+      }
+      Context::get().export_index_ = strings.at(ind + 1);
+      ++ind;
+      return true;
+    }
+
     if(strings.at(ind) == "--extract-chunks" || strings.at(ind) == "-ec") {
       if(!Context::get().extract_chunks_.empty()) {
         ealready_passed();
@@ -183,6 +718,59 @@ auto spng::init_context_from_args(const int argc, char** argv) -> bool {
     return false;
   }
 
+  // --grep implies --silent. Set after parsing, so
+  // --silent is accepted on either side of it.
+  if(!Context::get().grep_.empty()) {
+    Context::get().flags_ |= Context::Silent;
+  }
+
+  // --watch and --serve never finish, so neither takes files
+  // up front, and neither can write a whole-run output.
+  if(!Context::get().watch_.empty() && !Context::get().serve_.empty()) {
+    set_console(ConFg::Red);
+    std::println("--watch and --serve can't be used together.");
+    reset_console();
+    return false;
+  }
+
+  const std::string_view mode = !Context::get().watch_.empty() ? "--watch"
+    : !Context::get().serve_.empty() ? "--serve" : "";
+  if(!mode.empty()) {
+    if(!Context::get().ifilenames_.empty()) {
+      set_console(ConFg::Red);
+      std::println("{} takes no input files.", mode);
+      reset_console();
+      return false;
+    } if(const auto flag = whole_run_flag(); !flag.empty()) {
+      set_console(ConFg::Red);
+      std::println("{} can't be used with {}, which only reports once every file is done.", mode, flag);
+      reset_console();
+      return false;
+    } if(const auto flag = unserved_flag(); !flag.empty() && mode == "--serve") {
+      set_console(ConFg::Red);
+      std::println("--serve can't be used with {}, requests are only parsed, CRC checked and filtered.", flag);
+      reset_console();
+      return false;
+    } if(!Context::get().query_.empty()) {
+      set_console(ConFg::Red);
+      std::println("{} can't be used with --query.", mode);
+      reset_console();
+      return false;
+    }
+    return true;
+  }
+
+  // A query only reads the index.
+  if(!Context::get().query_.empty()) {
+    if(Context::get().text_index_.empty() || !Context::get().ifilenames_.empty()) {
+      set_console(ConFg::Red);
+      std::println("--query needs --text-index, and no input files.");
+      reset_console();
+      return false;
+    }
+    return true;
+  }
+
   // Make sure we have input file(s) to use...
   if(Context::get().ifilenames_.empty()) {
     set_console(ConFg::Red);
@@ -193,7 +781,29 @@ auto spng::init_context_from_args(const int argc, char** argv) -> bool {
     return false;
   }
 
-  return true;
+  if(Context::get().flags_ & Context::InPlace
+    && Context::get().strip_chunks_.empty()
+    && Context::get().idat_size_ == 0) {
+    set_console(ConFg::Red);
+    std::println("--in-place has nothing to do without --strip or --rechunk-idat.");
+    reset_console();
+    return false;
+  }
+
+  // Members of a .tar archive are only ever read in place.
+  const auto is_archive = [](const std::filesystem::path& path) {
+    auto ext = path.extension().string();
+    std::ranges::transform(ext, ext.begin(), [](const char ch) { return std::tolower(ch); });
+    return ext == ".tar";
+  };
+  if(Context::get().flags_ & Context::InPlace && std::ranges::any_of(Context::get().ifilenames_, is_archive)) {
+    set_console(ConFg::Red);
+    std::println("--in-place can't rewrite the members of a .tar archive.");
+    reset_console();
+    return false;
+  }
+
+  return expand_input_dirs();
 }
 
 
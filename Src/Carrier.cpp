@@ -1,13 +1,22 @@
 #include <Carrier.hpp>
 #include <Panic.hpp>
+#include <Trace.hpp>
 
 auto spng::Carrier::_gather_chunks() -> Carrier& {
-  ASSERT(buff_ != nullptr);
-  ASSERT(buff_->size() > 8);
+  const Trace::Span _("gather_chunks");
+  ASSERT(view_.data() != nullptr);
+  ASSERT(view_.size() > 8);
 
+  // Chunks of an owning Carrier only get the weak pointer,
+  // so that they can't outlive the buffer. Borrowed bytes
+  // are handed out as a plain view.
   auto& ihdr = chunks_.emplace_back();
-  ihdr.buff_ = this->buff_;
   ihdr.offset_ = 8;
+  if(buff_ != nullptr) {
+    ihdr.buff_ = this->buff_;
+  } else {
+    ihdr.view_ = this->view_;
+  }
 
   if(ihdr.type() != Chunk::Type::IHDR) {
     throw std::runtime_error("corrupted PNG - no IHDR");
@@ -28,12 +37,20 @@ auto spng::Carrier::_gather_chunks() -> Carrier& {
     throw std::runtime_error("IEND is not the final PNG chunk.");
   }
 
+  // next() stops at the first chunk that runs past the end
+  // of the buffer, so only the final chunk can be out of bounds.
+  const auto& last = chunks_.back();
+  if(last.offset_ + sizeof(Chunk::Header) + last.length() + sizeof(uint32_t) > view_.size()) {
+    throw std::runtime_error("IEND chunk runs past the end of the file.");
+  }
+
   return *this;
 }
 
 auto spng::Carrier::_verify_signature() -> Carrier& {
-  ASSERT(buff_ != nullptr);
-  ASSERT(!buff_->empty());
+  const Trace::Span _("signature");
+  ASSERT(view_.data() != nullptr);
+  ASSERT(!view_.empty());
 
   // These first 8 "magic" bytes must be
   // at the beginning of the file.
@@ -41,12 +58,12 @@ auto spng::Carrier::_verify_signature() -> Carrier& {
     0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A
   };
 
-  if(png_magic.size() >= buff_->size()) {
+  if(png_magic.size() >= view_.size()) {
     throw std::runtime_error("File is too small.");
   }
 
   for(size_t i = 0; i < png_magic.size(); i++) {
-    if(buff_->at(i) != png_magic.at(i)) {
+    if(view_.at(i) != png_magic.at(i)) {
       throw std::runtime_error("Invalid PNG signature.");
     }
   }
@@ -55,7 +72,7 @@ auto spng::Carrier::_verify_signature() -> Carrier& {
 }
 
 auto spng::Carrier::print_summary() const -> void {
-  ASSERT(buff_ != nullptr);
+  ASSERT(view_.data() != nullptr);
   ASSERT(!chunks_.empty());
 
   // Title
@@ -84,7 +101,7 @@ auto spng::Carrier::print_summary() const -> void {
   }
 
   std::println("\nTotal Chunks : {}", chunks_.size());
-  std::println("Size (Bytes) : {}", buff_->size());
+  std::println("Size (Bytes) : {}", view_.size());
 
   set_console(ConFg::Green);
   set_console(ConStyle::Bold);
@@ -99,6 +116,18 @@ spng::Carrier::Carrier(const FlatBuffer::Buffer& file) {
 
   buff_  = FlatBuffer::make_shared(file.size());
   *buff_ = file;
+  view_  = FlatBuffer::View(*buff_);
+  _verify_signature();
+  _gather_chunks();
+}
+
+spng::Carrier::Carrier(FlatBuffer::Shared file) {
+  if(file == nullptr || file->empty()) {
+    throw std::runtime_error("Empty file buffer");
+  }
+
+  buff_ = std::move(file);
+  view_ = FlatBuffer::View(*buff_);
   _verify_signature();
   _gather_chunks();
 }
@@ -106,6 +135,17 @@ spng::Carrier::Carrier(const FlatBuffer::Buffer& file) {
 spng::Carrier::Carrier(const InFileRef& file) {
   const auto fsize = file.size();
   buff_ = file.read(fsize);
+  view_ = FlatBuffer::View(*buff_);
+  _verify_signature();
+  _gather_chunks();
+}
+
+spng::Carrier::Carrier(const std::span<const std::byte> file) {
+  if(file.empty()) {
+    throw std::runtime_error("Empty file buffer");
+  }
+
+  view_ = FlatBuffer::make_view(file);
   _verify_signature();
   _gather_chunks();
 }
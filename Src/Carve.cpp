@@ -0,0 +1,46 @@
+#include <Carve.hpp>
+#include <Carrier.hpp>
+#include <TextSearch.hpp>
+#include <Trace.hpp>
+#include <array>
+#include <stdexcept>
+
+auto spng::Carve::scan(const std::span<const uint8_t> blob) -> Result {
+  const Trace::Span _("carve");
+  constexpr std::array<uint8_t, 8> png_magic = {
+    0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A
+  };
+
+  Result res;
+  size_t pos = 0;
+  while(pos < blob.size()) {
+    const size_t hit = find_bytes(blob.subspan(pos), png_magic);
+    if(hit == npos) {
+      break;
+    }
+
+    // Everything from the signature to the end of the blob is
+    // handed to the Carrier, which stops walking at IEND.
+    const size_t offset = pos + hit;
+    try {
+      const Carrier carrier(std::as_bytes(blob.subspan(offset)));
+      const auto& last = carrier.chunks().back();
+      const auto  ihdr = carrier.metadata();
+
+      Extent ext;
+      ext.offset = offset;
+      ext.size   = last.offset_ + sizeof(Chunk::Header) + last.length() + sizeof(uint32_t);
+      ext.chunks = carrier.chunks().size();
+      ext.width  = ihdr.width();
+      ext.height = ihdr.height();
+      res.found.emplace_back(ext);
+      pos = offset + ext.size;
+    } catch(const std::exception&) {
+      // A stray signature, or a truncated image.
+      res.rejected++;
+      pos = offset + 1;
+    }
+  }
+
+  return res;
+}
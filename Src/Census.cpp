@@ -0,0 +1,247 @@
+#include <Census.hpp>
+#include <ConManip.hpp>
+#include <Fmt.hpp>
+#include <unordered_map>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <print>
+
+namespace {
+  // Log-linear histogram: exact below 8, then 8 buckets
+  // per power of two, so any percentile read from it is
+  // within 12.5% of the true value. Mergeable by addition.
+  constexpr size_t hist_sub     = 8;
+  constexpr size_t hist_buckets = hist_sub + (32 - 3) * hist_sub;
+
+  auto bucket_of(const uint32_t val) -> size_t {
+    if(val < hist_sub) {
+      return val;
+    }
+    const auto exp = static_cast<size_t>(std::bit_width(val) - 1);
+    const auto sub = static_cast<size_t>(val >> (exp - 3)) & (hist_sub - 1);
+    return hist_sub + (exp - 3) * hist_sub + sub;
+  }
+
+  auto bucket_floor(const size_t idx) -> uint64_t {
+    if(idx < hist_sub) {
+      return idx;
+    }
+    const size_t exp = (idx - hist_sub) / hist_sub + 3;
+    const size_t sub = (idx - hist_sub) % hist_sub;
+    return (uint64_t(1) << exp) + (uint64_t(sub) << (exp - 3));
+  }
+
+  struct TypeCensus {
+    uint64_t chunks = 0;  // Number of chunks of this type.
+    uint64_t files  = 0;  // Number of files with at least one.
+    uint64_t bytes  = 0;  // Total payload bytes.
+    uint32_t min    = std::numeric_limits<uint32_t>::max();
+    uint32_t max    = 0;
+    bool known      = true;
+    std::array<uint64_t, hist_buckets> hist{};
+
+    auto merge(const TypeCensus& other) -> void {
+      chunks += other.chunks;
+      files  += other.files;
+      bytes  += other.bytes;
+      min     = std::min(min, other.min);
+      max     = std::max(max, other.max);
+      known   = other.known;
+      for(size_t i = 0; i < hist.size(); i++) hist[i] += other.hist[i];
+    }
+
+    [[nodiscard]] auto percentile(const double p) const -> uint64_t {
+      // Nearest-rank.
+      const auto rank   = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(chunks)));
+      const auto target = std::max<uint64_t>(rank, 1) - 1;
+      uint64_t seen = 0;
+      for(size_t i = 0; i < hist.size(); i++) {
+        seen += hist[i];
+        if(seen > target) {
+          return std::clamp<uint64_t>(bucket_floor(i), min, max);
+        }
+      }
+      return max;
+    }
+  };
+
+  struct ThreadCensus {
+    std::unordered_map<uint32_t, TypeCensus> types;
+    uint64_t files           = 0;
+    uint64_t file_bytes      = 0;
+    uint64_t ancillary_bytes = 0;  // Including chunk headers and CRCs.
+    double   ancillary_frac  = 0;  // Sum of per-file fractions.
+    double   ancillary_max   = 0;  // Largest per-file fraction.
+  };
+
+  struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadCensus>> threads;
+  };
+
+  auto registry() -> Registry& {
+    static Registry reg;
+    return reg;
+  }
+
+  auto local() -> ThreadCensus& {
+    thread_local ThreadCensus* tls = nullptr;
+    if(tls == nullptr) {
+      auto& reg = registry();
+      std::lock_guard guard(reg.lock);
+      tls = reg.threads.emplace_back(std::make_unique<ThreadCensus>()).get();
+    }
+    return *tls;
+  }
+
+  auto fourcc_of(const std::string& type) -> uint32_t {
+    return uint32_t(uint8_t(type.at(0))) << 24
+      | uint32_t(uint8_t(type.at(1))) << 16
+      | uint32_t(uint8_t(type.at(2))) << 8
+      | uint32_t(uint8_t(type.at(3)));
+  }
+
+  auto fourcc_string(const uint32_t cc) -> std::string {
+    std::string str;
+    for(const int shift : { 24, 16, 8, 0 }) {
+      const auto ch = static_cast<char>((cc >> shift) & 0xFF);
+      str += ch >= 32 && ch <= 126 ? ch : '?';
+    }
+    return str;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Census::add(const Carrier& carrier) -> void {
+  auto& tc = local();
+  uint64_t ancillary = 0;
+
+  // Types already counted for this file. Files rarely have
+  // more than a dozen distinct types, a linear scan is fine.
+  std::vector<uint32_t> seen;
+  seen.reserve(16);
+
+  for(const auto& chunk : carrier.chunks()) {
+    const auto cc  = fourcc_of(chunk.type_string());
+    const auto len = chunk.length();
+    auto& ty = tc.types[cc];
+
+    ty.chunks += 1;
+    ty.bytes  += len;
+    ty.min     = std::min(ty.min, len);
+    ty.max     = std::max(ty.max, len);
+    ty.known   = chunk.type() != Chunk::Type::Unknown;
+    ty.hist[bucket_of(len)] += 1;
+
+    if(std::ranges::find(seen, cc) == seen.end()) {
+      seen.emplace_back(cc);
+      ty.files += 1;
+    } if(cc & 0x20000000U) {
+      // Lowercase first letter: ancillary.
+      ancillary += sizeof(Chunk::Header) + len + sizeof(uint32_t);
+    }
+  }
+
+  const auto frac = static_cast<double>(ancillary) / static_cast<double>(carrier.size());
+  tc.files           += 1;
+  tc.file_bytes      += carrier.size();
+  tc.ancillary_bytes += ancillary;
+  tc.ancillary_frac  += frac;
+  tc.ancillary_max    = std::max(tc.ancillary_max, frac);
+}
+
+auto spng::Census::print_report() -> void {
+  auto& reg = registry();
+  std::lock_guard guard(reg.lock);
+
+  ThreadCensus total;
+  for(const auto& tc : reg.threads) {
+    for(const auto& [cc, ty] : tc->types) {
+      total.types[cc].merge(ty);
+    }
+    total.files           += tc->files;
+    total.file_bytes      += tc->file_bytes;
+    total.ancillary_bytes += tc->ancillary_bytes;
+    total.ancillary_frac  += tc->ancillary_frac;
+    total.ancillary_max    = std::max(total.ancillary_max, tc->ancillary_max);
+  }
+
+  // Most common types first.
+  std::vector<std::pair<uint32_t, const TypeCensus*>> rows;
+  for(const auto& [cc, ty] : total.types) {
+    rows.emplace_back(cc, &ty);
+  }
+  std::ranges::sort(rows, [](const auto& a, const auto& b) {
+    return a.second->files != b.second->files
+      ? a.second->files > b.second->files
+      : a.first < b.first;
+  });
+
+  std::print("-- ");
+  set_console(ConFg::Magenta);
+  set_console(ConStyle::Bold);
+  std::println("Chunk Census:");
+  reset_console();
+
+  set_console(ConFg::White);
+  set_console(ConStyle::Bold);
+  std::println("{:<5} {:>10} {:>11} {:>14} {:>10} {:>10} {:>10} {:>10} {:>10}",
+    "Type", "Files", "Chunks", "Bytes", "Min", "p50", "p90", "p99", "Max");
+  reset_console();
+  std::println("{:=<5} {:=>10} {:=>11} {:=>14} {:=>10} {:=>10} {:=>10} {:=>10} {:=>10}",
+    "=", "=", "=", "=", "=", "=", "=", "=", "=");
+
+  std::vector<std::string> unknown;
+  for(const auto& [cc, ty] : rows) {
+    const auto name = fourcc_string(cc);
+    if(!ty->known) {
+      unknown.emplace_back(name);
+    }
+
+    set_console(ty->known ? ConFg::Magenta : ConFg::Red);
+    std::print("{:<5} ", name);
+    reset_console();
+    std::println("{:>10} {:>11} {:>14} {:>10} {:>10} {:>10} {:>10} {:>10}",
+      ty->files,
+      ty->chunks,
+      ty->bytes,
+      ty->min,
+      ty->percentile(50),
+      ty->percentile(90),
+      ty->percentile(99),
+      ty->max);
+  }
+
+  auto display_value = [&]<typename T>(const std::string_view name, T&& val) -> void {
+    set_console(ConFg::Yellow);
+    std::print("{:<18} ", name);
+    reset_console();
+    std::println(": {}", val);
+  };
+
+  const auto files = static_cast<double>(std::max<uint64_t>(1, total.files));
+  const auto bytes = static_cast<double>(std::max<uint64_t>(1, total.file_bytes));
+
+  std::println("");
+  display_value("Files", total.files);
+  display_value("Total Bytes", total.file_bytes);
+  display_value("Ancillary Bytes", total.ancillary_bytes);
+  display_value("Ancillary Share", fmt("{:.2f}% of all bytes, {:.2f}% per file on average, {:.2f}% max",
+    static_cast<double>(total.ancillary_bytes) * 100.0 / bytes,
+    total.ancillary_frac * 100.0 / files,
+    total.ancillary_max * 100.0));
+
+  std::string unknown_list;
+  for(const auto& name : unknown) {
+    unknown_list += unknown_list.empty() ? name : ", " + name;
+  }
+  display_value("Unknown Types", unknown.empty() ? "None" : unknown_list);
+  std::println("(percentiles are approximate, within 12.5%)\n");
+}
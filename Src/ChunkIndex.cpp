@@ -0,0 +1,242 @@
+#include <ChunkIndex.hpp>
+#include <Fmt.hpp>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+
+static auto align8(const uint64_t val) -> uint64_t {
+  return (val + 7) & ~uint64_t(7);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::ChunkIndex::Writer::add(const std::string& path, const Carrier& carrier) -> void {
+  // Gather everything for this file first, so
+  // the lock is only held for the appends.
+  const auto& chunks = carrier.chunks();
+  std::vector<uint32_t> fourcc;
+  std::vector<uint64_t> offset;
+  std::vector<uint32_t> length;
+  std::vector<uint32_t> crc;
+  std::vector<uint8_t>  status;
+
+  for(const auto& chunk : chunks) {
+    const auto type_str = chunk.type_string();
+    const uint32_t cc = {
+      uint32_t(uint8_t(type_str.at(0))) << 24
+      | uint32_t(uint8_t(type_str.at(1))) << 16
+      | uint32_t(uint8_t(type_str.at(2))) << 8
+      | uint32_t(uint8_t(type_str.at(3)))
+    };
+
+    uint8_t st = None;
+    if(chunk.crc_ok())                       st |= CrcOk;
+    if(chunk.type() != Chunk::Type::Unknown) st |= Known;
+    if((cc & 0x20000000U) == 0)              st |= Critical;
+
+    fourcc.emplace_back(cc);
+    offset.emplace_back(chunk.offset_);
+    length.emplace_back(chunk.length());
+    crc.emplace_back(chunk.checksum());
+    status.emplace_back(st);
+  }
+
+  std::lock_guard guard(lock_);
+  FileRecord rec = {};
+  rec.path_offset = strings_.size();
+  rec.path_length = static_cast<uint32_t>(path.size());
+  rec.chunk_count = static_cast<uint32_t>(chunks.size());
+  rec.first_chunk = fourcc_.size();
+  rec.file_size   = carrier.size();
+
+  strings_.append(path);
+  files_.emplace_back(rec);
+  fourcc_.insert(fourcc_.end(), fourcc.begin(), fourcc.end());
+  offset_.insert(offset_.end(), offset.begin(), offset.end());
+  length_.insert(length_.end(), length.begin(), length.end());
+  crc_.insert(crc_.end(), crc.begin(), crc.end());
+  status_.insert(status_.end(), status.begin(), status.end());
+}
+
+auto spng::ChunkIndex::Writer::write(const std::string& out_path) const -> void {
+  std::lock_guard guard(lock_);
+  const uint64_t n = fourcc_.size();
+
+  Header hdr = {};
+  std::memcpy(hdr.magic, magic, sizeof(magic));
+  hdr.version        = version;
+  hdr.num_files      = files_.size();
+  hdr.num_chunks     = n;
+  hdr.files_offset   = align8(sizeof(Header));
+  hdr.fourcc_offset  = align8(hdr.files_offset + files_.size() * sizeof(FileRecord));
+  hdr.offset_offset  = align8(hdr.fourcc_offset + n * sizeof(uint32_t));
+  hdr.length_offset  = align8(hdr.offset_offset + n * sizeof(uint64_t));
+  hdr.crc_offset     = align8(hdr.length_offset + n * sizeof(uint32_t));
+  hdr.status_offset  = align8(hdr.crc_offset + n * sizeof(uint32_t));
+  hdr.strings_offset = align8(hdr.status_offset + n * sizeof(uint8_t));
+  hdr.strings_size   = strings_.size();
+
+  std::ofstream of(out_path, std::ios::binary | std::ios::trunc);
+  if(!of.is_open()) {
+    throw std::ios_base::failure(fmt("Failed to open output file \"{}\".", out_path));
+  }
+
+  uint64_t written = 0;
+  auto pad_to = [&](const uint64_t off) -> void {
+    constexpr char zeroes[8] = {};
+    if(off > written) {
+      of.write(zeroes, static_cast<std::streamsize>(off - written));
+      written = off;
+    }
+  };
+
+  auto put = [&]<typename T>(const T val) -> void {
+    const T le = maybe_bitswap(val, Endian::Little);
+    of.write(reinterpret_cast<const char*>(&le), sizeof(T));
+    written += sizeof(T);
+  };
+
+  // Header
+  of.write(hdr.magic, sizeof(hdr.magic));
+  written += sizeof(hdr.magic);
+  put(hdr.version);
+  put(hdr.reserved);
+  put(hdr.num_files);
+  put(hdr.num_chunks);
+  put(hdr.files_offset);
+  put(hdr.fourcc_offset);
+  put(hdr.offset_offset);
+  put(hdr.length_offset);
+  put(hdr.crc_offset);
+  put(hdr.status_offset);
+  put(hdr.strings_offset);
+  put(hdr.strings_size);
+
+  // File records
+  pad_to(hdr.files_offset);
+  for(const auto& rec : files_) {
+    put(rec.path_offset);
+    put(rec.path_length);
+    put(rec.chunk_count);
+    put(rec.first_chunk);
+    put(rec.file_size);
+  }
+
+  // Columns
+  pad_to(hdr.fourcc_offset);
+  for(const auto val : fourcc_) put(val);
+  pad_to(hdr.offset_offset);
+  for(const auto val : offset_) put(val);
+  pad_to(hdr.length_offset);
+  for(const auto val : length_) put(val);
+  pad_to(hdr.crc_offset);
+  for(const auto val : crc_) put(val);
+  pad_to(hdr.status_offset);
+  for(const auto val : status_) put(val);
+
+  // String table
+  pad_to(hdr.strings_offset);
+  of.write(strings_.data(), static_cast<std::streamsize>(strings_.size()));
+
+  of.flush();
+  if(!of.good()) {
+    throw std::ios_base::failure(fmt("Failed to write \"{}\".", out_path));
+  }
+}
+
+auto spng::ChunkIndex::Writer::num_files() const -> size_t {
+  std::lock_guard guard(lock_);
+  return files_.size();
+}
+
+auto spng::ChunkIndex::Writer::num_chunks() const -> size_t {
+  std::lock_guard guard(lock_);
+  return fourcc_.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+spng::ChunkIndex::Reader::Reader(const std::string& in_path)
+  : map_(in_path) {
+  const auto bytes = map_.bytes();
+  if(bytes.size() < sizeof(Header)) {
+    throw std::runtime_error("Chunk index is too small.");
+  }
+
+  std::memcpy(&header_, bytes.data(), sizeof(Header));
+  if(std::memcmp(header_.magic, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Invalid chunk index signature.");
+  }
+
+  auto& h = header_;
+  h.version        = maybe_bitswap(h.version, Endian::Little);
+  h.num_files      = maybe_bitswap(h.num_files, Endian::Little);
+  h.num_chunks     = maybe_bitswap(h.num_chunks, Endian::Little);
+  h.files_offset   = maybe_bitswap(h.files_offset, Endian::Little);
+  h.fourcc_offset  = maybe_bitswap(h.fourcc_offset, Endian::Little);
+  h.offset_offset  = maybe_bitswap(h.offset_offset, Endian::Little);
+  h.length_offset  = maybe_bitswap(h.length_offset, Endian::Little);
+  h.crc_offset     = maybe_bitswap(h.crc_offset, Endian::Little);
+  h.status_offset  = maybe_bitswap(h.status_offset, Endian::Little);
+  h.strings_offset = maybe_bitswap(h.strings_offset, Endian::Little);
+  h.strings_size   = maybe_bitswap(h.strings_size, Endian::Little);
+
+  if(h.version != version) {
+    throw std::runtime_error(fmt("Unsupported chunk index version ({}).", h.version));
+  }
+
+  // Validate every section once, up front. After this
+  // the accessors only need to check the element index.
+  auto check_section = [&](const uint64_t off, const uint64_t count, const uint64_t width) -> void {
+    if(count != 0 && (count > bytes.size() / width || off > bytes.size() - count * width)) {
+      throw std::runtime_error("Chunk index is truncated or corrupted.");
+    }
+  };
+
+  check_section(h.files_offset,   h.num_files,    sizeof(FileRecord));
+  check_section(h.fourcc_offset,  h.num_chunks,   sizeof(uint32_t));
+  check_section(h.offset_offset,  h.num_chunks,   sizeof(uint64_t));
+  check_section(h.length_offset,  h.num_chunks,   sizeof(uint32_t));
+  check_section(h.crc_offset,     h.num_chunks,   sizeof(uint32_t));
+  check_section(h.status_offset,  h.num_chunks,   sizeof(uint8_t));
+  check_section(h.strings_offset, h.strings_size, sizeof(char));
+}
+
+auto spng::ChunkIndex::Reader::file(const uint64_t i) const -> File {
+  if(i >= header_.num_files) {
+    throw std::out_of_range("File index out of range.");
+  }
+
+  FileRecord rec = {};
+  std::memcpy(&rec, map_.bytes().data() + header_.files_offset + i * sizeof(FileRecord), sizeof(FileRecord));
+  rec.path_offset = maybe_bitswap(rec.path_offset, Endian::Little);
+  rec.path_length = maybe_bitswap(rec.path_length, Endian::Little);
+  rec.chunk_count = maybe_bitswap(rec.chunk_count, Endian::Little);
+  rec.first_chunk = maybe_bitswap(rec.first_chunk, Endian::Little);
+  rec.file_size   = maybe_bitswap(rec.file_size, Endian::Little);
+
+  if(rec.path_offset > header_.strings_size
+    || rec.path_length > header_.strings_size - rec.path_offset
+    || rec.first_chunk > header_.num_chunks
+    || rec.chunk_count > header_.num_chunks - rec.first_chunk) {
+    throw std::runtime_error(fmt("Corrupted chunk index record ({}).", i));
+  }
+
+  const auto* strings = reinterpret_cast<const char*>(map_.bytes().data() + header_.strings_offset);
+  return File {
+    .path        = { strings + rec.path_offset, rec.path_length },
+    .first_chunk = rec.first_chunk,
+    .chunk_count = rec.chunk_count,
+    .file_size   = rec.file_size,
+  };
+}
+
+auto spng::ChunkIndex::Reader::type_string(const uint64_t i) const -> std::string {
+  const auto cc = fourcc(i);
+  return {
+    char(cc >> 24),
+    char((cc >> 16) & 0xFF),
+    char((cc >> 8) & 0xFF),
+    char(cc & 0xFF),
+  };
+}
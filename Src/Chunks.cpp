@@ -4,6 +4,8 @@
 #include <Defer.hpp>
 #include <HexDump.hpp>
 #include <Fmt.hpp>
+#include <Crc.hpp>
+#include <Inflate.hpp>
 #include <unordered_map>
 #include <algorithm>
 #include <ranges>
@@ -14,6 +16,21 @@
 #include <fstream>
 #include <ios>
 
+auto spng::Chunk::_lock() const -> FlatBuffer::Pin {
+  // Borrowed bytes: the caller promised they outlive us,
+  // so there's nothing to lock.
+  if(view_.data() != nullptr) {
+    return FlatBuffer::Pin(view_);
+  }
+
+  auto owner = buff_.lock();
+  if(!owner) {
+    return {};
+  }
+
+  return FlatBuffer::Pin(std::move(owner));
+}
+
 auto spng::Chunk::_throw_bad_chunk() const -> void {
   std::string buff;
   buff.append("This PNG has a corrupted or invalid chunk, ");
@@ -34,7 +51,7 @@ auto spng::Chunk::type() const -> Type {
 
 auto spng::Chunk::type_string() const -> std::string {
   char type_arr[5] = { 0 };
-  const auto ptr   = buff_.lock();
+  const auto ptr   = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -58,7 +75,7 @@ auto spng::Chunk::type_string() const -> std::string {
 
 auto spng::Chunk::checksum() const -> uint32_t {
   uint32_t the_checksum = 0;
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -67,9 +84,9 @@ auto spng::Chunk::checksum() const -> uint32_t {
   }
 
   try {
-    const auto header  = reinterpret_cast<Header*>(&ptr->at(offset_));
+    const auto header  = reinterpret_cast<const Header*>(&ptr->at(offset_));
     const auto ch_len  = maybe_bitswap(header->length, Endian::Big);
-    const auto address = reinterpret_cast<uint32_t*>(&ptr->at(
+    const auto address = reinterpret_cast<const uint32_t*>(&ptr->at(
       + offset_
       + sizeof(Header)
       + ch_len
@@ -87,7 +104,7 @@ auto spng::Chunk::checksum() const -> uint32_t {
     if(crc_last_byte >= ptr->size()) {
       throw std::out_of_range("-");
     }
-    the_checksum = *address;
+    the_checksum = maybe_bitswap(*address, Endian::Big);
   } catch(const std::out_of_range& _) {
     _throw_bad_chunk();
   }
@@ -95,6 +112,35 @@ auto spng::Chunk::checksum() const -> uint32_t {
   return the_checksum;
 }
 
+auto spng::Chunk::computed_checksum() const -> uint32_t {
+  const auto len = length();
+  const auto ptr = _lock();
+
+  // The CRC covers the chunk type and data,
+  // but not the length field.
+  const size_t last_byte {
+    + offset_
+    + sizeof(Header)
+    + len
+    - 1
+  };
+
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(last_byte >= ptr->size()) {
+    _throw_bad_chunk();
+  }
+
+  return crc32({
+    ptr->data() + offset_ + sizeof(Header::length),
+    len + sizeof(Header::type)
+  });
+}
+
+auto spng::Chunk::crc_ok() const -> bool {
+  return computed_checksum() == checksum();
+}
+
 auto spng::Chunk::_default_print_impl() const -> void {
   std::string type_name;
   std::string type_desc;
@@ -145,7 +191,7 @@ auto spng::Chunk::_default_print_impl() const -> void {
   set_console(ConFg::Yellow);
   std::print("{:<12} ", "CRC32");
   reset_console();
-  std::println(": {:4X}", checksum());
+  std::println(": {:08X}", checksum());
 }
 
 auto spng::Chunk::print() const -> void {
@@ -156,6 +202,8 @@ auto spng::Chunk::print() const -> void {
     case Type::gAMA: as<Gama>().print(); return;
     case Type::cHRM: as<Chrm>().print(); return;
     case Type::hIST: as<Hist>().print(); return;
+    case Type::tRNS: as<Trns>().print(); return;
+    case Type::iCCP: as<Iccp>().print(); return;
     case Type::PLTE: as<Plte>().print(); return;
     case Type::tIME: as<Time>().print(); return;
     case Type::sPLT: as<Splt>().print(); return;
@@ -171,7 +219,7 @@ auto spng::Chunk::print() const -> void {
 
 auto spng::Chunk::hexdump() const -> void {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -193,7 +241,7 @@ auto spng::Chunk::hexdump() const -> void {
 
 auto spng::Chunk::extract_to(const std::string& name) const -> void {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -326,6 +374,19 @@ auto spng::Hist::print() const -> void {
   std::println(": {}\n", num_entries());
 }
 
+auto spng::Trns::print() const -> void {
+  _default_print_impl();
+  const auto alpha = palette_alpha();
+  const auto transparent = std::ranges::count(alpha, 0);
+
+  // Only meaningful for indexed images, but
+  // the chunk doesn't know what it belongs to.
+  set_console(ConFg::Yellow);
+  std::print("{:<12} ", "Entries");
+  reset_console();
+  std::println(": {} ({} fully transparent, if indexed)\n", alpha.size(), transparent);
+}
+
 void spng::Text::print() const {
   _default_print_impl();
   set_console(ConFg::Yellow);
@@ -345,9 +406,61 @@ auto spng::Splt::print() const -> void {
     std::println(": {}", val);
   };
 
+  const Table table = entries();
+  display_value("Name", table.name);
+  display_value("Sample Depth", (uint16_t)table.sample_depth);
+  display_value("Entries", table.size());
+
+  // The few most frequent suggestions, as RGBA.
+  std::vector<size_t> order(table.size());
+  for(size_t i = 0; i < order.size(); i++) order[i] = i;
+  const size_t shown = std::min<size_t>(order.size(), 4);
+  std::ranges::partial_sort(order, order.begin() + static_cast<ptrdiff_t>(shown), [&](const size_t a, const size_t b) {
+    return table.frequency[a] > table.frequency[b];
+  });
+
+  const int width = table.sample_depth == 8 ? 2 : 4;
+  for(size_t i = 0; i < shown; i++) {
+    const size_t e = order[i];
+    display_value(i == 0 ? "Top Entries" : "", fmt("#{:0{}X}{:0{}X}{:0{}X}{:0{}X} ({})",
+      table.red[e], width,
+      table.green[e], width,
+      table.blue[e], width,
+      table.alpha[e], width,
+      table.frequency[e]));
+  }
+  std::println("");
+}
+
+auto spng::Iccp::print() const -> void {
+  _default_print_impl();
+  auto display_value = [&]<typename T>(
+    const std::string& name, T&& val ) -> void
+  {
+    set_console(ConFg::Yellow);
+    std::print("{:<12} ", name);
+    reset_console();
+    std::println(": {}", val);
+  };
+
+  const auto data = profile_data();
+  const auto prof = parse_profile(data);
+
+  std::string id;
+  for(const uint8_t byte : prof.id) id += fmt("{:02x}", byte);
+  if(std::ranges::all_of(prof.id, [](const uint8_t b) { return b == 0; })) id = "None";
+
   display_value("Name", name());
-  display_value("Sample Depth", (uint16_t)sample_depth());
-  display_value("Entries", num_entries());
+  display_value("Size", fmt("{} bytes ({} compressed)", data.size(), length() - compressed_offset()));
+  if(!prof.size_ok) {
+    display_value("Header Size", fmt("{} bytes (mismatch)", prof.size));
+  }
+  display_value("Version", fmt("{}.{}", prof.version_major, prof.version_minor));
+  display_value("Class", prof.device_class);
+  display_value("Color Space", prof.color_space);
+  display_value("PCS", prof.pcs);
+  display_value("CMM", prof.cmm.empty() ? "None" : prof.cmm);
+  display_value("Profile ID", id);
   std::println("");
 }
 
@@ -489,7 +602,7 @@ auto spng::Phys::print() const -> void {
 
 auto spng::Chunk::length() const -> uint32_t {
   uint32_t the_length = 0;
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -498,7 +611,7 @@ auto spng::Chunk::length() const -> uint32_t {
   }
 
   try {
-    auto* header = reinterpret_cast<Header*>(&ptr->at(offset_));
+    auto* header = reinterpret_cast<const Header*>(&ptr->at(offset_));
     the_length   = header->length;
   } catch(const std::out_of_range& _) {
     _throw_bad_chunk();
@@ -509,7 +622,7 @@ auto spng::Chunk::length() const -> uint32_t {
 }
 
 auto spng::Chunk::next() const -> std::optional<Chunk> {
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   Chunk chunk;
 
   if(!ptr) {
@@ -521,7 +634,7 @@ auto spng::Chunk::next() const -> std::optional<Chunk> {
   }
 
   try {
-    const auto* header = reinterpret_cast<Header*>(&ptr->at(offset_));
+    const auto* header = reinterpret_cast<const Header*>(&ptr->at(offset_));
     const auto  length = maybe_bitswap(header->length, Endian::Big);
     const size_t ch_offset {
       + offset_           // Offset to the chunk header
@@ -534,7 +647,8 @@ auto spng::Chunk::next() const -> std::optional<Chunk> {
       return std::nullopt;
     }
 
-    chunk.buff_ = ptr;
+    chunk.buff_    = buff_;
+    chunk.view_    = view_;
     chunk.offset_  = ch_offset;
   } catch(const std::out_of_range& _) {
     _throw_bad_chunk();
@@ -547,7 +661,7 @@ auto spng::Ihdr::bit_depth() const -> uint8_t {
   ASSERT(type() == Type::IHDR);
   uint8_t the_bit_depth = 0;
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -577,7 +691,7 @@ auto spng::Ihdr::bit_depth() const -> uint8_t {
 
 auto spng::Ihdr::color_type() const -> ColorType {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -615,7 +729,7 @@ auto spng::Ihdr::color_type() const -> ColorType {
 auto spng::Ihdr::width() const -> uint32_t {
   uint32_t the_width = 0;
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -646,7 +760,7 @@ auto spng::Ihdr::width() const -> uint32_t {
 auto spng::Ihdr::height() const -> uint32_t {
   uint32_t the_height = 0;
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -676,7 +790,7 @@ auto spng::Ihdr::height() const -> uint32_t {
 
 auto spng::Ihdr::interlace_method() const -> Interlace {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -710,7 +824,7 @@ auto spng::Ihdr::interlace_method() const -> Interlace {
 
 auto spng::Ihdr::compression_method() const -> Compression {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -745,7 +859,7 @@ auto spng::Ihdr::compression_method() const -> Compression {
 
 auto spng::Ihdr::filter_method() const -> FilterMethod {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
@@ -780,7 +894,7 @@ auto spng::Ihdr::filter_method() const -> FilterMethod {
 
 auto spng::Srgb::intent() const -> RenderingIntent {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   uint8_t the_intent = 4;
 
   if(!ptr) {
@@ -805,7 +919,7 @@ auto spng::Phys::ppu() const -> std::array<uint32_t, 2> {
   std::array<uint32_t, 2> the_ppus{0, 0};
 
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -832,7 +946,7 @@ auto spng::Phys::ppu() const -> std::array<uint32_t, 2> {
 auto spng::Phys::units() const -> Units {
   auto the_units = Units::Invalid;
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -867,7 +981,7 @@ auto spng::Phys::units() const -> Units {
 
 auto spng::Gama::gamma() const -> double {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -898,7 +1012,7 @@ auto spng::Gama::gamma() const -> double {
 
 auto spng::Chrm::values() const -> ConvertedLayout {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -974,9 +1088,160 @@ auto spng::Hist::num_entries() const -> size_t {
   return len / 2;
 }
 
+auto spng::Plte::entries() const -> std::vector<Entry> {
+  const auto count = num_entries();
+  const auto ptr   = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(offset_ + sizeof(Header) + count * 3 > ptr->size()) {
+    throw std::runtime_error("Invalid PLTE chunk size.");
+  }
+
+  std::vector<Entry> the_entries(count);
+  std::memcpy(the_entries.data(), ptr->data() + offset_ + sizeof(Header), count * sizeof(Entry));
+  return the_entries;
+}
+
+auto spng::Hist::frequencies() const -> std::vector<uint16_t> {
+  const auto count = num_entries();
+  const auto ptr   = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(offset_ + sizeof(Header) + count * 2 > ptr->size()) {
+    throw std::runtime_error("Invalid hIST chunk size.");
+  }
+
+  std::vector<uint16_t> the_freqs(count);
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  for(size_t i = 0; i < count; i++) {
+    the_freqs[i] = static_cast<uint16_t>(data[i * 2] << 8 | data[i * 2 + 1]);
+  }
+  return the_freqs;
+}
+
+auto spng::Trns::palette_alpha() const -> std::vector<uint8_t> {
+  const auto len = length();
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(len > 256 || offset_ + sizeof(Header) + len > ptr->size()) {
+    throw std::runtime_error("Invalid tRNS chunk size.");
+  }
+
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  return { data, data + len };
+}
+
+auto spng::Trns::gray_key() const -> uint16_t {
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(length() != 2 || offset_ + sizeof(Header) + 2 > ptr->size()) {
+    throw std::runtime_error("Invalid tRNS chunk size.");
+  }
+
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  return static_cast<uint16_t>(data[0] << 8 | data[1]);
+}
+
+auto spng::Trns::rgb_key() const -> std::array<uint16_t, 3> {
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(length() != 6 || offset_ + sizeof(Header) + 6 > ptr->size()) {
+    throw std::runtime_error("Invalid tRNS chunk size.");
+  }
+
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  return {
+    static_cast<uint16_t>(data[0] << 8 | data[1]),
+    static_cast<uint16_t>(data[2] << 8 | data[3]),
+    static_cast<uint16_t>(data[4] << 8 | data[5]),
+  };
+}
+
+auto spng::Iccp::compressed_offset() const -> size_t {
+  const auto len = length();
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  } if(len == 0 || offset_ + sizeof(Header) + len > ptr->size()) {
+    throw std::runtime_error("Invalid iCCP chunk size.");
+  }
+
+  // Name: 1-79 bytes, a null terminator, then
+  // the compression method, which must be 0.
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  const auto* nul  = static_cast<const uint8_t*>(std::memchr(data, '\0', std::min<size_t>(len, 80)));
+  if(nul == nullptr || nul == data || size_t(nul - data) + 2 > len || nul[1] != 0) {
+    _throw_bad_chunk();
+  }
+
+  return static_cast<size_t>(nul - data) + 2;
+}
+
+auto spng::Iccp::name() const -> std::string {
+  const size_t start = compressed_offset();
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  }
+  return { reinterpret_cast<const char*>(ptr->data()) + offset_ + sizeof(Header), start - 2 };
+}
+
+auto spng::Iccp::profile_data() const -> FlatBuffer::Buffer {
+  // Real profiles are rarely more than a few MiB,
+  // anything past this is treated as a zip bomb.
+  constexpr size_t max_profile = size_t(64) << 20;
+
+  const size_t start = compressed_offset();
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  }
+
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  return inflate_zlib({ data + start, length() - start }, max_profile);
+}
+
+auto spng::Iccp::profile() const -> Profile {
+  return parse_profile(profile_data());
+}
+
+auto spng::Iccp::parse_profile(const std::span<const uint8_t> data) -> Profile {
+  // ICC.1 section 7.2: 128 byte header, big-endian,
+  // with the "acsp" signature at offset 36.
+  if(data.size() < 128 || std::memcmp(data.data() + 36, "acsp", 4) != 0) {
+    throw std::runtime_error("iCCP chunk does not contain an ICC profile.");
+  }
+
+  auto tag = [&](const size_t at) -> std::string {
+    std::string str;
+    for(size_t i = at; i < at + 4; i++) {
+      const auto ch = static_cast<char>(data[i]);
+      str += ch >= 32 && ch <= 126 ? ch : '?';
+    }
+    return data[at] == 0 && data[at + 1] == 0 && data[at + 2] == 0 && data[at + 3] == 0 ? std::string() : str;
+  };
+
+  Profile prof;
+  prof.size          = uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+  prof.cmm           = tag(4);
+  prof.version_major = data[8];
+  prof.version_minor = data[9] >> 4;
+  prof.device_class  = tag(12);
+  prof.color_space   = tag(16);
+  prof.pcs           = tag(20);
+  std::memcpy(prof.id.data(), data.data() + 84, prof.id.size());
+
+  // Some writers get this wrong, but the profile is still usable.
+  prof.size_ok = prof.size == data.size();
+  return prof;
+}
+
 auto spng::Time::values() const -> Layout {
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   Layout the_layout = { 0 };
   const size_t last_byte {
@@ -1006,125 +1271,119 @@ auto spng::Time::values() const -> Layout {
   return the_layout;
 }
 
-auto spng::Splt::name() const -> std::string {
+auto spng::Splt::_layout(const FlatBuffer::View& view, uint8_t& depth, size_t& count) const -> size_t {
   const auto len = length();
-  const auto ptr = buff_.lock();
-  const size_t last_byte {
-    + offset_
-    + sizeof(Header)
-    + (len - 1)
-  };
-
-  std::string the_name;
-  the_name.reserve(79);
-
-  if(!ptr) {
-    throw std::runtime_error("Invalid file buffer.");
-  } if(last_byte >= ptr->size()) {
+  const size_t start = offset_ + sizeof(Header);
+  if(len == 0 || start + len > view.size()) {
     throw std::runtime_error("Invalid sPLT chunk size.");
   }
 
-  try {
-    size_t i = offset_ + sizeof(Header);
-    while(ptr->at(i) != '\0') {
-      if(the_name.size() > 79 || i >= last_byte) {
-        // laziness
-        throw std::exception();
-      }
-      the_name += (char)ptr->at(i);
-      ++i;
-    }
+  // Name: 1-79 bytes, then a null terminator.
+  const auto* data = reinterpret_cast<const uint8_t*>(view.data()) + start;
+  const auto* nul  = static_cast<const uint8_t*>(std::memchr(data, '\0', std::min<size_t>(len, 80)));
+  if(nul == nullptr || nul == data) {
+    _throw_bad_chunk();
+  }
 
-    if(the_name.empty()) {
-      throw std::exception();
-    }
-  } catch(const std::exception& _) {
+  // The only permitted sample depths are 8 and 16,
+  // and the rest of the chunk must be whole entries:
+  // 4 samples plus a 2 byte frequency.
+  const auto name_len  = static_cast<size_t>(nul - data);
+  const size_t remaining = len - name_len - 1;
+  if(remaining == 0) {
+    _throw_bad_chunk();
+  }
+
+  depth = data[name_len + 1];
+  const size_t entry_size = depth == 8 ? 6 : 10;
+  if((depth != 8 && depth != 16) || (remaining - 1) % entry_size != 0) {
     _throw_bad_chunk();
   }
 
-  return the_name;
+  count = (remaining - 1) / entry_size;
+  return name_len;
 }
 
-auto spng::Splt::sample_depth() const -> uint8_t {
-  const auto len = length();
-  const auto nme = name();
-  const auto ptr = buff_.lock();
-  uint8_t the_sample_depth = 0;
-
-  // The offset to the sample depth byte.
-  // We add the offset to the start of the
-  // chunk header, plus the header size,
-  // plus the size of the chunk's name,
-  // and account for the null terminator after that.
-  const size_t the_offset {
-    + offset_
-    + sizeof(Header)
-    + nme.size()
-    + 1
-  };
+auto spng::Splt::name() const -> std::string {
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  }
 
-  // Get the offset to the last byte
-  // of the chunk, as per usual.
-  const size_t last_byte {
-    + offset_
-    + sizeof(Header)
-    + (len - 1)
-  };
+  uint8_t depth = 0;
+  size_t count  = 0;
+  const size_t name_len = _layout(*ptr, depth, count);
+  return { reinterpret_cast<const char*>(ptr->data()) + offset_ + sizeof(Header), name_len };
+}
 
+auto spng::Splt::sample_depth() const -> uint8_t {
+  const auto ptr = _lock();
   if(!ptr) {
     throw std::runtime_error("Invalid file buffer.");
-  } if(the_offset >= ptr->size() || the_offset > last_byte) {
-    throw std::runtime_error("Invalid sPLT chunk size.");
   }
 
-  try {
-    the_sample_depth = ptr->at(the_offset);
-    // The only permitted values for the
-    // sample depth byte are 8 and 16.
-    // The chunk is corrupted if this isn't the case.
-    if(the_sample_depth != 8 && the_sample_depth != 16) {
-      throw std::exception();
-    }
-  } catch(const std::exception& _) {
-    _throw_bad_chunk();
+  uint8_t depth = 0;
+  size_t count  = 0;
+  (void)_layout(*ptr, depth, count);
+  return depth;
+}
+
+auto spng::Splt::num_entries() const -> size_t {
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
   }
 
-  return the_sample_depth;
+  uint8_t depth = 0;
+  size_t count  = 0;
+  (void)_layout(*ptr, depth, count);
+  return count;
 }
 
-auto spng::Splt::num_entries() const -> size_t {
-  const auto len = length();
-  const auto nme = name();
-  const auto sd  = sample_depth();
+auto spng::Splt::entries() const -> Table {
+  const auto ptr = _lock();
+  if(!ptr) {
+    throw std::runtime_error("Invalid file buffer.");
+  }
 
-  // Calculate the remaining length of the chunk,
-  // so that we can determine the number of entries.
-  const size_t remaining_len = len - nme.size() - 2;
+  Table table;
+  size_t count = 0;
+  const size_t name_len = _layout(*ptr, table.sample_depth, count);
+  const auto* data = reinterpret_cast<const uint8_t*>(ptr->data()) + offset_ + sizeof(Header);
+  table.name.assign(reinterpret_cast<const char*>(data), name_len);
 
-  // Check if an overflow occurred.
-  if(len == 0 || remaining_len > len) {
-    _throw_bad_chunk();
+  for(auto* field : { &table.red, &table.green, &table.blue, &table.alpha, &table.frequency }) {
+    field->resize(count);
   }
 
-  // Make sure the remaining length is valid.
-  // If the sample depth is 8, it must be divisible by 6.
-  // If the sample depth is 16, it must be divisible by 10.
-  if(remaining_len == 0
-    || (sd == 16 && remaining_len % 10 != 0)
-    || (sd == 8 && remaining_len % 6 != 0)
-  ) {
-    _throw_bad_chunk();
+  // Samples are big-endian, one byte each at depth 8
+  // and two at depth 16. The frequency is always two.
+  const uint8_t* p = data + name_len + 2;
+  if(table.sample_depth == 8) {
+    for(size_t i = 0; i < count; i++, p += 6) {
+      table.red[i]       = p[0];
+      table.green[i]     = p[1];
+      table.blue[i]      = p[2];
+      table.alpha[i]     = p[3];
+      table.frequency[i] = static_cast<uint16_t>(p[4] << 8 | p[5]);
+    }
+  } else {
+    for(size_t i = 0; i < count; i++, p += 10) {
+      table.red[i]       = static_cast<uint16_t>(p[0] << 8 | p[1]);
+      table.green[i]     = static_cast<uint16_t>(p[2] << 8 | p[3]);
+      table.blue[i]      = static_cast<uint16_t>(p[4] << 8 | p[5]);
+      table.alpha[i]     = static_cast<uint16_t>(p[6] << 8 | p[7]);
+      table.frequency[i] = static_cast<uint16_t>(p[8] << 8 | p[9]);
+    }
   }
 
-  return sample_depth() == 8
-    ? remaining_len / 6
-    : remaining_len / 10;
+  return table;
 }
 
 auto spng::Text::keyword() const -> std::string {
   std::string the_keyword;
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
   const size_t last_byte {
     + offset_
     + sizeof(Header)
@@ -1163,7 +1422,7 @@ auto spng::Itxt::keyword() const -> std::string {
 auto spng::Itxt::is_compressed() const -> bool {
   const auto kw  = keyword();
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   // Get the offset to the last byte of the
   // chunk's data for sanity checking.
@@ -1207,7 +1466,7 @@ auto spng::Itxt::is_compressed() const -> bool {
 auto spng::Itxt::language_tag() const -> std::string {
   const auto kw  = keyword();
   const auto len = length();
-  const auto ptr = buff_.lock();
+  const auto ptr = _lock();
 
   // Get the offset to the last byte of the
   // chunk's data for sanity checking.
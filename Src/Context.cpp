@@ -24,11 +24,39 @@ auto spng::Context::debug_print() const -> void {
     std::print("{}, ", chunk_name);
   }
 
+  std::print("\nstrip   :: ");
+  for(const auto& chunk_name : strip_chunks_) {
+    std::print("{}, ", chunk_name);
+  }
+
+  std::print("\nindex   :: {}\n", export_index_);
+  std::print("trace   :: {}\n", trace_path_);
+  std::print("pixels  :: {}\n", raw_format_);
+  std::print("grep    :: {}\n", grep_);
+  std::print("txindex :: {}\n", text_index_);
+  std::print("query   :: {}\n", query_);
+  std::print("where   :: {}\n", where_);
+  std::print("serve   :: {}\n", serve_);
+  std::print("watch   :: {}\n", watch_);
+  std::print("jobs    :: {}\n", jobs_);
+  std::print("idat    :: {}\n", idat_size_);
+
   std::print("flags   :: ");
   std::string _flags;
   if(flags_ & NoSumm)  _flags += "NoSummary | ";
   if(flags_ & Verbose) _flags += "Verbose | ";
   if(flags_ & Silent)  _flags += "Silent | ";
+  if(flags_ & CrcCheck) _flags += "CrcCheck | ";
+  if(flags_ & Stats)   _flags += "Stats | ";
+  if(flags_ & PerfCtrs) _flags += "PerfCounters | ";
+  if(flags_ & Census)  _flags += "Census | ";
+  if(flags_ & InPlace) _flags += "InPlace | ";
+  if(flags_ & PixStats) _flags += "PixelStats | ";
+  if(flags_ & Hash)    _flags += "Hash | ";
+  if(flags_ & Palette) _flags += "Palette | ";
+  if(flags_ & Profiles) _flags += "Profiles | ";
+  if(flags_ & Carve)   _flags += "Carve | ";
+  if(flags_ & CarveOut) _flags += "CarveOut | ";
 
   if(!_flags.empty()) {
     _flags.erase(_flags.size() - 3);
@@ -0,0 +1,107 @@
+#include <Crc.hpp>
+#include <array>
+
+// Slicing-by-8: eight lookup tables, each one
+// representing the CRC contribution of a byte that is
+// N positions further back in the input. This lets us
+// consume 8 bytes per iteration instead of 1.
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+static constexpr auto make_crc_tables() -> CrcTables {
+  CrcTables tables{};
+  for(uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for(int k = 0; k < 8; k++) {
+      c = (c & 1U) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+    }
+    tables[0][i] = c;
+  }
+
+  for(uint32_t i = 0; i < 256; i++) {
+    for(size_t t = 1; t < 8; t++) {
+      const uint32_t prev = tables[t - 1][i];
+      tables[t][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+    }
+  }
+
+  return tables;
+}
+
+static constexpr CrcTables crc_tables = make_crc_tables();
+
+auto spng::crc32(const std::span<const uint8_t> bytes, const uint32_t crc) -> uint32_t {
+  const auto& t = crc_tables;
+  const uint8_t* p = bytes.data();
+  size_t left = bytes.size();
+  uint32_t c = ~crc;
+
+  while(left >= 8) {
+    const uint32_t lo = c ^ (uint32_t(p[0])
+      | uint32_t(p[1]) << 8
+      | uint32_t(p[2]) << 16
+      | uint32_t(p[3]) << 24);
+    const uint32_t hi = uint32_t(p[4])
+      | uint32_t(p[5]) << 8
+      | uint32_t(p[6]) << 16
+      | uint32_t(p[7]) << 24;
+
+    c = t[7][lo & 0xFF]
+      ^ t[6][(lo >> 8) & 0xFF]
+      ^ t[5][(lo >> 16) & 0xFF]
+      ^ t[4][lo >> 24]
+      ^ t[3][hi & 0xFF]
+      ^ t[2][(hi >> 8) & 0xFF]
+      ^ t[1][(hi >> 16) & 0xFF]
+      ^ t[0][hi >> 24];
+
+    p    += 8;
+    left -= 8;
+  }
+
+  while(left--) {
+    c = t[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+  }
+
+  return ~c;
+}
+
+auto spng::adler32(const std::span<const uint8_t> bytes, const uint32_t adler) -> uint32_t {
+  // 5552 is the largest n such that the sums
+  // can't overflow 32 bits before the modulo.
+  constexpr uint32_t base = 65521;
+  constexpr size_t nmax   = 5552;
+
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  const uint8_t* p = bytes.data();
+  size_t left = bytes.size();
+
+  while(left > 0) {
+    const size_t n = left < nmax ? left : nmax;
+    for(size_t i = 0; i < n; i++) {
+      a += p[i];
+      b += a;
+    }
+    a %= base;
+    b %= base;
+    p    += n;
+    left -= n;
+  }
+
+  return (b << 16) | a;
+}
+
+auto spng::adler32_combine(const uint32_t first, const uint32_t second, const size_t second_len) -> uint32_t {
+  // a = a1 + a2 - 1
+  // b = b1 + b2 + len2 * (a1 - 1)
+  constexpr uint32_t base = 65521;
+  const auto rem = static_cast<uint32_t>(second_len % base);
+
+  uint32_t a = (first & 0xFFFF) + (second & 0xFFFF) + base - 1;
+  uint32_t b = static_cast<uint32_t>((uint64_t(rem) * (first & 0xFFFF)) % base);
+  b += (first >> 16) + (second >> 16) + base - rem;
+
+  a %= base;
+  b %= base;
+  return (b << 16) | a;
+}
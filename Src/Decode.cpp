@@ -0,0 +1,563 @@
+#include <Decode.hpp>
+#include <Inflate.hpp>
+#include <Fmt.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <Crc.hpp>
+
+namespace {
+  // Adam7 pass origins and strides.
+  constexpr std::array<std::array<uint32_t, 4>, 7> adam7 = {{
+    { 0, 0, 8, 8 },
+    { 4, 0, 8, 8 },
+    { 0, 4, 4, 8 },
+    { 2, 0, 4, 4 },
+    { 0, 2, 2, 4 },
+    { 1, 0, 2, 2 },
+    { 0, 1, 1, 2 },
+  }};
+
+  auto channels_of(const spng::Ihdr::ColorType color) -> uint8_t {
+    using enum spng::Ihdr::ColorType;
+    switch(color) {
+      case GrayScale:      return 1;
+      case TrueColor:      return 3;
+      case IndexedColor:   return 1;
+      case GrayscaleAlpha: return 2;
+      case TruecolorAlpha: return 4;
+    }
+    return 0;
+  }
+
+  auto depth_allowed(const spng::Ihdr::ColorType color, const uint8_t depth) -> bool {
+    using enum spng::Ihdr::ColorType;
+    switch(color) {
+      case GrayScale:    return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+      case IndexedColor: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+      default:           return depth == 8 || depth == 16;
+    }
+  }
+
+  // Bytes in one stored (filtered) row of count pixels.
+  auto stored_row_bytes(const uint32_t count, const uint8_t chans, const uint8_t depth) -> size_t {
+    return (uint64_t(count) * chans * depth + 7) / 8;
+  }
+
+  auto be16(const uint8_t* p) -> uint16_t {
+    return static_cast<uint16_t>(p[0] << 8 | p[1]);
+  }
+
+  // Sample i of a row packed at less than 8 bits per sample.
+  auto packed_sample(const uint8_t* row, const size_t i, const uint8_t depth) -> uint8_t {
+    const size_t bit = i * depth;
+    return static_cast<uint8_t>((row[bit / 8] >> (8 - depth - bit % 8)) & ((1U << depth) - 1));
+  }
+
+  // The ranges of parts that cover [begin, end) of their concatenation.
+  auto slice(const std::span<const std::span<const uint8_t>> parts, size_t begin, size_t end)
+  -> std::vector<std::span<const uint8_t>> {
+    std::vector<std::span<const uint8_t>> out;
+    for(const auto& part : parts) {
+      if(begin >= part.size()) {
+        begin -= part.size();
+        end   -= part.size();
+        continue;
+      }
+
+      const size_t stop = std::min(end, part.size());
+      out.emplace_back(part.subspan(begin, stop - begin));
+      if(end <= part.size()) break;
+      begin  = 0;
+      end   -= part.size();
+    }
+    return out;
+  }
+
+  auto paeth(const int a, const int b, const int c) -> uint8_t {
+    const int p  = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if(pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if(pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::unfilter_row(const uint8_t filter,
+  const std::span<uint8_t> row,
+  const std::span<const uint8_t> prev,
+  const size_t bpp) -> void {
+  uint8_t* cur = row.data();
+  const uint8_t* up = prev.data();
+  const size_t len = row.size();
+
+  switch(filter) {
+    case 0: // None
+      break;
+    case 1: // Sub
+      for(size_t i = bpp; i < len; i++) cur[i] += cur[i - bpp];
+      break;
+    case 2: // Up
+      for(size_t i = 0; i < len; i++) cur[i] += up[i];
+      break;
+    case 3: // Average
+      for(size_t i = 0; i < bpp && i < len; i++) cur[i] += up[i] >> 1;
+      for(size_t i = bpp; i < len; i++) cur[i] += (cur[i - bpp] + up[i]) >> 1;
+      break;
+    case 4: // Paeth
+      for(size_t i = 0; i < bpp && i < len; i++) cur[i] += up[i];
+      for(size_t i = bpp; i < len; i++) cur[i] += paeth(cur[i - bpp], up[i], up[i - bpp]);
+      break;
+    default:
+      throw std::runtime_error(fmt("Invalid scanline filter type {}.", filter));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+spng::Decoder::Decoder(const Carrier& carrier, const Format format)
+  : carrier_(carrier), format_(format) {
+  const auto ihdr = carrier.metadata();
+  width_      = ihdr.width();
+  height_     = ihdr.height();
+  depth_      = ihdr.bit_depth();
+  color_      = ihdr.color_type();
+  chans_      = channels_of(color_);
+  interlaced_ = ihdr.interlace_method() == Ihdr::Interlace::Adam7;
+
+  if(width_ == 0 || height_ == 0 || width_ > 0x7FFFFFFFU || height_ > 0x7FFFFFFFU) {
+    throw std::runtime_error(fmt("Invalid image dimensions {}x{}.", width_, height_));
+  } if(!depth_allowed(color_, depth_)) {
+    throw std::runtime_error(fmt("Bit depth {} is not allowed for color type {}.", depth_, int(color_)));
+  } if(ihdr.interlace_method() == Ihdr::Interlace::Invalid) {
+    throw std::runtime_error("Invalid interlace method.");
+  } if(ihdr.compression_method() != Ihdr::Compression::Deflate
+    || ihdr.filter_method() != Ihdr::FilterMethod::Default) {
+    throw std::runtime_error("Unknown compression or filter method.");
+  }
+
+  for(const auto& chunk : carrier.chunks()) {
+    const auto data = carrier.payload(chunk);
+    if(chunk.type() == Chunk::Type::PLTE) {
+      if(data.size() % 3 != 0 || data.size() > 256 * 3) {
+        throw std::runtime_error("Invalid PLTE chunk size.");
+      }
+      palette_size_ = data.size() / 3;
+      for(size_t i = 0; i < palette_size_; i++) {
+        palette_[i] = { data[i * 3], data[i * 3 + 1], data[i * 3 + 2], 255 };
+      }
+    } else if(chunk.type() == Chunk::Type::tRNS) {
+      if(color_ == Ihdr::ColorType::IndexedColor) {
+        // One alpha per palette entry, may be shorter
+        // than the palette, the rest stay opaque.
+        for(size_t i = 0; i < std::min<size_t>(data.size(), 256); i++) {
+          palette_[i][3] = data[i];
+        }
+      } else if(color_ == Ihdr::ColorType::GrayScale && data.size() >= 2) {
+        key_[0]  = be16(data.data());
+        has_key_ = true;
+      } else if(color_ == Ihdr::ColorType::TrueColor && data.size() >= 6) {
+        key_     = { be16(data.data()), be16(data.data() + 2), be16(data.data() + 4) };
+        has_key_ = true;
+      }
+    }
+  }
+
+  if(color_ == Ihdr::ColorType::IndexedColor && palette_size_ == 0) {
+    throw std::runtime_error("Indexed color image has no PLTE chunk.");
+  }
+}
+
+auto spng::Decoder::row_bytes() const -> size_t {
+  switch(format_) {
+    case Format::Rgba8:  return size_t(width_) * 4;
+    case Format::Rgba16: return size_t(width_) * 8;
+    case Format::Native: return stored_row_bytes(width_, chans_, depth_);
+  }
+  return 0;
+}
+
+auto spng::Decoder::format_from_string(const std::string_view name) -> std::optional<Format> {
+  if(name == "rgba8")  return Format::Rgba8;
+  if(name == "rgba16") return Format::Rgba16;
+  if(name == "native") return Format::Native;
+  return std::nullopt;
+}
+
+auto spng::Decoder::format_name(const Format format) -> std::string_view {
+  switch(format) {
+    case Format::Rgba8:  return "rgba8";
+    case Format::Rgba16: return "rgba16";
+    case Format::Native: return "native";
+  }
+  return "unknown";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Decoder::_convert(const std::span<const uint8_t> src, const uint32_t count, uint8_t* dst) const -> void {
+  using enum Ihdr::ColorType;
+  const uint8_t* in = src.data();
+
+  if(format_ == Format::Native) {
+    std::memcpy(dst, in, stored_row_bytes(count, chans_, depth_));
+    return;
+  }
+
+  // Gather each pixel as 16-bit RGBA first, then narrow.
+  // 8-bit samples are widened by *257 so that narrowing
+  // back by >>8 gives the original value.
+  const uint32_t max_val = (1U << depth_) - 1;
+  for(uint32_t x = 0; x < count; x++) {
+    uint32_t r = 0, g = 0, b = 0, a = 0xFFFF;
+    if(color_ == IndexedColor) {
+      const auto idx = depth_ == 8 ? in[x] : packed_sample(in, x, depth_);
+      if(idx >= palette_size_) {
+        throw std::runtime_error(fmt("Palette index {} out of range.", idx));
+      }
+      const auto& entry = palette_[idx];
+      r = entry[0] * 257U;
+      g = entry[1] * 257U;
+      b = entry[2] * 257U;
+      a = entry[3] * 257U;
+    } else if(depth_ == 16) {
+      const uint8_t* px = in + size_t(x) * chans_ * 2;
+      r = be16(px);
+      if(color_ == GrayScale || color_ == GrayscaleAlpha) {
+        g = b = r;
+        if(color_ == GrayscaleAlpha) a = be16(px + 2);
+        else if(has_key_ && r == key_[0]) a = 0;
+      } else {
+        g = be16(px + 2);
+        b = be16(px + 4);
+        if(color_ == TruecolorAlpha) a = be16(px + 6);
+        else if(has_key_ && r == key_[0] && g == key_[1] && b == key_[2]) a = 0;
+      }
+    } else if(depth_ == 8) {
+      const uint8_t* px = in + size_t(x) * chans_;
+      r = px[0];
+      if(color_ == GrayScale || color_ == GrayscaleAlpha) {
+        g = b = r;
+        if(color_ == GrayscaleAlpha) a = px[1] * 257U;
+        else if(has_key_ && r == key_[0]) a = 0;
+      } else {
+        g = px[1];
+        b = px[2];
+        if(color_ == TruecolorAlpha) a = px[3] * 257U;
+        else if(has_key_ && r == key_[0] && g == key_[1] && b == key_[2]) a = 0;
+      }
+      r *= 257U;
+      g *= 257U;
+      b *= 257U;
+    } else {
+      // Low bit depth grayscale, scaled up to the full range.
+      const uint32_t val = packed_sample(in, x, depth_);
+      if(has_key_ && val == key_[0]) a = 0;
+      r = g = b = val * 0xFFFFU / max_val;
+    }
+
+    if(format_ == Format::Rgba8) {
+      uint8_t* px = dst + size_t(x) * 4;
+      px[0] = static_cast<uint8_t>(r >> 8);
+      px[1] = static_cast<uint8_t>(g >> 8);
+      px[2] = static_cast<uint8_t>(b >> 8);
+      px[3] = static_cast<uint8_t>(a >> 8);
+    } else {
+      const std::array<uint16_t, 4> px = {
+        static_cast<uint16_t>(r),
+        static_cast<uint16_t>(g),
+        static_cast<uint16_t>(b),
+        static_cast<uint16_t>(a),
+      };
+      std::memcpy(dst + size_t(x) * 8, px.data(), sizeof(px));
+    }
+  }
+}
+
+auto spng::Decoder::_next_pass() -> void {
+  // Skip passes that have no pixels at all,
+  // those don't store any rows, not even filter bytes.
+  for( ; pass_ < (interlaced_ ? adam7.size() : 1); pass_++) {
+    if(interlaced_) {
+      const auto& [x0, y0, dx, dy] = adam7[pass_];
+      pass_w_ = width_  > x0 ? (width_  - x0 + dx - 1) / dx : 0;
+      pass_h_ = height_ > y0 ? (height_ - y0 + dy - 1) / dy : 0;
+    } else {
+      pass_w_ = width_;
+      pass_h_ = height_;
+    }
+
+    if(pass_w_ != 0 && pass_h_ != 0) {
+      const size_t len = stored_row_bytes(pass_w_, chans_, depth_);
+      cur_.assign(len + 1, 0);
+      prev_.assign(len + 1, 0);
+      pass_y_ = 0;
+      filled_ = 0;
+      return;
+    }
+  }
+}
+
+auto spng::Decoder::_row_done() -> void {
+  const std::span<uint8_t> row(cur_.data() + 1, cur_.size() - 1);
+  const size_t bpp = std::max<size_t>(1, size_t(chans_) * depth_ / 8);
+  unfilter_row(cur_[0], row, { prev_.data() + 1, row.size() }, bpp);
+
+  if(!interlaced_) {
+    _convert(row, width_, out_.data());
+    (*sink_)(pass_y_, { out_.data(), row_bytes() });
+  } else {
+    // Convert the pass row, then scatter its pixels
+    // into their places in the full image.
+    const auto& [x0, y0, dx, dy] = adam7[pass_];
+    const size_t y = y0 + size_t(pass_y_) * dy;
+    _convert(row, pass_w_, out_.data());
+    uint8_t* dst = image_.data() + y * row_bytes();
+
+    if(format_ != Format::Native || depth_ >= 8) {
+      const size_t px_size = format_ == Format::Native ? size_t(chans_) * depth_ / 8
+        : format_ == Format::Rgba8 ? 4 : 8;
+      for(uint32_t i = 0; i < pass_w_; i++) {
+        std::memcpy(dst + (x0 + size_t(i) * dx) * px_size, out_.data() + i * px_size, px_size);
+      }
+    } else {
+      for(uint32_t i = 0; i < pass_w_; i++) {
+        const size_t x   = x0 + size_t(i) * dx;
+        const auto val   = packed_sample(out_.data(), i, depth_);
+        const size_t bit = x * depth_;
+        const int shift  = 8 - depth_ - static_cast<int>(bit % 8);
+        auto& byte = dst[bit / 8];
+        byte = static_cast<uint8_t>((byte & ~(((1U << depth_) - 1) << shift)) | (val << shift));
+      }
+    }
+  }
+
+  std::swap(prev_, cur_);
+  filled_ = 0;
+
+  if(++pass_y_ == pass_h_) {
+    ++pass_;
+    _next_pass();
+  }
+}
+
+auto spng::Decoder::_inflate_parallel(const std::span<const std::span<const uint8_t>> parts, const size_t max_output) -> bool {
+  // Don't pay for the search below unless its result can be used.
+  restart_points_.reset();
+  if(threads_ <= 1 || max_output > max_buffered_) {
+    return false;
+  }
+
+  // A full flush ends with an empty stored block,
+  // whose length fields are the bytes 00 00 FF FF.
+  // The data can contain those bytes by chance too,
+  // every piece is verified below.
+  std::vector<size_t> candidates;
+  size_t total = 0;
+  uint32_t last4 = 0xFFFFFFFFU;
+  for(const auto& part : parts) {
+    for(const auto byte : part) {
+      last4 = (last4 << 8) | byte;
+      ++total;
+      if(last4 == 0x0000FFFFU) candidates.emplace_back(total);
+    }
+  }
+
+  restart_points_ = candidates.size();
+  if(candidates.empty()) {
+    return false;
+  }
+
+  // The header is skipped by the pieces, check it here.
+  // Anything off and the serial pass reports it properly.
+  const auto header = slice(parts, 0, 2);
+  uint32_t cmf_flg = 0;
+  for(const auto& range : header) {
+    for(const auto byte : range) cmf_flg = (cmf_flg << 8) | byte;
+  }
+
+  if((cmf_flg >> 8 & 0x0F) != 8 || cmf_flg % 31 != 0 || cmf_flg & 0x20) {
+    return false;
+  }
+
+  // Pieces that are too small aren't worth a thread,
+  // merge neighbours up to a minimum size.
+  const size_t min_size = std::max<size_t>(64 * 1024, total / (size_t(threads_) * 4));
+  std::vector<size_t> starts = { 2 };  // After the zlib header.
+  for(const auto pos : candidates) {
+    if(pos - starts.back() >= min_size && total - pos >= min_size) {
+      starts.emplace_back(pos);
+    }
+  }
+
+  if(starts.size() < 2) {
+    return false;
+  }
+
+  struct Piece {
+    FlatBuffer::Buffer out;
+    uint32_t adler  = 1;
+    size_t consumed = 0;
+    bool ok = false;
+  };
+
+  // Every piece draws on one output budget, so together they
+  // can't hold more than the serial pass would allow. Once
+  // it's spent, every worker gives up.
+  std::vector<Piece> pieces(starts.size());
+  std::atomic<size_t> next = 0;
+  std::atomic<size_t> budget_used = 0;
+  std::atomic<bool> over_budget = false;
+  auto worker = [&]() -> void {
+    for(size_t i = next++; i < pieces.size() && !over_budget; i = next++) {
+      auto& piece = pieces[i];
+      const bool last = i + 1 == pieces.size();
+      const auto in = slice(parts, starts[i], last ? total : starts[i + 1]);
+      auto sink = [&](const std::span<const uint8_t> data) {
+        if(over_budget || budget_used.fetch_add(data.size()) + data.size() > max_output) {
+          over_budget = true;
+          throw std::runtime_error("Inflated image data is larger than expected.");
+        }
+        piece.out.insert(piece.out.end(), data.begin(), data.end());
+      };
+
+      try {
+        Inflater inflater(false, max_output);
+        last ? inflater.run(in, sink) : inflater.run_segment(in, sink);
+        piece.consumed = inflater.consumed();
+        piece.adler    = adler32(piece.out);
+        piece.ok       = true;
+      } catch(const std::exception&) {
+        piece.ok = false;
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    const size_t count = std::min<size_t>(threads_, pieces.size());
+    for(size_t i = 0; i < count; i++) {
+      workers.emplace_back(worker);
+    }
+  }
+
+  // Every piece decoded, the output isn't too large,
+  // and the checksums join up to the one in the trailer.
+  uint32_t adler = 1;
+  size_t out_size = 0;
+  for(const auto& piece : pieces) {
+    if(!piece.ok) return false;
+    adler = adler32_combine(adler, piece.adler, piece.out.size());
+    out_size += piece.out.size();
+  }
+
+  const size_t trailer_at = starts.back() + pieces.back().consumed;
+  if(out_size > max_output || trailer_at + 4 > total) {
+    return false;
+  }
+
+  uint32_t stored = 0;
+  for(const auto& range : slice(parts, trailer_at, trailer_at + 4)) {
+    for(const auto byte : range) stored = (stored << 8) | byte;
+  }
+
+  if(stored != adler) {
+    return false;
+  }
+
+  segments_ = pieces.size();
+  for(auto& piece : pieces) {
+    _feed(piece.out);
+    FlatBuffer::Buffer().swap(piece.out);
+  }
+
+  return true;
+}
+
+auto spng::Decoder::_feed(std::span<const uint8_t> data) -> void {
+  const size_t passes = interlaced_ ? adam7.size() : 1;
+  while(!data.empty() && pass_ < passes) {
+    const size_t take = std::min(data.size(), cur_.size() - filled_);
+    std::memcpy(cur_.data() + filled_, data.data(), take);
+    filled_ += take;
+    data = data.subspan(take);
+    if(filled_ == cur_.size()) {
+      _row_done();
+    }
+  }
+
+  // Anything past the last row is ignored,
+  // like most decoders do.
+}
+
+auto spng::Decoder::decode_rows(const RowSink& sink) -> void {
+  std::vector<std::span<const uint8_t>> parts;
+  for(const auto& chunk : carrier_.chunks()) {
+    if(chunk.type() == Chunk::Type::IDAT) {
+      parts.emplace_back(carrier_.payload(chunk));
+    }
+  }
+
+  if(parts.empty()) {
+    throw std::runtime_error("PNG has no IDAT chunks.");
+  }
+
+  sink_ = &sink;
+  pass_ = 0;
+  out_.assign(std::max(row_bytes(), stored_row_bytes(width_, chans_, depth_)), 0);
+  if(interlaced_) {
+    image_.assign(row_bytes() * height_, 0);
+  }
+
+  // The inflated size is known exactly, so anything that
+  // would go far past it is refused rather than decoded.
+  uint64_t expected = 0;
+  const size_t passes = interlaced_ ? adam7.size() : 1;
+  for(size_t p = 0; p < passes; p++) {
+    const auto& [x0, y0, dx, dy] = interlaced_ ? adam7[p] : std::array<uint32_t, 4>{ 0, 0, 1, 1 };
+    const uint32_t pw = width_  > x0 ? (width_  - x0 + dx - 1) / dx : 0;
+    const uint32_t ph = height_ > y0 ? (height_ - y0 + dy - 1) / dy : 0;
+    if(pw != 0 && ph != 0) {
+      expected += uint64_t(ph) * (stored_row_bytes(pw, chans_, depth_) + 1);
+    }
+  }
+
+  _next_pass();
+  segments_ = 0;
+  if(!_inflate_parallel(parts, expected + 65536)) {
+    Inflater(true, expected + 65536).run(parts, [&](const std::span<const uint8_t> out) {
+      _feed(out);
+    });
+  }
+
+  if(pass_ < passes) {
+    throw std::runtime_error("Image data ends before the last row.");
+  }
+
+  if(interlaced_) {
+    for(uint32_t y = 0; y < height_; y++) {
+      sink(y, { image_.data() + size_t(y) * row_bytes(), row_bytes() });
+    }
+    image_.clear();
+    image_.shrink_to_fit();
+  }
+
+  sink_ = nullptr;
+}
+
+auto spng::Decoder::decode() -> FlatBuffer::Buffer {
+  FlatBuffer::Buffer image(row_bytes() * height_);
+  decode_rows([&](const uint32_t y, const std::span<const uint8_t> row) {
+    std::ranges::copy(row, image.begin() + static_cast<ptrdiff_t>(size_t(y) * row_bytes()));
+  });
+  return image;
+}
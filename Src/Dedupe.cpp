@@ -0,0 +1,127 @@
+#include <Dedupe.hpp>
+#include <ConManip.hpp>
+#include <Fmt.hpp>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <print>
+
+namespace {
+  struct Entry {
+    std::string file;
+    size_t size         = 0;
+    uint64_t chunk_hash = 0;
+    uint64_t pixel_hash = 0;
+  };
+
+  // One entry per file is tiny next to decoding it,
+  // a single lock is fine.
+  struct Registry {
+    std::mutex lock;
+    std::vector<Entry> entries;
+  };
+
+  auto registry() -> Registry& {
+    static Registry reg;
+    return reg;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Dedupe::add(const std::string& file,
+  const size_t size,
+  const uint64_t chunk_hash,
+  const uint64_t pixel_hash) -> void
+{
+  auto& reg = registry();
+  std::lock_guard guard(reg.lock);
+  reg.entries.emplace_back(Entry{ file, size, chunk_hash, pixel_hash });
+}
+
+auto spng::Dedupe::print_report() -> void {
+  auto& reg = registry();
+  std::lock_guard guard(reg.lock);
+
+  std::unordered_map<uint64_t, std::vector<const Entry*>> groups;
+  groups.reserve(reg.entries.size());
+  for(const auto& entry : reg.entries) {
+    groups[entry.pixel_hash].emplace_back(&entry);
+  }
+
+  // Keeping the smallest file of each group, the
+  // rest could be reclaimed. Biggest wins first.
+  struct Group {
+    uint64_t pixel_hash = 0;
+    std::vector<const Entry*> files;
+    uint64_t reclaimable = 0;
+  };
+
+  std::vector<Group> dupes;
+  uint64_t dupe_files = 0, identical_files = 0, reclaimable = 0;
+  for(auto& [hash, files] : groups) {
+    if(files.size() < 2) continue;
+    std::ranges::sort(files, [](const Entry* a, const Entry* b) {
+      return a->chunk_hash != b->chunk_hash ? a->chunk_hash < b->chunk_hash : a->file < b->file;
+    });
+
+    Group group{ hash, files, 0 };
+    uint64_t smallest = files.front()->size;
+    for(const auto* entry : files) {
+      group.reclaimable += entry->size;
+      smallest = std::min<uint64_t>(smallest, entry->size);
+    }
+    group.reclaimable -= smallest;
+
+    // Files sharing a chunk hash with the one before them are exact copies.
+    for(size_t i = 1; i < files.size(); i++) {
+      identical_files += files[i]->chunk_hash == files[i - 1]->chunk_hash;
+    }
+
+    dupe_files  += files.size() - 1;
+    reclaimable += group.reclaimable;
+    dupes.emplace_back(std::move(group));
+  }
+
+  std::ranges::sort(dupes, [](const Group& a, const Group& b) {
+    return a.reclaimable != b.reclaimable ? a.reclaimable > b.reclaimable : a.pixel_hash < b.pixel_hash;
+  });
+
+  std::print("-- ");
+  set_console(ConFg::Magenta);
+  set_console(ConStyle::Bold);
+  std::println("Duplicate Images:");
+  reset_console();
+
+  for(const auto& group : dupes) {
+    set_console(ConFg::White);
+    set_console(ConStyle::Bold);
+    std::print("pixels {:016x} ", group.pixel_hash);
+    reset_console();
+    std::println(":: {} files, {} bytes reclaimable", group.files.size(), group.reclaimable);
+
+    for(const auto* entry : group.files) {
+      set_console(ConFg::Yellow);
+      std::print("  chunks {:016x} ", entry->chunk_hash);
+      reset_console();
+      std::println("{:>12} {}", entry->size, entry->file);
+    }
+  }
+
+  auto display_value = [&]<typename T>(const std::string_view name, T&& val) -> void {
+    set_console(ConFg::Yellow);
+    std::print("{:<18} ", name);
+    reset_console();
+    std::println(": {}", val);
+  };
+
+  std::println("");
+  display_value("Files Hashed", reg.entries.size());
+  display_value("Unique Images", groups.size());
+  display_value("Duplicate Files", dupe_files);
+  display_value("Exact Copies", identical_files);
+  display_value("Metadata Only", dupe_files - identical_files);
+  display_value("Reclaimable Bytes", reclaimable);
+  std::println("");
+}
@@ -3,6 +3,24 @@
 #include <HexDump.hpp>
 #include <Carrier.hpp>
 #include <Context.hpp>
+#include <ChunkIndex.hpp>
+#include <TextIndex.hpp>
+#include <Predicate.hpp>
+#include <Carve.hpp>
+#include <Tar.hpp>
+#include <MappedFile.hpp>
+#include <OutFile.hpp>
+#include <Stats.hpp>
+#include <Census.hpp>
+#include <Rewrite.hpp>
+#include <Decode.hpp>
+#include <PixelStats.hpp>
+#include <PaletteStats.hpp>
+#include <Hash.hpp>
+#include <Dedupe.hpp>
+#include <Profiles.hpp>
+#include <TextSearch.hpp>
+#include <Inflate.hpp>
 #include <ConManip.hpp>
 #include <Fmt.hpp>
 #include <print>
@@ -10,13 +28,663 @@
 #include <ios>
 #include <stdexcept>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <bit>
+#include <array>
+#include <string_view>
+#include <unordered_set>
+#include <unordered_map>
+#include <memory>
+#include <span>
+#include <cctype>
 
+// Held while a file's output is printed, so
+// that parallel workers don't interleave lines.
+static std::mutex console_lock;
+
+static auto index_writer() -> spng::ChunkIndex::Writer& {
+  static spng::ChunkIndex::Writer writer;
+  return writer;
+}
+
+// Compiled once, on first use. Argparse has already checked it.
+static auto where_predicate() -> const spng::Predicate& {
+  static const spng::Predicate predicate(spng::Context::get().where_);
+  return predicate;
+}
+
+static auto text_index_writer() -> spng::TextIndex::Writer& {
+  static spng::TextIndex::Writer writer;
+  return writer;
+}
+
+// Files whose text index entries were carried over, so
+// their text doesn't have to be extracted again.
+static auto carried_text_files() -> std::unordered_set<std::string>& {
+  static std::unordered_set<std::string> carried;
+  return carried;
+}
+
+// Carries every file of an existing text index over to the new one,
+// unless it has changed since, or is gone. Called before any worker
+// starts, carried_text_files() is only read after that.
+static auto carry_text_index() -> void {
+  const auto& index_path = spng::Context::get().text_index_;
+  std::error_code ec;
+  if(!std::filesystem::exists(index_path, ec)) {
+    return;
+  }
+
+  auto& carried = carried_text_files();
+  std::optional<spng::TextIndex::Reader> old;
+  try {
+    old.emplace(index_path);
+    for(uint64_t i = 0; i < old->num_files(); i++) {
+      const auto rec = old->file(i);
+      const std::string path(rec.path);
+      if(!std::filesystem::is_regular_file(path, ec)
+        || std::filesystem::file_size(path, ec) != rec.file_size
+        || spng::TextIndex::mtime_of(path) != rec.mtime) {
+        continue;
+      }
+      text_index_writer().carry(*old, static_cast<uint32_t>(i));
+      carried.emplace(path);
+    }
+  } catch(const std::exception& e) {
+    // Not fatal, the index is just built from scratch.
+    spng::set_console(spng::ConFg::Yellow);
+    std::print("Rebuilding text index ");
+    spng::reset_console();
+    std::println(":: {} :: {}", index_path, e.what());
+    text_index_writer().clear();
+    carried.clear();
+  }
+}
+
+// Files written next to the working directory (rewrites, raw
+// pixels, carved and extracted chunks) are named after this,
+// the input's file name without its directories.
+static auto output_base(const std::string& file) -> std::string {
+  return std::filesystem::path(file).filename().string();
+}
+
+namespace {
+  struct RewriteResult {
+    std::string out_name;
+    size_t dropped   = 0;
+    size_t idat_in   = 0;
+    size_t idat_out  = 0;
+    size_t bytes_out = 0;
+    bool unchanged   = false;  // In-place and nothing to do.
+  };
+}
+
+// True if every IDAT chunk but the last is already idat_size bytes.
+static auto idat_already_sized(const spng::Carrier& carrier, const uint32_t idat_size) -> bool {
+  const spng::Chunk* prev = nullptr;
+  for(const auto& chunk : carrier.chunks()) {
+    if(chunk.type() != spng::Chunk::Type::IDAT) continue;
+    if(prev != nullptr && prev->length() != idat_size) return false;
+    prev = &chunk;
+  }
+  return prev == nullptr || prev->length() <= idat_size;
+}
+
+// Writes a copy of the file without the chunks named by --strip,
+// and with its IDAT chunks resized by --rechunk-idat.
+// With --in-place the file itself is replaced.
+static auto rewrite_file(const std::string& file, const spng::Carrier& carrier) -> RewriteResult {
+  const auto& strip = spng::Context::get().strip_chunks_;
+  const auto idat_size = spng::Context::get().idat_size_;
+  const bool all_ancillary = std::ranges::find(strip, "ancillary") != strip.end();
+  auto keep = [&](const spng::Chunk& chunk) -> bool {
+    const auto type = chunk.type_string();
+    return !(all_ancillary && type.front() & 0x20) && std::ranges::find(strip, type) == strip.end();
+  };
+
+  const bool in_place = spng::Context::get().flags_ & spng::Context::InPlace;
+  RewriteResult res;
+  res.out_name = in_place
+    ? file
+    : spng::fmt("{}.{}.png",
+      output_base(file),
+      idat_size != 0 ? "rechunked" : "stripped");
+
+  // Nothing would change, leave the original alone.
+  if(in_place
+    && std::ranges::all_of(carrier.chunks(), keep)
+    && (idat_size == 0 || idat_already_sized(carrier, idat_size))) {
+    res.bytes_out = carrier.size();
+    res.unchanged = true;
+    return res;
+  }
+
+  spng::OutFile out(res.out_name, in_place);
+  if(idat_size != 0) {
+    const auto rechunked = spng::Rewrite::rechunk_idat(carrier, keep, idat_size, out);
+    res.dropped  = rechunked.dropped;
+    res.idat_in  = rechunked.idat_in;
+    res.idat_out = rechunked.idat_out;
+  } else {
+    res.dropped  = spng::Rewrite::filter_chunks(carrier, keep, out);
+  }
+
+  res.bytes_out = out.written();
+  out.commit();
+  return res;
+}
+
+// When files aren't processed in parallel, a single image may
+// use every core if its IDAT stream has full-flush points, as
+// long as it's small enough to hold inflated in memory. Larger
+// images keep to the serial pass, which only holds a few rows.
+static auto use_spare_cores(spng::Decoder& decoder) -> void {
+  if(spng::Context::get().jobs_ == 1) {
+    decoder.set_threads(std::max(1U, std::thread::hardware_concurrency()));
+  }
+}
+
+namespace {
+  struct DecodeResult {
+    std::string out_name;
+    size_t bytes_out      = 0;
+    std::optional<size_t> restart_points;  // Only searched for if it could decode in parallel.
+    size_t segments       = 0;  // 0 if decoded serially.
+  };
+}
+
+// Decodes the image to <FILENAME>.<FORMAT>.raw one row at a time,
+// so only a few rows are ever in memory (unless a small enough image
+// is decoded in parallel, see use_spare_cores()).
+static auto write_raw_pixels(const std::string& file, const spng::Carrier& carrier) -> DecodeResult {
+  const auto& format = spng::Context::get().raw_format_;
+  spng::Decoder decoder(carrier, *spng::Decoder::format_from_string(format));
+  use_spare_cores(decoder);
+
+  DecodeResult res;
+  res.out_name = spng::fmt("{}.{}.raw", output_base(file), format);
+  spng::OutFile out(res.out_name);
+
+  // The row is reused by the decoder, hand it
+  // to the OutFile before the next one arrives.
+  decoder.decode_rows([&](uint32_t, const std::span<const uint8_t> row) {
+    out.write(row);
+    out.flush();
+  });
+
+  out.commit();
+  res.bytes_out      = out.written();
+  res.restart_points = decoder.restart_points();
+  res.segments       = decoder.parallel_segments();
+  return res;
+}
+
+namespace {
+  struct PixelReport {
+    spng::PixelStats stats;
+    spng::Ihdr::ColorType color = spng::Ihdr::ColorType::GrayScale;
+    uint8_t depth = 0;
+    uint8_t channels = 0;
+    uint8_t index_bits = 0;  // Indexed only: smallest depth that holds every index used.
+  };
+
+  struct PixelScan {
+    std::optional<PixelReport> report;  // --pixel-stats
+    uint64_t hash = 0;                  // --hash
+  };
+}
+
+// Decodes the image once, in memory-light row order, for
+// --pixel-stats and --hash. 16-bit images are decoded to
+// Rgba16 so unused low bytes can be seen, and so that
+// images only hash equal if every sample is equal.
+// The hash covers the size and format, then the pixels.
+static auto scan_pixels(const spng::Carrier& carrier, const bool want_stats, const bool want_hash) -> PixelScan {
+  using Format = spng::Decoder::Format;
+  const Format format = carrier.metadata().bit_depth() == 16 ? Format::Rgba16 : Format::Rgba8;
+  spng::Decoder decoder(carrier, format);
+  use_spare_cores(decoder);
+
+  PixelScan scan;
+  if(want_stats) {
+    scan.report = PixelReport{
+      spng::PixelStats(format == Format::Rgba16),
+      decoder.color_type(),
+      decoder.bit_depth(),
+      decoder.channels(),
+    };
+  }
+
+  spng::Xxh64 hasher;
+  if(want_hash) {
+    const std::array<uint32_t, 3> shape { decoder.width(), decoder.height(), static_cast<uint32_t>(format) };
+    hasher.update({ reinterpret_cast<const uint8_t*>(shape.data()), sizeof(shape) });
+  }
+
+  // The shape and Rgba16 rows are hashed in host byte order.
+  decoder.decode_rows([&](uint32_t, const std::span<const uint8_t> row) {
+    if(scan.report) scan.report->stats.add_row(row);
+    if(want_hash)   hasher.update(row);
+  });
+
+  // The Rgba8 rows no longer say which palette index each
+  // pixel had, so indexed images take a second, Native pass.
+  if(scan.report && decoder.color_type() == spng::Ihdr::ColorType::IndexedColor) {
+    spng::PaletteStats palette(carrier);
+    spng::Decoder native(carrier, Format::Native);
+    use_spare_cores(native);
+    native.decode_rows([&](uint32_t, const std::span<const uint8_t> row) {
+      palette.add_row(row);
+    });
+
+    const auto entries = palette.entries();
+    size_t top = 0;
+    for(size_t i = 0; i < entries.size(); i++) {
+      if(entries[i].uses != 0) top = i;
+    }
+    if(palette.summary().out_of_range != 0) {
+      top = (size_t(1) << decoder.bit_depth()) - 1;
+    }
+    scan.report->index_bits = static_cast<uint8_t>(std::max(1U,
+      std::bit_ceil(static_cast<unsigned>(std::bit_width(top)))));
+  }
+
+  scan.hash = hasher.digest();
+  return scan;
+}
+
+// Hash of every chunk from IHDR to IEND, exactly as stored.
+// Equal for byte-identical files, even if trailing data differs.
+static auto hash_chunks(const spng::Carrier& carrier) -> uint64_t {
+  const auto& first = carrier.chunks().front();
+  const auto& last  = carrier.chunks().back();
+  const size_t end  = last.offset_ + spng::Rewrite::raw_size(last);
+  return spng::xxh64(carrier.bytes().subspan(first.offset_, end - first.offset_));
+}
+
+static auto print_pixel_stats(const PixelReport& report) -> void {
+  using spng::ConFg;
+  using spng::ConStyle;
+  using ColorType = spng::Ihdr::ColorType;
+  const auto& stats = report.stats;
+
+  auto display_value = [&]<typename T>(const std::string_view name, T&& val) -> void {
+    spng::set_console(ConFg::Yellow);
+    std::print("{:<16} ", name);
+    spng::reset_console();
+    std::println(": {}", val);
+  };
+
+  // 16 bars of 16 values each, scaled to the fullest one.
+  static constexpr std::array<std::string_view, 9> bars { " ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+  auto sparkline = [&](const spng::PixelStats::Histogram& hist) -> std::string {
+    std::array<uint64_t, 16> buckets{};
+    for(size_t v = 0; v < hist.size(); v++) {
+      buckets[v / 16] += hist[v];
+    }
+    const uint64_t top = std::ranges::max(buckets);
+    std::string line;
+    for(const uint64_t count : buckets) {
+      line += bars[top == 0 ? 0 : (count * 8 + top - 1) / top];
+    }
+    return line;
+  };
+
+  spng::set_console(ConFg::Magenta);
+  spng::set_console(ConStyle::Bold);
+  std::println("Pixel Statistics:");
+  spng::reset_console();
+
+  static constexpr std::array<std::string_view, 4> channel_names { "Red", "Green", "Blue", "Alpha" };
+  for(size_t c = 0; c < channel_names.size(); c++) {
+    display_value(channel_names[c], spng::fmt("|{}|", sparkline(stats.histogram(c))));
+  }
+
+  const bool has_alpha = report.color == ColorType::GrayscaleAlpha || report.color == ColorType::TruecolorAlpha;
+  const bool is_color  = report.color == ColorType::TrueColor || report.color == ColorType::TruecolorAlpha;
+  const bool indexed   = report.color == ColorType::IndexedColor;
+  const size_t unique  = stats.unique_colors();
+
+  // Smallest palette index that could hold every colour.
+  const auto index_bits = std::max(1U,
+    std::bit_ceil(static_cast<unsigned>(std::bit_width(std::max<size_t>(unique, 1) - 1))));
+
+  display_value("Pixels", stats.pixels());
+  display_value("Opaque", stats.opaque() ? "Yes"
+    : stats.binary_alpha() ? "No (binary alpha)"
+    : "No");
+  display_value("Grayscale", stats.grayscale() ? "Yes" : "No");
+  display_value("Bits Used", indexed
+    ? spng::fmt("{} of {} (palette indices)", report.index_bits, report.depth)
+    : spng::fmt("{} of {}", stats.bits_used(), report.depth));
+  display_value("Unique Colours", stats.unique_capped()
+    ? spng::fmt("more than {}", spng::PixelStats::max_unique)
+    : spng::fmt("{}", unique));
+
+  // Ways the same pixels could be stored more compactly.
+  // Only grayscale samples can be stored in under 8 bits,
+  // other colour types go from 16 to 8 at most.
+  std::vector<std::string> hints;
+  if(has_alpha && stats.opaque()) {
+    hints.emplace_back("alpha channel is unused, could drop it");
+  } if(is_color && stats.grayscale()) {
+    hints.emplace_back("all pixels are gray, could be stored as grayscale");
+  } if(!indexed && !stats.unique_capped() && unique <= 256 && stats.bits_used() <= 8
+    && index_bits < report.depth * report.channels) {
+    hints.emplace_back(spng::fmt("unique colours fit in a palette, could be stored as indexed colour with {}-bit indices", index_bits));
+  } if(indexed && index_bits < report.depth) {
+    hints.emplace_back(spng::fmt("only {}-bit palette indices are needed", index_bits));
+  } if(report.color == ColorType::GrayScale && stats.bits_used() < report.depth) {
+    hints.emplace_back(spng::fmt("samples only use {} of {} bits", stats.bits_used(), report.depth));
+  } if(report.color != ColorType::GrayScale && !indexed && report.depth == 16 && stats.bits_used() <= 8) {
+    hints.emplace_back("16-bit samples all fit in 8 bits, could be stored as 8-bit");
+  }
+
+  for(const auto& hint : hints) {
+    spng::set_console(ConFg::Green);
+    std::print("Hint ");
+    spng::reset_console();
+    std::println(":: {}", hint);
+  }
+  std::println("");
+}
+
+namespace {
+  struct PaletteReport {
+    std::vector<spng::PaletteStats::Entry> entries;
+    spng::PaletteStats::Summary summary;
+  };
+}
+
+// Counts palette index usage for --palette. Images that
+// aren't indexed have nothing to analyze.
+static auto analyze_palette(const spng::Carrier& carrier) -> std::optional<PaletteReport> {
+  if(carrier.metadata().color_type() != spng::Ihdr::ColorType::IndexedColor) {
+    return std::nullopt;
+  }
+
+  spng::PaletteStats stats(carrier);
+  spng::Decoder decoder(carrier, spng::Decoder::Format::Native);
+  use_spare_cores(decoder);
+
+  decoder.decode_rows([&](uint32_t, const std::span<const uint8_t> row) {
+    stats.add_row(row);
+  });
+  return PaletteReport{ stats.entries(), stats.summary() };
+}
+
+static auto print_palette_report(const std::optional<PaletteReport>& report) -> void {
+  using spng::ConFg;
+  using spng::ConStyle;
+
+  auto display_value = [&]<typename T>(const std::string_view name, T&& val) -> void {
+    spng::set_console(ConFg::Yellow);
+    std::print("{:<16} ", name);
+    spng::reset_console();
+    std::println(": {}", val);
+  };
+
+  // At most this many indices are listed per line.
+  auto index_list = [&](const size_t count, auto&& pred, auto&& show) -> std::string {
+    if(count == 0) {
+      return "0";
+    }
+    std::string list = spng::fmt("{} [", count);
+    size_t listed = 0;
+    for(size_t i = 0; i < report->entries.size() && listed < 16; i++) {
+      if(!pred(report->entries[i])) continue;
+      list += (listed++ == 0 ? "" : ", ") + show(i, report->entries[i]);
+    }
+    return list + (count > listed ? ", ...]" : "]");
+  };
+
+  spng::set_console(ConFg::Magenta);
+  spng::set_console(ConStyle::Bold);
+  std::println("Palette Analysis:");
+  spng::reset_console();
+
+  if(!report) {
+    std::println("Not an indexed colour image.\n");
+    return;
+  }
+
+  using Entry = spng::PaletteStats::Entry;
+  const auto& sum = report->summary;
+  auto index = [](const size_t i, const Entry&) { return spng::fmt("{}", i); };
+
+  display_value("Entries", spng::fmt("{} ({}-bit indices)", sum.entries, sum.depth));
+  display_value("Used", sum.used);
+  display_value("Unused", index_list(sum.entries - sum.used,
+    [](const Entry& e) { return e.uses == 0; },
+    index));
+  display_value("Duplicates", index_list(sum.duplicates,
+    [](const Entry& e) { return e.duplicate_of >= 0; },
+    [](const size_t i, const Entry& e) { return spng::fmt("{}={}", i, e.duplicate_of); }));
+  display_value("Transparent", index_list(sum.transparent,
+    [](const Entry& e) { return e.rgba[3] == 0; },
+    index));
+  display_value("tRNS", spng::fmt("{} stored, {} needed", sum.trns_size, sum.trns_needed));
+  display_value("hIST", !sum.has_hist ? std::string("None")
+    : sum.hist_stale == 0 ? std::string("Matches usage")
+    : spng::fmt("{} entries disagree with usage", sum.hist_stale));
+  display_value("Min Depth", spng::fmt("{}-bit ({} distinct colours)", sum.min_depth, sum.distinct));
+
+  if(sum.out_of_range != 0) {
+    spng::set_console(ConFg::Red);
+    std::print("Warning ");
+    spng::reset_console();
+    std::println(":: {} pixels use an index past the end of the palette", sum.out_of_range);
+  }
+
+  // What a re-encode with only the distinct used
+  // entries, non-opaque ones first, would save.
+  const size_t plte_saved = (sum.entries - sum.distinct) * 3;
+  const size_t trns_saved = sum.trns_size - std::min(sum.trns_size, sum.trns_needed);
+  if(plte_saved != 0 || trns_saved != 0 || sum.min_depth < sum.depth) {
+    spng::set_console(ConFg::Green);
+    std::print("Hint ");
+    spng::reset_console();
+    std::println(":: keep {} entries at {}-bit: {} fewer PLTE bytes, {} fewer tRNS bytes{}",
+      sum.distinct,
+      sum.min_depth,
+      plte_saved,
+      trns_saved,
+      sum.min_depth < sum.depth
+        ? spng::fmt(", image data {}x smaller before compression", sum.depth / sum.min_depth)
+        : "");
+  } if(sum.has_hist && sum.hist_stale != 0) {
+    spng::set_console(ConFg::Green);
+    std::print("Hint ");
+    spng::reset_console();
+    std::println(":: hIST is stale, regenerate or drop it");
+  }
+  std::println("");
+}
+
+namespace {
+  struct GrepMatch {
+    std::string type;
+    std::string keyword;
+    std::string excerpt;
+  };
+}
+
+// Up to 60 bytes of the value around a match,
+// with control characters blanked out.
+static auto excerpt_of(const std::span<const uint8_t> value, const size_t at, const size_t len) -> std::string {
+  constexpr size_t width = 60;
+  const size_t begin = at > width / 2 ? std::min(at - width / 2, value.size() - std::min(value.size(), width)) : 0;
+  const size_t end   = std::min(value.size(), std::max(begin + width, at + len));
+
+  std::string out = begin > 0 ? "..." : "";
+  for(size_t i = begin; i < end; i++) {
+    const auto ch = static_cast<char>(value[i]);
+    out += value[i] < 32 || value[i] == 127 ? ' ' : ch;
+  }
+  return end < value.size() ? out + "..." : out;
+}
+
+// Searches tEXt, zTXt and iTXt chunks for --grep. TEXT is looked
+// for in keywords and values, KEYWORD=TEXT only in values under
+// exactly that keyword. Everything is searched in place, and a
+// compressed value is only inflated if its keyword could match.
+static auto grep_text(const spng::Carrier& carrier) -> std::vector<GrepMatch> {
+  constexpr size_t max_text = size_t(16) << 20;
+  const std::string_view pattern = spng::Context::get().grep_;
+  const size_t eq = pattern.find('=');
+  const std::string_view key  = eq == std::string_view::npos ? std::string_view() : pattern.substr(0, eq);
+  const std::string_view text = eq == std::string_view::npos ? pattern : pattern.substr(eq + 1);
+  const std::span needle(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+
+  std::vector<GrepMatch> matches;
+  for(const auto& chunk : carrier.chunks()) {
+    const auto found = spng::split_text(chunk.type(), carrier.payload(chunk));
+    if(!found) continue;
+
+    const std::string_view keyword(reinterpret_cast<const char*>(found->keyword.data()), found->keyword.size());
+    if(!key.empty() && keyword != key) continue;
+
+    auto add = [&](const std::span<const uint8_t> value, const size_t at) {
+      matches.emplace_back(GrepMatch{ chunk.type_string(), std::string(keyword), excerpt_of(value, at, needle.size()) });
+    };
+
+    // A keyword hit is enough, no need to look at the value.
+    if(key.empty() && spng::find_bytes(found->keyword, needle) != spng::npos) {
+      add({}, 0);
+      continue;
+    }
+
+    if(found->compressed) {
+      const auto inflated = spng::inflate_zlib(found->value, max_text);
+      if(const size_t at = spng::find_bytes(inflated, needle); at != spng::npos) add(inflated, at);
+    } else {
+      if(const size_t at = spng::find_bytes(found->value, needle); at != spng::npos) add(found->value, at);
+    }
+  }
+
+  return matches;
+}
+
+// Maps the file and reports every PNG embedded in it. Extracted
+// copies are written straight from the mapping, never copied.
+static auto carve_file(const std::string& file) -> void {
+  using spng::Stats::Phase;
+  using spng::Stats::ScopedPhase;
+  const uint32_t flags = spng::Context::get().flags_;
+
+  const spng::MappedFile map(file);
+  spng::Stats::add(spng::Stats::Counter::BytesRead, map.size());
+  const auto result = [&] {
+    const ScopedPhase _(Phase::Parse);
+    return spng::Carve::scan(map.bytes());
+  }();
+
+  std::vector<std::string> out_names;
+  if(flags & spng::Context::CarveOut) {
+    const ScopedPhase _(Phase::Extract);
+    const auto base = output_base(file);
+    for(const auto& ext : result.found) {
+      auto& name = out_names.emplace_back(spng::fmt("{}.{:X}.png", base, ext.offset));
+      spng::OutFile out(name);
+      out.write(map.bytes().subspan(ext.offset, ext.size));
+      out.commit();
+      spng::Stats::add(spng::Stats::Counter::BytesExtracted, ext.size);
+    }
+  }
+
+  if(flags & spng::Context::Silent) {
+    return;
+  }
+
+  std::lock_guard console(console_lock);
+  const ScopedPhase _(Phase::Print);
+  spng::set_console(spng::ConFg::White);
+  spng::set_console(spng::ConStyle::Bold);
+  std::print("{}", file);
+  spng::reset_console();
+  std::println(" :: {} PNG(s) found, {} signature(s) rejected", result.found.size(), result.rejected);
+
+  for(size_t i = 0; i < result.found.size(); i++) {
+    const auto& ext = result.found[i];
+    spng::set_console(spng::ConFg::Green);
+    std::print("  0x{:<10X}", ext.offset);
+    spng::reset_console();
+    std::print(" {:>10} bytes  {}x{}  {} chunks", ext.size, ext.width, ext.height, ext.chunks);
+    if(!out_names.empty()) {
+      std::print(" -> {}", out_names[i]);
+    }
+    std::println("");
+  }
+}
+
+auto spng::verify_crcs(const Carrier& carrier) -> void {
+  for(const auto& chunk : carrier.chunks()) {
+    if(!chunk.crc_ok()) throw std::runtime_error(fmt(
+      "CRC-32 mismatch in {} chunk at offset 0x{:X} (stored {:08X}, computed {:08X})",
+      chunk.type_string(),
+      chunk.offset_,
+      chunk.checksum(),
+      chunk.computed_checksum()));
+  }
+}
+
+namespace spng {
+  static auto file_cycle(const std::string& file, std::optional<std::span<const std::byte>> in_memory) -> bool;
+}
 
 auto spng::do_file_cycle(const std::string& file) -> bool {
+  return file_cycle(file, std::nullopt);
+}
+
+auto spng::do_buffer_cycle(const std::string& name, const std::span<const std::byte> bytes) -> bool {
+  return file_cycle(name, bytes);
+}
+
+// With in_memory set, the file is parsed from those bytes in
+// place (e.g. a member of a mapped archive), never from disk.
+auto spng::file_cycle(const std::string& file, const std::optional<std::span<const std::byte>> in_memory) -> bool {
+  using Stats::Phase;
+  using Stats::ScopedPhase;
+  const Stats::ScopedFile file_timer;
+  const Trace::Span file_span("file", file);
+  Stats::add(Stats::Counter::Files);
+
   try {
+    if(Context::get().flags_ & Context::Carve) {
+      carve_file(file);
+      return true;
+    }
+
     // Load file into memory
-    const InFileRef ref(file);
-    const Carrier carrier(ref);
+    FlatBuffer::Shared contents;
+    if(!in_memory) {
+      const InFileRef ref(file);
+      const ScopedPhase _(Phase::Read);
+      contents = ref.read(ref.size());
+    }
+    Stats::add(Stats::Counter::BytesRead, in_memory ? in_memory->size() : contents->size());
+
+    const Carrier carrier = [&] {
+      const ScopedPhase _(Phase::Parse);
+      if(in_memory) {
+        return Carrier(*in_memory);
+      }
+      return Carrier(std::move(contents));
+    }();
+    Stats::add(Stats::Counter::ChunksParsed, carrier.chunks().size());
+
+    // Filter before anything expensive runs.
+    if(!Context::get().where_.empty()) {
+      const ScopedPhase _(Phase::Filter);
+      if(!where_predicate().matches(carrier)) {
+        Stats::add(Stats::Counter::FilesSkipped);
+        return true;
+      }
+    }
 
     // Get context flags,
     // chunks to extract, chunks to dump,
@@ -24,10 +692,80 @@ auto spng::do_file_cycle(const std::string& file) -> bool {
     const uint32_t flags     = Context::get().flags_;
     const auto& extr_chunks  = Context::get().extract_chunks_;
     const auto& dump_chunks  = Context::get().dump_chunks_;
-    const auto file_name     = std::filesystem::path(file).filename();
+    const auto file_name     = output_base(file);
+
+    if(flags & Context::CrcCheck) {
+      const ScopedPhase _(Phase::Verify);
+      verify_crcs(carrier);
+    }
+
+    if(!Context::get().export_index_.empty()) {
+      const ScopedPhase _(Phase::Export);
+      index_writer().add(file, carrier);
+    } if(!Context::get().text_index_.empty() && !carried_text_files().contains(file)) {
+      const ScopedPhase _(Phase::Export);
+      text_index_writer().add(file, carrier);
+    } if(flags & Context::Census) {
+      Census::add(carrier);
+    } if(flags & Context::Profiles) {
+      Profiles::add(carrier);
+    }
+
+    RewriteResult rewritten;
+    if(!Context::get().strip_chunks_.empty() || Context::get().idat_size_ != 0) {
+      const ScopedPhase _(Phase::Rewrite);
+      rewritten = rewrite_file(file, carrier);
+      if(rewritten.bytes_out < carrier.size()) {
+        Stats::add(Stats::Counter::BytesSaved, carrier.size() - rewritten.bytes_out);
+      }
+    }
+
+    DecodeResult decoded;
+    if(!Context::get().raw_format_.empty()) {
+      const ScopedPhase _(Phase::Decode);
+      decoded = write_raw_pixels(file, carrier);
+      Stats::add(Stats::Counter::BytesDecoded, decoded.bytes_out);
+    }
+
+    PixelScan scan;
+    if(flags & (Context::PixStats | Context::Hash)) {
+      const ScopedPhase _(Phase::Decode);
+      scan = scan_pixels(carrier, flags & Context::PixStats, flags & Context::Hash);
+    }
+
+    std::vector<GrepMatch> grep_matches;
+    if(!Context::get().grep_.empty()) {
+      const ScopedPhase _(Phase::Search);
+      grep_matches = grep_text(carrier);
+    }
+
+    std::optional<PaletteReport> palette;
+    if(flags & Context::Palette) {
+      const ScopedPhase _(Phase::Decode);
+      palette = analyze_palette(carrier);
+    }
+
+    uint64_t chunk_hash = 0;
+    if(flags & Context::Hash) {
+      const ScopedPhase _(Phase::Hash);
+      chunk_hash = hash_chunks(carrier);
+      Dedupe::add(file, carrier.size(), chunk_hash, scan.hash);
+    }
+
+    // A silent --where run lists the files that matched,
+    // unless --hash or --grep already print a line for them.
+    const bool list_match = flags & Context::Silent && !Context::get().where_.empty()
+      && !(flags & Context::Hash) && Context::get().grep_.empty();
+
+    std::unique_lock console(console_lock, std::defer_lock);
+    if(!(flags & Context::Silent) || !dump_chunks.empty() || flags & (Context::PixStats | Context::Hash | Context::Palette)
+      || !grep_matches.empty() || list_match) {
+      console.lock();
+    }
 
     // Display file name
     if(!(flags & Context::Silent)) {
+      const ScopedPhase _(Phase::Print);
       set_console(ConFg::White);
       set_console(ConStyle::Underline);
       set_console(ConStyle::Bold);
@@ -35,21 +773,110 @@ auto spng::do_file_cycle(const std::string& file) -> bool {
       reset_console();
     }
 
+    if(!(flags & Context::Silent) && !decoded.out_name.empty()) {
+      set_console(ConFg::Green);
+      std::print("Decoded {} bytes ", decoded.bytes_out);
+      reset_console();
+      if(decoded.segments != 0) {
+        std::println(":: parallel in {} pieces ({} possible flush points), written to {}",
+          decoded.segments,
+          *decoded.restart_points,
+          decoded.out_name);
+      } else if(decoded.restart_points) {
+        std::println(":: serial ({} possible flush points), written to {}",
+          *decoded.restart_points,
+          decoded.out_name);
+      } else {
+        std::println(":: serial, written to {}", decoded.out_name);
+      }
+    }
+
+    // grep style, one line per match.
+    for(const auto& match : grep_matches) {
+      const ScopedPhase _(Phase::Print);
+      set_console(ConFg::White);
+      set_console(ConStyle::Bold);
+      std::print("{}", file);
+      reset_console();
+      std::print(" :: ");
+      set_console(ConFg::Magenta);
+      std::print("{} ", match.type);
+      set_console(ConFg::Yellow);
+      std::print("{}", match.keyword);
+      reset_console();
+      if(match.excerpt.empty()) {
+        std::println("");
+      } else {
+        std::println(" = {}", match.excerpt);
+      }
+    }
+
+    // Silent runs still get one line per file, like sha1sum.
+    if(flags & Context::Hash && flags & Context::Silent) {
+      std::println("{:016x} {:016x} {}", chunk_hash, scan.hash, file);
+    } else if(list_match) {
+      std::println("{}", file);
+    } else if(flags & Context::Hash) {
+      set_console(ConFg::Green);
+      std::print("Hashed ");
+      reset_console();
+      std::println(":: chunks {:016x}, pixels {:016x}", chunk_hash, scan.hash);
+    }
+
+    if(!(flags & Context::Silent) && rewritten.unchanged) {
+      set_console(ConFg::Green);
+      std::print("Nothing to rewrite ");
+      reset_console();
+      std::println(":: {} left unchanged", rewritten.out_name);
+    } else if(!(flags & Context::Silent) && !rewritten.out_name.empty()) {
+      set_console(ConFg::Green);
+      if(Context::get().idat_size_ != 0) {
+        std::print("Rechunked {} IDAT into {}, stripped {} chunks ",
+          rewritten.idat_in,
+          rewritten.idat_out,
+          rewritten.dropped);
+      } else {
+        std::print("Stripped {} chunks ", rewritten.dropped);
+      }
+      reset_console();
+      std::println(":: saved {} bytes ({} -> {}), written to {}",
+        static_cast<int64_t>(carrier.size()) - static_cast<int64_t>(rewritten.bytes_out),
+        carrier.size(),
+        rewritten.bytes_out,
+        rewritten.out_name);
+    }
+
+    if(scan.report) {
+      const ScopedPhase _(Phase::Print);
+      print_pixel_stats(*scan.report);
+    } if(flags & Context::Palette) {
+      const ScopedPhase _(Phase::Print);
+      print_palette_report(palette);
+    }
+
     for(const auto& chunk : carrier.chunks()) {
       const auto ch_type = chunk.type_string();
       if(!(flags & Context::Silent) && flags & Context::Verbose) {
+        const ScopedPhase _(Phase::Print);
         chunk.print();
       } if(std::ranges::find(dump_chunks, ch_type) != dump_chunks.end()) {
+        const ScopedPhase _(Phase::Dump);
         chunk.hexdump();
+        Stats::add(Stats::Counter::BytesDumped, chunk.length());
       } if(std::ranges::find(extr_chunks, ch_type) != extr_chunks.end()) {
-        chunk.extract_to(fmt("{}.{}.bin", file_name.string(), ch_type));
+        const ScopedPhase _(Phase::Extract);
+        chunk.extract_to(fmt("{}.{}.bin", file_name, ch_type));
+        Stats::add(Stats::Counter::BytesExtracted, chunk.length());
       }
     }
 
     if(!(flags & Context::Silent) && !(flags & Context::NoSumm)) {
+      const ScopedPhase _(Phase::Print);
       carrier.print_summary();
     }
   } catch(const std::ios_base::failure& e) {
+    Stats::add_error(Stats::Error::Io);
+    std::lock_guard console(console_lock);
     set_console(ConFg::Red);
     set_console(ConStyle::Bold);
     std::print("FILE I/O :: ");
@@ -58,6 +885,8 @@ auto spng::do_file_cycle(const std::string& file) -> bool {
     return false;
   }
   catch(const std::runtime_error& e) {
+    Stats::add_error(Stats::Error::Corruption);
+    std::lock_guard console(console_lock);
     set_console(ConFg::Red);
     set_console(ConStyle::Bold);
     std::print("FILE CORRUPTION :: ");
@@ -66,6 +895,8 @@ auto spng::do_file_cycle(const std::string& file) -> bool {
     return false;
   }
   catch(const std::exception& e) {
+    Stats::add_error(Stats::Error::Internal);
+    std::lock_guard console(console_lock);
     set_console(ConFg::Red);
     set_console(ConStyle::Bold);
     std::print("INTERNAL ERROR :: ");
@@ -74,8 +905,284 @@ auto spng::do_file_cycle(const std::string& file) -> bool {
     return false;
   }
   catch(...) {
+    Stats::add_error(Stats::Error::Internal);
+    return false;
+  }
+
+  return true;
+}
+
+namespace {
+  // One file to inspect. Members of an archive carry
+  // their bytes, borrowed from the archive's mapping.
+  struct WorkItem {
+    std::string name;
+    std::optional<std::span<const std::byte>> bytes;
+  };
+
+  // Kept mapped until every member has been inspected.
+  using Archives = std::vector<std::unique_ptr<const spng::MappedFile>>;
+}
+
+// Case insensitive, ext with its dot.
+static auto has_extension(const std::string& file, const std::string_view ext) -> bool {
+  auto own = std::filesystem::path(file).extension().string();
+  std::ranges::transform(own, own.begin(), [](const char ch) { return std::tolower(ch); });
+  return own == ext;
+}
+
+// Maps a tar archive and queues its .png members, as
+// "archive.tar:member.png". Unreadable archives are
+// reported like a bad file.
+static auto expand_archive(const std::string& file, Archives& archives, std::vector<WorkItem>& items) -> bool {
+  using spng::ConFg;
+  using spng::ConStyle;
+  try {
+    const auto& map = archives.emplace_back(std::make_unique<const spng::MappedFile>(file));
+    const auto members = [&] {
+      const spng::Stats::ScopedPhase _(spng::Stats::Phase::Parse);
+      return spng::Tar::members(map->bytes());
+    }();
+    for(const auto& member : members) {
+      if(!has_extension(member.name, ".png")) continue;
+      items.emplace_back(
+        spng::fmt("{}:{}", file, member.name),
+        std::as_bytes(map->bytes().subspan(member.offset, member.size)));
+    }
+    return true;
+  } catch(const std::ios_base::failure& e) {
+    spng::Stats::add_error(spng::Stats::Error::Io);
+    spng::set_console(ConFg::Red);
+    spng::set_console(ConStyle::Bold);
+    std::print("FILE I/O :: ");
+    spng::reset_console();
+    std::println("For {} :: {}", file, e.what());
+  } catch(const std::runtime_error& e) {
+    spng::Stats::add_error(spng::Stats::Error::Corruption);
+    spng::set_console(ConFg::Red);
+    spng::set_console(ConStyle::Bold);
+    std::print("FILE CORRUPTION :: ");
+    spng::reset_console();
+    std::println("For {} :: {}", file, e.what());
+  }
+  return false;
+}
+
+// True if this run writes files named after each input.
+static auto writes_named_outputs() -> bool {
+  const auto& ctx = spng::Context::get();
+  const bool rewrites = (!ctx.strip_chunks_.empty() || ctx.idat_size_ != 0) && !(ctx.flags_ & spng::Context::InPlace);
+  return rewrites || !ctx.raw_format_.empty() || !ctx.extract_chunks_.empty() || ctx.flags_ & spng::Context::CarveOut;
+}
+
+// Inputs sharing a file name (a/x.png and b/x.png, members of two
+// archives, or one file passed twice) would write the same outputs,
+// each overwriting the other, or racing with --jobs. Such runs are
+// refused before anything is written.
+static auto check_output_names(const std::vector<WorkItem>& items) -> bool {
+  std::unordered_map<std::string, const std::string*> seen;
+  for(const auto& item : items) {
+    const auto base = output_base(item.name);
+    const auto [it, added] = seen.try_emplace(base, &item.name);
+    if(added) continue;
+
+    spng::set_console(spng::ConFg::Red);
+    spng::set_console(spng::ConStyle::Bold);
+    std::print("FILE I/O :: ");
+    spng::reset_console();
+    std::println("For {} :: would write the same outputs ({}.*) as {}, inspect them in separate runs",
+      item.name,
+      base,
+      *it->second);
+    return false;
+  }
+  return true;
+}
+
+static auto do_item_cycle(const WorkItem& item) -> bool {
+  return item.bytes
+    ? spng::do_buffer_cycle(item.name, *item.bytes)
+    : spng::do_file_cycle(item.name);
+}
+
+auto spng::run_file_cycles(const std::vector<std::string>& files) -> bool {
+  // Files unchanged since the text index was last written still
+  // go through every other stage, only their text isn't indexed
+  // again.
+  if(!Context::get().text_index_.empty()) {
+    carry_text_index();
+  }
+
+  // A census is only useful over the whole corpus, and a watch
+  // never ends, so there bad files are reported and skipped.
+  const bool keep_going = Context::get().flags_ & Context::Census || !Context::get().watch_.empty();
+
+  // Archives are opened up front, so their members are
+  // shared out between workers like any other file.
+  // A carve treats an archive as just another blob.
+  Archives archives;
+  std::vector<WorkItem> items;
+  items.reserve(files.size());
+  bool opened = true;
+  for(const auto& file : files) {
+    if(!has_extension(file, ".tar") || Context::get().flags_ & Context::Carve) {
+      items.emplace_back(file, std::nullopt);
+    } else if(!expand_archive(file, archives, items)) {
+      opened = false;
+      if(!keep_going) return false;
+    }
+  }
+
+  if(writes_named_outputs() && !check_output_names(items)) {
+    return false;
+  }
+
+  size_t jobs = Context::get().jobs_;
+  if(jobs == 0) {
+    jobs = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  jobs = std::min(jobs, items.size());
+  if(jobs <= 1) {
+    bool ok = opened;
+    for(const auto& item : items) {
+      if(!do_item_cycle(item)) {
+        ok = false;
+        if(!keep_going) break;
+      }
+    }
+    return ok;
+  }
+
+  // Workers pull the next file off a shared counter.
+  // A failure stops everyone from taking new files,
+  // files already in flight still finish.
+  std::atomic<size_t> next = 0;
+  std::atomic<bool> failed = false;
+  auto worker = [&]() -> void {
+    while(keep_going || !failed.load(std::memory_order_relaxed)) {
+      const size_t ind = next.fetch_add(1, std::memory_order_relaxed);
+      if(ind >= items.size()) {
+        break;
+      } if(!do_item_cycle(items[ind])) {
+        failed.store(true, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  std::vector<std::jthread> workers;
+  workers.reserve(jobs);
+  for(size_t i = 0; i < jobs; i++) {
+    workers.emplace_back(worker);
+  }
+
+  workers.clear();
+  return opened && !failed.load();
+}
+
+auto spng::finish_file_cycles() -> bool {
+  Stats::print_report();
+  if(Context::get().flags_ & Context::Census) {
+    Census::print_report();
+  } if(Context::get().flags_ & Context::Hash) {
+    Dedupe::print_report();
+  } if(Context::get().flags_ & Context::Profiles) {
+    Profiles::print_report();
+  }
+
+  if(const auto& trace_path = Context::get().trace_path_; !trace_path.empty()) {
+    try {
+      Trace::write_json(trace_path);
+    } catch(const std::exception& e) {
+      set_console(ConFg::Red);
+      set_console(ConStyle::Bold);
+      std::print("FILE I/O :: ");
+      reset_console();
+      std::println("For {} :: {}", trace_path, e.what());
+      return false;
+    }
+  }
+
+  if(const auto& text_path = Context::get().text_index_; !text_path.empty()) {
+    try {
+      text_index_writer().write(text_path);
+    } catch(const std::exception& e) {
+      set_console(ConFg::Red);
+      set_console(ConStyle::Bold);
+      std::print("FILE I/O :: ");
+      reset_console();
+      std::println("For {} :: {}", text_path, e.what());
+      return false;
+    }
+
+    if(!(Context::get().flags_ & Context::Silent)) {
+      std::println("Text index written to {} ({} files, {} text chunks).",
+        text_path,
+        text_index_writer().num_files(),
+        text_index_writer().num_texts());
+    }
+  }
+
+  const auto& index_path = Context::get().export_index_;
+  if(index_path.empty()) {
+    return true;
+  }
+
+  try {
+    index_writer().write(index_path);
+  } catch(const std::exception& e) {
+    set_console(ConFg::Red);
+    set_console(ConStyle::Bold);
+    std::print("FILE I/O :: ");
+    reset_console();
+    std::println("For {} :: {}", index_path, e.what());
+    return false;
+  }
+
+  if(!(Context::get().flags_ & Context::Silent)) {
+    std::println("Chunk index written to {} ({} files, {} chunks).",
+      index_path,
+      index_writer().num_files(),
+      index_writer().num_chunks());
+  }
+
+  return true;
+}
+
+auto spng::run_text_query() -> bool {
+  const auto& index_path = Context::get().text_index_;
+  const std::string_view pattern = Context::get().query_;
+  const size_t eq = pattern.find('=');
+  const size_t len = eq == std::string_view::npos ? pattern.size() : pattern.size() - eq - 1;
+
+  // Same output as --grep, minus the chunk type.
+  try {
+    const TextIndex::Reader index(index_path);
+    for(const auto& hit : index.query(pattern)) {
+      const auto text = index.text(hit.text);
+      set_console(ConFg::White);
+      set_console(ConStyle::Bold);
+      std::print("{}", index.file(hit.file).path);
+      reset_console();
+      std::print(" :: ");
+      set_console(ConFg::Yellow);
+      std::print("{}", text.keyword);
+      reset_console();
+      if(hit.keyword) {
+        std::println("");
+      } else {
+        const std::span value(reinterpret_cast<const uint8_t*>(text.value.data()), text.value.size());
+        std::println(" = {}", excerpt_of(value, hit.at, len));
+      }
+    }
+  } catch(const std::exception& e) {
+    set_console(ConFg::Red);
+    set_console(ConStyle::Bold);
+    std::print("FILE I/O :: ");
+    reset_console();
+    std::println("For {} :: {}", index_path, e.what());
     return false;
   }
 
   return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,127 @@
+#include <Hash.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+// XXH64 as specified in xxhash's doc/xxhash_spec.md:
+// four lanes over 32-byte stripes, then a merge, the
+// remaining bytes, and an avalanche.
+namespace {
+  constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+  constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+  constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+  constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+  auto read64(const uint8_t* p) -> uint64_t {
+    uint64_t v = 0;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr(std::endian::native == std::endian::big) {
+      v = std::byteswap(v);
+    }
+    return v;
+  }
+
+  auto read32(const uint8_t* p) -> uint32_t {
+    uint32_t v = 0;
+    std::memcpy(&v, p, sizeof(v));
+    if constexpr(std::endian::native == std::endian::big) {
+      v = std::byteswap(v);
+    }
+    return v;
+  }
+
+  auto round(uint64_t acc, const uint64_t input) -> uint64_t {
+    acc += input * prime2;
+    acc  = std::rotl(acc, 31);
+    return acc * prime1;
+  }
+
+  auto merge_round(uint64_t acc, const uint64_t val) -> uint64_t {
+    acc ^= round(0, val);
+    return acc * prime1 + prime4;
+  }
+
+  auto stripes(std::array<uint64_t, 4>& acc, const uint8_t* p, const size_t count) -> void {
+    for(size_t i = 0; i < count; i++, p += 32) {
+      acc[0] = round(acc[0], read64(p));
+      acc[1] = round(acc[1], read64(p + 8));
+      acc[2] = round(acc[2], read64(p + 16));
+      acc[3] = round(acc[3], read64(p + 24));
+    }
+  }
+
+  auto finish(uint64_t h, const uint8_t* p, size_t left) -> uint64_t {
+    for(; left >= 8; left -= 8, p += 8) {
+      h ^= round(0, read64(p));
+      h  = std::rotl(h, 27) * prime1 + prime4;
+    } if(left >= 4) {
+      h ^= uint64_t(read32(p)) * prime1;
+      h  = std::rotl(h, 23) * prime2 + prime3;
+      left -= 4;
+      p    += 4;
+    }
+    for(; left > 0; left--, p++) {
+      h ^= *p * prime5;
+      h  = std::rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+  }
+
+  auto converge(const std::array<uint64_t, 4>& acc) -> uint64_t {
+    uint64_t h = std::rotl(acc[0], 1) + std::rotl(acc[1], 7) + std::rotl(acc[2], 12) + std::rotl(acc[3], 18);
+    for(const uint64_t lane : acc) {
+      h = merge_round(h, lane);
+    }
+    return h;
+  }
+}
+
+auto spng::xxh64(const std::span<const uint8_t> bytes, const uint64_t seed) -> uint64_t {
+  Xxh64 state(seed);
+  state.update(bytes);
+  return state.digest();
+}
+
+auto spng::Xxh64::update(const std::span<const uint8_t> bytes) -> void {
+  const uint8_t* p = bytes.data();
+  size_t left = bytes.size();
+  total_ += left;
+
+  // Top up a partial stripe first.
+  if(buffered_ != 0) {
+    const size_t take = std::min(left, buf_.size() - buffered_);
+    std::memcpy(buf_.data() + buffered_, p, take);
+    buffered_ += take;
+    p    += take;
+    left -= take;
+    if(buffered_ < buf_.size()) {
+      return;
+    }
+    stripes(acc_, buf_.data(), 1);
+    buffered_ = 0;
+  }
+
+  const size_t whole = left / 32;
+  stripes(acc_, p, whole);
+  p    += whole * 32;
+  left -= whole * 32;
+
+  std::memcpy(buf_.data(), p, left);
+  buffered_ = left;
+}
+
+auto spng::Xxh64::digest() const -> uint64_t {
+  const uint64_t h = total_ >= 32 ? converge(acc_) : seed_ + prime5;
+  return finish(h + total_, buf_.data(), buffered_);
+}
+
+spng::Xxh64::Xxh64(const uint64_t seed) : seed_(seed) {
+  acc_ = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+}
@@ -4,6 +4,8 @@
 #include <ios>
 #include <fstream>
 
+namespace fs = std::filesystem;
+
 spng::InFileRef::InFileRef(const std::string& file_name) {
   if(!fs::exists(file_name)) {
     throw std::ios_base::failure(fmt("\"{}\" does not exist.", file_name));
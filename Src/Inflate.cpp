@@ -0,0 +1,480 @@
+#include <Inflate.hpp>
+#include <Crc.hpp>
+#include <CompileAttrs.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <numeric>
+
+namespace {
+  constexpr size_t window_size = 32768;
+  constexpr size_t flush_size  = 65536;  // Output gathered before it's handed to the sink.
+  constexpr size_t max_match   = 258;
+
+  constexpr std::array<uint16_t, 31> length_base = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258, 0, 0
+  };
+
+  constexpr std::array<uint8_t, 31> length_extra = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0, 0
+  };
+
+  constexpr std::array<uint16_t, 32> dist_base = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577, 0, 0
+  };
+
+  constexpr std::array<uint8_t, 32> dist_extra = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 0, 0
+  };
+
+  // Order in which code length code lengths are stored.
+  constexpr std::array<uint8_t, 19> clen_order = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+  };
+
+  auto bit_reverse(uint32_t val, const int bits) -> uint32_t {
+    uint32_t res = 0;
+    for(int i = 0; i < bits; i++) {
+      res = (res << 1) | (val & 1U);
+      val >>= 1;
+    }
+    return res;
+  }
+
+  [[noreturn]] auto bad_stream(const char* what) -> void {
+    throw std::runtime_error(std::string("corrupted zlib stream - ") + what);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Inflater::Huffman::build(const std::span<const uint8_t> lengths) -> void {
+  std::array<int32_t, 17> sizes{};
+  std::array<int32_t, 16> next_code{};
+  fast.fill(0);
+
+  for(const auto len : lengths) {
+    ++sizes[len];
+  }
+
+  sizes[0] = 0;
+  for(int i = 1; i < 16; i++) {
+    if(sizes[i] > (1 << i)) bad_stream("bad code lengths");
+  }
+
+  // Canonical codes: each length's codes follow on
+  // from the last code of the previous length.
+  int32_t code = 0;
+  int32_t sym  = 0;
+  for(int i = 1; i < 16; i++) {
+    next_code[i]    = code;
+    first_code[i]   = static_cast<uint16_t>(code);
+    first_symbol[i] = static_cast<uint16_t>(sym);
+    code += sizes[i];
+    if(sizes[i] != 0 && code - 1 >= (1 << i)) {
+      bad_stream("bad code lengths");
+    }
+    max_code[i] = code << (16 - i);
+    code <<= 1;
+    sym += sizes[i];
+  }
+
+  max_code[16] = 0x10000;
+  for(size_t i = 0; i < lengths.size(); i++) {
+    const int len = lengths[i];
+    if(len == 0) continue;
+
+    const auto canon = static_cast<size_t>(next_code[len] - first_code[len] + first_symbol[len]);
+    size[canon]  = static_cast<uint8_t>(len);
+    value[canon] = static_cast<uint16_t>(i);
+
+    // Codes are stored MSB first but read LSB first,
+    // so the table is indexed by the reversed code.
+    if(len <= fast_bits) {
+      const auto entry = static_cast<uint16_t>((len << fast_bits) | i);
+      for(auto j = bit_reverse(next_code[len], len); j < fast.size(); j += 1U << len) {
+        fast[j] = entry;
+      }
+    }
+
+    ++next_code[len];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+spng::Inflater::Inflater(const bool zlib, const size_t max_output)
+  : zlib_(zlib), max_output_(max_output) {}
+
+SPNG_FORCEINLINE auto spng::Inflater::_refill() -> void {
+  while(bitcount_ <= 56) {
+    while(part_ < parts_.size() && part_pos_ == parts_[part_].size()) {
+      ++part_;
+      part_pos_ = 0;
+    }
+
+    if(part_ < parts_.size()) {
+      bitbuf_ |= uint64_t(parts_[part_][part_pos_++]) << bitcount_;
+      ++pulled_;
+    } else if(++padding_ > sizeof(bitbuf_)) {
+      // Everything in the bit buffer is padding, and
+      // we still want more: the stream was cut short.
+      bad_stream("unexpected end of data");
+    }
+
+    bitcount_ += 8;
+  }
+}
+
+SPNG_FORCEINLINE auto spng::Inflater::_bits(const int count) -> uint32_t {
+  if(bitcount_ < count) {
+    _refill();
+  }
+
+  const auto val = static_cast<uint32_t>(bitbuf_ & ((uint64_t(1) << count) - 1));
+  bitbuf_   >>= count;
+  bitcount_  -= count;
+  return val;
+}
+
+SPNG_FORCEINLINE auto spng::Inflater::_decode(const Huffman& huff) -> uint32_t {
+  if(bitcount_ < 16) {
+    _refill();
+  }
+
+  if(const auto entry = huff.fast[bitbuf_ & ((1U << Huffman::fast_bits) - 1)]; entry != 0) {
+    const int len = entry >> Huffman::fast_bits;
+    bitbuf_   >>= len;
+    bitcount_  -= len;
+    return entry & ((1U << Huffman::fast_bits) - 1);
+  }
+
+  // Longer than the table covers: find the length
+  // whose range of left-justified codes contains ours.
+  const auto code = static_cast<int32_t>(bit_reverse(static_cast<uint32_t>(bitbuf_ & 0xFFFF), 16));
+  int len = Huffman::fast_bits + 1;
+  while(len < 16 && code >= huff.max_code[len]) {
+    ++len;
+  }
+
+  if(len >= 16) {
+    bad_stream("invalid huffman code");
+  }
+
+  const auto canon = static_cast<size_t>((code >> (16 - len)) - huff.first_code[len] + huff.first_symbol[len]);
+  if(canon >= huff.size.size() || huff.size[canon] != len) {
+    bad_stream("invalid huffman code");
+  }
+
+  bitbuf_   >>= len;
+  bitcount_  -= len;
+  return huff.value[canon];
+}
+
+auto spng::Inflater::_flush() -> void {
+  const std::span<const uint8_t> out(window_.data() + flushed_, out_pos_ - flushed_);
+  if(out.empty()) {
+    return;
+  } if(max_output_ != 0 && total_out_ > max_output_) {
+    bad_stream("output exceeds the size limit");
+  }
+
+  if(zlib_) {
+    adler_ = adler32(out, adler_);
+  }
+
+  (*sink_)(out);
+  flushed_ = out_pos_;
+}
+
+SPNG_FORCEINLINE auto spng::Inflater::_reserve(const size_t count) -> void {
+  if(out_pos_ + count <= window_.size()) {
+    return;
+  }
+
+  // Hand off what we have, then slide the
+  // last 32 KiB down to keep as history.
+  _flush();
+  const size_t keep = std::min(out_pos_, window_size);
+  std::memmove(window_.data(), window_.data() + out_pos_ - keep, keep);
+  out_pos_ = keep;
+  flushed_ = keep;
+}
+
+auto spng::Inflater::_stored_block() -> void {
+  // Skip to the next byte boundary.
+  _bits(bitcount_ % 8);
+  const auto len  = _bits(16);
+  const auto nlen = _bits(16);
+  if((len ^ 0xFFFF) != nlen) {
+    bad_stream("stored block length mismatch");
+  } if(max_output_ != 0 && total_out_ + len > max_output_) {
+    bad_stream("output exceeds the size limit");
+  }
+
+  // Whole bytes may still be sitting in the bit buffer (after
+  // any padding), use those up before copying from the input.
+  size_t left = len;
+  while(left != 0 && static_cast<size_t>(bitcount_ / 8) > padding_) {
+    _reserve(1);
+    window_[out_pos_++] = static_cast<uint8_t>(_bits(8));
+    --left;
+  }
+
+  if(padding_ != 0 && left != 0) {
+    bad_stream("unexpected end of data");
+  }
+
+  while(left != 0) {
+    while(part_ < parts_.size() && part_pos_ == parts_[part_].size()) {
+      ++part_;
+      part_pos_ = 0;
+    }
+
+    if(part_ == parts_.size()) {
+      bad_stream("unexpected end of data");
+    }
+
+    const size_t take = std::min({ left, parts_[part_].size() - part_pos_, flush_size });
+    _reserve(take);
+    std::memcpy(window_.data() + out_pos_, parts_[part_].data() + part_pos_, take);
+    out_pos_  += take;
+    part_pos_ += take;
+    pulled_   += take;
+    left      -= take;
+  }
+
+  total_out_ += len;
+}
+
+auto spng::Inflater::_dynamic_tables() -> void {
+  const auto hlit  = _bits(5) + 257;
+  const auto hdist = _bits(5) + 1;
+  const auto hclen = _bits(4) + 4;
+  if(hlit > 286 || hdist > 30) {
+    bad_stream("too many length or distance codes");
+  }
+
+  std::array<uint8_t, 19> clen_lengths{};
+  for(size_t i = 0; i < hclen; i++) {
+    clen_lengths[clen_order[i]] = static_cast<uint8_t>(_bits(3));
+  }
+
+  Huffman clen;
+  clen.build(clen_lengths);
+
+  // Literal/length and distance code lengths
+  // are run-length coded as one sequence.
+  std::array<uint8_t, 286 + 30> lengths{};
+  size_t count = 0;
+  while(count < hlit + hdist) {
+    const auto sym = _decode(clen);
+    if(sym < 16) {
+      lengths[count++] = static_cast<uint8_t>(sym);
+      continue;
+    }
+
+    uint8_t fill = 0;
+    uint32_t rep = 0;
+    if(sym == 16) {
+      if(count == 0) bad_stream("repeat with no previous length");
+      fill = lengths[count - 1];
+      rep  = _bits(2) + 3;
+    } else if(sym == 17) {
+      rep  = _bits(3) + 3;
+    } else if(sym == 18) {
+      rep  = _bits(7) + 11;
+    } else {
+      bad_stream("invalid code length code");
+    }
+
+    if(count + rep > hlit + hdist) {
+      bad_stream("code lengths overflow");
+    }
+    std::fill_n(lengths.begin() + count, rep, fill);
+    count += rep;
+  }
+
+  if(lengths[256] == 0) {
+    bad_stream("no end-of-block code");
+  }
+
+  lit_.build({ lengths.data(), hlit });
+  dist_.build({ lengths.data() + hlit, hdist });
+}
+
+auto spng::Inflater::_huffman_block(const Huffman& lit, const Huffman& dist) -> void {
+  for(;;) {
+    auto sym = _decode(lit);
+    if(sym < 256) {
+      _reserve(1);
+      window_[out_pos_++] = static_cast<uint8_t>(sym);
+      ++total_out_;
+      continue;
+    } if(sym == 256) {
+      break;
+    }
+
+    sym -= 257;
+    if(sym >= 29) {
+      bad_stream("invalid length code");
+    }
+
+    const size_t len = length_base[sym] + _bits(length_extra[sym]);
+    const auto dsym  = _decode(dist);
+    if(dsym >= 30) {
+      bad_stream("invalid distance code");
+    }
+
+    const size_t distance = dist_base[dsym] + _bits(dist_extra[dsym]);
+    if(distance > total_out_) {
+      bad_stream("distance reaches before the start of the stream");
+    }
+
+    _reserve(max_match);
+    uint8_t* dst = window_.data() + out_pos_;
+    const uint8_t* src = dst - distance;
+    if(distance >= len) {
+      std::memcpy(dst, src, len);
+    } else {
+      // Overlapping: the match repeats itself.
+      for(size_t i = 0; i < len; i++) dst[i] = src[i];
+    }
+
+    out_pos_   += len;
+    total_out_ += len;
+  }
+}
+
+auto spng::Inflater::_start(const std::span<const std::span<const uint8_t>> parts, const Sink& sink) -> void {
+  parts_     = parts;
+  part_      = 0;
+  part_pos_  = 0;
+  bitbuf_    = 0;
+  bitcount_  = 0;
+  padding_   = 0;
+  pulled_    = 0;
+  consumed_  = 0;
+  out_pos_   = 0;
+  flushed_   = 0;
+  total_out_ = 0;
+  adler_     = 1;
+  sink_      = &sink;
+  window_.resize(window_size + flush_size);
+}
+
+auto spng::Inflater::_block(bool& final) -> void {
+  final = _bits(1) != 0;
+  switch(_bits(2)) {
+    case 0: _stored_block(); break;
+    case 1: {
+      static const auto fixed = [] {
+        std::array<uint8_t, 288 + 32> lengths{};
+        std::fill_n(lengths.begin(), 144, 8);
+        std::fill_n(lengths.begin() + 144, 112, 9);
+        std::fill_n(lengths.begin() + 256, 24, 7);
+        std::fill_n(lengths.begin() + 280, 8, 8);
+        std::fill_n(lengths.begin() + 288, 32, 5);
+        std::pair<Huffman, Huffman> tables;
+        tables.first.build({ lengths.data(), 288 });
+        tables.second.build({ lengths.data() + 288, 32 });
+        return tables;
+      }();
+      _huffman_block(fixed.first, fixed.second);
+      break;
+    }
+    case 2:
+      _dynamic_tables();
+      _huffman_block(lit_, dist_);
+      break;
+    default:
+      bad_stream("invalid block type");
+  }
+}
+
+auto spng::Inflater::run(const std::span<const std::span<const uint8_t>> parts, const Sink& sink) -> size_t {
+  _start(parts, sink);
+  if(zlib_) {
+    const auto cmf = _bits(8);
+    const auto flg = _bits(8);
+    if((cmf & 0x0F) != 8 || (cmf >> 4) > 7) {
+      bad_stream("not a deflate stream");
+    } if(((cmf << 8) | flg) % 31 != 0) {
+      bad_stream("bad header check");
+    } if(flg & 0x20) {
+      bad_stream("preset dictionaries are not allowed");
+    }
+  }
+
+  bool final = false;
+  while(!final) {
+    _block(final);
+  }
+
+  _flush();
+  if(padding_ * 8 > static_cast<size_t>(bitcount_)) {
+    bad_stream("unexpected end of data");
+  }
+
+  _bits(bitcount_ % 8);
+  if(zlib_) {
+    uint32_t stored = 0;
+    for(int i = 0; i < 4; i++) {
+      stored = (stored << 8) | _bits(8);
+    }
+    if(padding_ * 8 > static_cast<size_t>(bitcount_)) {
+      bad_stream("missing Adler-32 checksum");
+    } if(stored != adler_) {
+      bad_stream("Adler-32 mismatch");
+    }
+  }
+
+  // Whole bytes left in the bit buffer were read ahead,
+  // they don't count as consumed.
+  consumed_ = pulled_ - (static_cast<size_t>(bitcount_ / 8) - std::min(padding_, static_cast<size_t>(bitcount_ / 8)));
+  sink_ = nullptr;
+  return total_out_;
+}
+
+auto spng::Inflater::run_segment(const std::span<const std::span<const uint8_t>> parts, const Sink& sink) -> size_t {
+  _start(parts, sink);
+
+  // The piece is done once a block ends exactly
+  // at the end of the input, which only an empty
+  // stored block (the flush marker) can do.
+  for(;;) {
+    bool final = false;
+    _block(final);
+    if(final) {
+      bad_stream("final block inside a flush segment");
+    } if(padding_ * 8 > static_cast<size_t>(bitcount_)) {
+      bad_stream("unexpected end of data");
+    }
+
+    const bool input_done = pulled_ == std::accumulate(parts.begin(), parts.end(), size_t(0),
+      [](const size_t sum, const auto& part) { return sum + part.size(); });
+    if(input_done && static_cast<size_t>(bitcount_) == padding_ * 8) {
+      break;
+    }
+  }
+
+  _flush();
+  consumed_ = pulled_;
+  sink_ = nullptr;
+  return total_out_;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::inflate_zlib(const std::span<const uint8_t> in, const size_t max_output) -> FlatBuffer::Buffer {
+  FlatBuffer::Buffer out;
+  const std::array parts = { in };
+  Inflater(true, max_output).run(parts, [&](const std::span<const uint8_t> piece) {
+    out.insert(out.end(), piece.begin(), piece.end());
+  });
+  return out;
+}
@@ -4,6 +4,9 @@
 #include <Fmt.hpp>
 #include <FileCycle.hpp>
 #include <Context.hpp>
+#include <Stats.hpp>
+#include <Server.hpp>
+#include <Watch.hpp>
 #include <print>
 #include <csignal>
 #include <cstdlib>
@@ -40,9 +43,28 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  for(const auto& input : Context::get().ifilenames_) {
-    if(!do_file_cycle(input)) return 1;
+  // Hardware counters are reported as part of the stats.
+  if(Context::get().flags_ & (Context::Stats | Context::PerfCtrs)) {
+    Stats::enable();
+  } if(Context::get().flags_ & Context::PerfCtrs && !Perf::enable()) {
+    set_console(ConFg::Yellow);
+    std::print("Hardware counters unavailable ");
+    reset_console();
+    std::println(":: {}", Perf::unavailable_reason());
+  } if(!Context::get().trace_path_.empty()) {
+    Trace::enable();
   }
 
-  return 0;
+  if(!Context::get().serve_.empty()) {
+    return Server::run(Context::get().serve_) ? 0 : 1;
+  } if(!Context::get().watch_.empty()) {
+    return Watch::run(Context::get().watch_) ? 0 : 1;
+  } if(!Context::get().query_.empty()) {
+    return run_text_query() ? 0 : 1;
+  }
+
+  // Stop at the first failing file, but still
+  // report whatever was gathered up to that point.
+  const bool ok = run_file_cycles(Context::get().ifilenames_);
+  return finish_file_cycles() && ok ? 0 : 1;
 }
@@ -0,0 +1,65 @@
+#include <MappedFile.hpp>
+#include <InFileRef.hpp>
+#include <Fmt.hpp>
+#include <ios>
+
+#if defined(SEE_PNG_POSIX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(SEE_PNG_POSIX)
+
+spng::MappedFile::MappedFile(const std::string& file_name)
+  : name_(file_name) {
+  const int fd = ::open(file_name.c_str(), O_RDONLY);
+  if(fd < 0) {
+    throw std::ios_base::failure(fmt("Could not open file {}.", file_name));
+  }
+
+  struct stat st = {};
+  if(::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    throw std::ios_base::failure(fmt("\"{}\" is not a regular file.", file_name));
+  }
+
+  // mmap() refuses zero-length mappings,
+  // an empty file is simply an empty view.
+  size_ = static_cast<size_t>(st.st_size);
+  if(size_ == 0) {
+    ::close(fd);
+    return;
+  }
+
+  void* addr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(addr == MAP_FAILED) {
+    throw std::ios_base::failure(fmt("Could not map file {}.", file_name));
+  }
+
+  data_ = static_cast<const FlatBuffer::Byte*>(addr);
+}
+
+spng::MappedFile::~MappedFile() {
+  if(data_ != nullptr) {
+    ::munmap(const_cast<FlatBuffer::Byte*>(data_), size_);
+  }
+}
+
+#else
+
+spng::MappedFile::MappedFile(const std::string& file_name)
+  : name_(file_name) {
+  const InFileRef ref(file_name);
+  if(const auto fsize = ref.size(); fsize != 0) {
+    fallback_ = ref.read(fsize);
+    data_     = fallback_->data();
+    size_     = fallback_->size();
+  }
+}
+
+spng::MappedFile::~MappedFile() = default;
+
+#endif
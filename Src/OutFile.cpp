@@ -0,0 +1,179 @@
+#include <OutFile.hpp>
+#include <Fmt.hpp>
+#include <ios>
+#include <algorithm>
+
+#if defined(SEE_PNG_POSIX)
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#else
+#include <fstream>
+#include <filesystem>
+#endif
+
+namespace {
+  // Ranges queued before a flush is forced.
+#if defined(SEE_PNG_POSIX) && defined(IOV_MAX)
+  constexpr size_t max_pending = std::min<size_t>(IOV_MAX, 1024);
+#else
+  constexpr size_t max_pending = 1024;
+#endif
+}
+
+auto spng::OutFile::write(const std::span<const FlatBuffer::Byte> range) -> OutFile& {
+  if(range.empty()) {
+    return *this;
+  }
+
+  // Ranges that continue where the last one
+  // stopped are merged into a single entry.
+  if(!pending_.empty() && pending_.back().data() + pending_.back().size() == range.data()) {
+    pending_.back() = { pending_.back().data(), pending_.back().size() + range.size() };
+  } else {
+    pending_.emplace_back(range);
+  }
+
+  written_ += range.size();
+  if(pending_.size() >= max_pending) {
+    flush();
+  }
+
+  return *this;
+}
+
+#if defined(SEE_PNG_POSIX)
+
+spng::OutFile::OutFile(const std::string& file_name, const bool atomic)
+  : name_(file_name) {
+  if(!atomic) {
+    fd_ = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd_ < 0) {
+      throw std::ios_base::failure(fmt("Failed to open output file \"{}\".", file_name));
+    }
+    return;
+  }
+
+  // The temporary has to be in the same directory
+  // as the target, or rename() can't be atomic.
+  temp_name_ = file_name + ".XXXXXX";
+  fd_ = ::mkstemp(temp_name_.data());
+  if(fd_ < 0) {
+    temp_name_.clear();
+    throw std::ios_base::failure(fmt("Failed to create a temporary file next to \"{}\".", file_name));
+  }
+
+  // mkstemp() creates the file as 0600,
+  // keep the permissions of the file being replaced.
+  struct stat st = {};
+  if(::stat(file_name.c_str(), &st) == 0) {
+    ::fchmod(fd_, st.st_mode & 07777);
+  }
+}
+
+spng::OutFile::~OutFile() {
+  if(fd_ >= 0) {
+    ::close(fd_);
+  } if(!committed_ && !temp_name_.empty()) {
+    ::unlink(temp_name_.c_str());
+  }
+}
+
+auto spng::OutFile::flush() -> void {
+  std::vector<iovec> iov;
+  iov.reserve(pending_.size());
+  for(const auto& range : pending_) {
+    iov.emplace_back(const_cast<FlatBuffer::Byte*>(range.data()), range.size());
+  }
+  pending_.clear();
+
+  // writev() may stop short, pick up
+  // from wherever it left off.
+  size_t first = 0;
+  while(first < iov.size()) {
+    const auto count = static_cast<int>(iov.size() - first);
+    const ssize_t res = ::writev(fd_, iov.data() + first, count);
+    if(res < 0) {
+      if(errno == EINTR) continue;
+      throw std::ios_base::failure(fmt("Failed to write to \"{}\".", name_));
+    }
+
+    auto left = static_cast<size_t>(res);
+    while(first < iov.size() && left >= iov[first].iov_len) {
+      left -= iov[first].iov_len;
+      ++first;
+    } if(left != 0) {
+      iov[first].iov_base = static_cast<uint8_t*>(iov[first].iov_base) + left;
+      iov[first].iov_len -= left;
+    }
+  }
+}
+
+auto spng::OutFile::commit() -> void {
+  flush();
+  if(!temp_name_.empty() && ::fsync(fd_) != 0) {
+    throw std::ios_base::failure(fmt("Failed to sync \"{}\".", temp_name_));
+  }
+
+  const int fd = fd_;
+  fd_ = -1;
+  if(::close(fd) != 0) {
+    throw std::ios_base::failure(fmt("Failed to write to \"{}\".", name_));
+  } if(!temp_name_.empty() && ::rename(temp_name_.c_str(), name_.c_str()) != 0) {
+    throw std::ios_base::failure(fmt("Failed to replace \"{}\".", name_));
+  }
+
+  committed_ = true;
+}
+
+#else
+
+spng::OutFile::OutFile(const std::string& file_name, const bool atomic)
+  : name_(file_name) {
+  if(atomic) {
+    temp_name_ = file_name + ".tmp";
+  }
+
+  const auto& path = atomic ? temp_name_ : name_;
+  stream_ = std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+  if(!stream_->is_open()) {
+    temp_name_.clear();
+    throw std::ios_base::failure(fmt("Failed to open output file \"{}\".", path));
+  }
+}
+
+spng::OutFile::~OutFile() {
+  stream_.reset();
+  if(!committed_ && !temp_name_.empty()) {
+    std::error_code ec;
+    std::filesystem::remove(temp_name_, ec);
+  }
+}
+
+auto spng::OutFile::flush() -> void {
+  for(const auto& range : pending_) {
+    stream_->write(reinterpret_cast<const char*>(range.data()), static_cast<std::streamsize>(range.size()));
+  }
+
+  pending_.clear();
+  if(!stream_->good()) {
+    throw std::ios_base::failure(fmt("Failed to write to \"{}\".", name_));
+  }
+}
+
+auto spng::OutFile::commit() -> void {
+  flush();
+  stream_->close();
+  if(stream_->fail()) {
+    throw std::ios_base::failure(fmt("Failed to write to \"{}\".", name_));
+  } if(!temp_name_.empty()) {
+    std::filesystem::rename(temp_name_, name_);
+  }
+
+  committed_ = true;
+}
+
+#endif
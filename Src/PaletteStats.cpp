@@ -0,0 +1,149 @@
+#include <PaletteStats.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+auto spng::PaletteStats::add_row(const std::span<const uint8_t> row) -> void {
+  const size_t per_byte = 8 / depth_;
+  const size_t whole    = std::min<size_t>(width_ / per_byte, row.size());
+  const uint8_t* p = row.data();
+
+  auto& [h0, h1, h2, h3] = bytes_;
+  size_t i = 0;
+  for(; i + 4 <= whole; i += 4) {
+    ++h0[p[i]];
+    ++h1[p[i + 1]];
+    ++h2[p[i + 2]];
+    ++h3[p[i + 3]];
+  }
+  for(; i < whole; i++) {
+    ++h0[p[i]];
+  }
+
+  // The last byte may be partly padding.
+  const size_t left = width_ - whole * per_byte;
+  if(left != 0 && whole < row.size()) {
+    const uint8_t mask = static_cast<uint8_t>((1U << depth_) - 1);
+    for(size_t k = 0; k < left; k++) {
+      ++tail_[(p[whole] >> (8 - depth_ * (k + 1))) & mask];
+    }
+  }
+}
+
+auto spng::PaletteStats::entries() const -> std::vector<Entry> {
+  std::array<uint64_t, 256> uses = tail_;
+  const size_t per_byte = 8 / depth_;
+  const uint8_t mask    = static_cast<uint8_t>((1U << depth_) - 1);
+  for(size_t b = 0; b < 256; b++) {
+    const uint64_t count = bytes_[0][b] + bytes_[1][b] + bytes_[2][b] + bytes_[3][b];
+    if(count == 0) continue;
+    for(size_t k = 0; k < per_byte; k++) {
+      uses[(b >> (8 - depth_ * (k + 1))) & mask] += count;
+    }
+  }
+
+  std::vector<Entry> the_entries(palette_.size());
+  for(size_t i = 0; i < palette_.size(); i++) {
+    auto& e = the_entries[i];
+    e.rgba = { palette_[i].red, palette_[i].green, palette_[i].blue, i < alpha_.size() ? alpha_[i] : uint8_t(255) };
+    e.uses = uses[i];
+    if(has_hist_ && i < hist_.size()) {
+      e.hist = hist_[i];
+    }
+  }
+
+  // Only used entries count as duplicates; an unused
+  // copy is already reported as unused.
+  for(size_t i = 0; i < the_entries.size(); i++) {
+    if(the_entries[i].uses == 0) continue;
+    for(size_t j = 0; j < i; j++) {
+      if(the_entries[j].uses != 0 && the_entries[j].rgba == the_entries[i].rgba) {
+        the_entries[i].duplicate_of = static_cast<int32_t>(j);
+        break;
+      }
+    }
+  }
+
+  return the_entries;
+}
+
+auto spng::PaletteStats::summary() const -> Summary {
+  const auto all = entries();
+  Summary sum;
+  sum.entries   = palette_.size();
+  sum.trns_size = alpha_.size();
+  sum.depth     = depth_;
+  sum.has_hist  = has_hist_;
+
+  for(const auto& e : all) {
+    const bool used = e.uses != 0;
+    sum.used        += used;
+    sum.duplicates  += e.duplicate_of >= 0;
+    sum.transparent += e.rgba[3] == 0;
+    if(used && e.duplicate_of < 0) {
+      sum.distinct    += 1;
+      sum.trns_needed += e.rgba[3] != 255;
+    } if(e.hist && (*e.hist != 0) != used) {
+      sum.hist_stale  += 1;
+    }
+  }
+
+  // Anything the palette doesn't cover. An 8-bit index can
+  // reach 255, lower depths can't go past 2^depth - 1.
+  std::array<uint64_t, 256> uses{};
+  for(const auto& row : bytes_) {
+    for(size_t b = 0; b < 256; b++) uses[b] += row[b];
+  }
+  if(depth_ == 8) {
+    for(size_t i = palette_.size(); i < 256; i++) {
+      sum.out_of_range += uses[i] + tail_[i];
+    }
+  } else {
+    const size_t per_byte = 8 / depth_;
+    const uint8_t mask    = static_cast<uint8_t>((1U << depth_) - 1);
+    for(size_t b = 0; b < 256; b++) {
+      for(size_t k = 0; k < per_byte; k++) {
+        if(((b >> (8 - depth_ * (k + 1))) & mask) >= palette_.size()) sum.out_of_range += uses[b];
+      }
+    }
+    for(size_t i = palette_.size(); i < 256; i++) {
+      sum.out_of_range += tail_[i];
+    }
+  }
+
+  sum.min_depth = 1;
+  while(sum.min_depth < 8 && (size_t(1) << sum.min_depth) < sum.distinct) {
+    sum.min_depth *= 2;
+  }
+  return sum;
+}
+
+spng::PaletteStats::PaletteStats(const Carrier& carrier) {
+  const auto ihdr = carrier.metadata();
+  if(ihdr.color_type() != Ihdr::ColorType::IndexedColor) {
+    throw std::runtime_error("Not an indexed colour image.");
+  }
+
+  depth_ = ihdr.bit_depth();
+  width_ = ihdr.width();
+  if(depth_ != 1 && depth_ != 2 && depth_ != 4 && depth_ != 8) {
+    throw std::runtime_error("Invalid bit depth for an indexed colour image.");
+  }
+
+  for(const auto& chunk : carrier.chunks()) {
+    switch(chunk.type()) {
+      case Chunk::Type::PLTE: palette_ = chunk.as<Plte>().entries(); break;
+      case Chunk::Type::tRNS: alpha_   = chunk.as<Trns>().palette_alpha(); break;
+      case Chunk::Type::hIST:
+        hist_     = chunk.as<Hist>().frequencies();
+        has_hist_ = true;
+        break;
+      default: break;
+    }
+  }
+
+  if(palette_.empty()) {
+    throw std::runtime_error("Indexed color image has no PLTE chunk.");
+  } if(palette_.size() > 256) {
+    throw std::runtime_error("Invalid PLTE chunk size.");
+  }
+}
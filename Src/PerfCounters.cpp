@@ -0,0 +1,157 @@
+#include <PerfCounters.hpp>
+#include <Fmt.hpp>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+  using spng::Perf::Event;
+
+  std::string reason;
+  std::array<std::atomic<bool>, size_t(Event::Count)> event_ok = {};
+
+  constexpr std::array event_names = {
+    "cycles", "instructions", "cache-misses", "branch-misses"
+  };
+
+  static_assert(event_names.size() == size_t(Event::Count));
+
+#if defined(__linux__)
+  constexpr std::array<uint64_t, size_t(Event::Count)> event_configs = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+  };
+
+  auto open_event(const uint64_t config, const int group_fd) -> int {
+    perf_event_attr attr = {};
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.size           = sizeof(attr);
+    attr.config         = config;
+    attr.disabled       = group_fd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP
+                        | PERF_FORMAT_TOTAL_TIME_ENABLED
+                        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+  }
+
+  // One counter group per thread. "slot" maps each
+  // Event to its position in the group read, or -1.
+  struct ThreadGroup {
+    int leader = -1;
+    std::array<int, size_t(Event::Count)> fds  = { -1, -1, -1, -1 };
+    std::array<int, size_t(Event::Count)> slot = { -1, -1, -1, -1 };
+    size_t count = 0;
+
+    auto open() -> bool {
+      leader = open_event(event_configs[0], -1);
+      if(leader < 0) {
+        return false;
+      }
+
+      fds[0]  = leader;
+      slot[0] = 0;
+      count   = 1;
+      for(size_t i = 1; i < event_configs.size(); i++) {
+        const int fd = open_event(event_configs[i], leader);
+        if(fd >= 0) {
+          fds[i]  = fd;
+          slot[i] = static_cast<int>(count++);
+        }
+      }
+
+      ::ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ::ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+      return true;
+    }
+
+    ~ThreadGroup() {
+      for(const int fd : fds) {
+        if(fd >= 0) ::close(fd);
+      }
+    }
+  };
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Perf::enable() -> bool {
+#if defined(__linux__)
+  // Probe once on this thread, so we can report
+  // up front whether counters work at all.
+  ThreadGroup probe;
+  if(!probe.open()) {
+    reason = spng::fmt("perf_event_open failed: {} "
+      "(check /proc/sys/kernel/perf_event_paranoid)", std::strerror(errno));
+    return false;
+  }
+
+  for(size_t i = 0; i < event_ok.size(); i++) {
+    event_ok[i].store(probe.slot[i] >= 0, std::memory_order_relaxed);
+  }
+
+  enabled_.store(true, std::memory_order_relaxed);
+  return true;
+#else
+  reason = "hardware counters are only supported on Linux";
+  return false;
+#endif
+}
+
+auto spng::Perf::read(Sample& out) -> bool {
+  out.fill(0);
+#if defined(__linux__)
+  if(!enabled()) return false;
+
+  thread_local ThreadGroup group;
+  thread_local bool opened = group.open();
+  if(!opened) return false;
+
+  // PERF_FORMAT_GROUP layout: nr, time_enabled, time_running, values[nr]
+  std::array<uint64_t, 3 + size_t(Event::Count)> buff = {};
+  if(::read(group.leader, buff.data(), sizeof(buff)) < static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+    return false;
+  }
+
+  // Scale for time the group wasn't scheduled
+  // on the PMU because of multiplexing.
+  const uint64_t time_enabled = buff[1];
+  const uint64_t time_running = buff[2];
+  const double scale = time_running
+    ? static_cast<double>(time_enabled) / static_cast<double>(time_running)
+    : 1.0;
+
+  for(size_t i = 0; i < out.size(); i++) {
+    if(group.slot[i] >= 0 && static_cast<uint64_t>(group.slot[i]) < buff[0]) {
+      out[i] = static_cast<uint64_t>(static_cast<double>(buff[3 + group.slot[i]]) * scale);
+    }
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+auto spng::Perf::supported(const Event ev) -> bool {
+  return event_ok.at(size_t(ev)).load(std::memory_order_relaxed);
+}
+
+auto spng::Perf::event_name(const Event ev) -> const char* {
+  return event_names.at(size_t(ev));
+}
+
+auto spng::Perf::unavailable_reason() -> const std::string& {
+  return reason;
+}
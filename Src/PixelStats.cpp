@@ -0,0 +1,227 @@
+#include <PixelStats.hpp>
+#include <Panic.hpp>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPNG_PIXSTATS_SSE2
+#endif
+
+// Flags reduced over a run of pixels.
+struct RowFlags {
+  bool opaque    = true;
+  bool binary    = true;
+  bool gray      = true;
+  bool fits_8bit = true;
+};
+
+// Reduces pixels [first, count) one at a time.
+// Used on its own without SSE2, and for the tail.
+static auto reduce_scalar(const uint8_t* row, const size_t first, const size_t count, const bool wide) -> RowFlags {
+  RowFlags flags;
+  for(size_t x = first; x < count; x++) {
+    if(wide) {
+      uint16_t px[4];
+      std::memcpy(px, row + x * 8, sizeof(px));
+      flags.opaque    &= px[3] == 0xFFFF;
+      flags.binary    &= px[3] == 0xFFFF || px[3] == 0;
+      flags.gray      &= px[0] == px[1] && px[1] == px[2];
+      for(const uint16_t v : px) {
+        flags.fits_8bit &= (v >> 8) == (v & 0xFF);
+      }
+    } else {
+      const uint8_t* px = row + x * 4;
+      flags.opaque &= px[3] == 0xFF;
+      flags.binary &= px[3] == 0xFF || px[3] == 0;
+      flags.gray   &= px[0] == px[1] && px[1] == px[2];
+    }
+  }
+  return flags;
+}
+
+#ifdef SPNG_PIXSTATS_SSE2
+// 16 bytes at a time: AND-accumulate alpha and the
+// "alpha is 0 or max" masks, and OR-accumulate the
+// differences between neighbouring colour samples.
+// Returns the number of pixels covered, the rest is
+// left to reduce_scalar().
+static auto reduce_sse2(const uint8_t* row, const size_t count, const bool wide, RowFlags& flags) -> size_t {
+  const size_t px_size = wide ? 8 : 4;
+  const size_t bytes   = count * px_size / 16 * 16;
+  const __m128i zero   = _mm_setzero_si128();
+  const __m128i ones   = _mm_set1_epi8(-1);
+
+  __m128i alpha_and  = ones;
+  __m128i binary_and = ones;
+  __m128i gray_or    = zero;
+  __m128i wide_or    = zero;
+
+  if(wide) {
+    // Pixel = R G B A as 16-bit lanes. Low 32 bits of (px ^ px >> 16) are R^G, G^B.
+    const __m128i gray_mask = _mm_set_epi32(0, -1, 0, -1);
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    for(size_t i = 0; i < bytes; i += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      alpha_and  = _mm_and_si128(alpha_and, v);
+      binary_and = _mm_and_si128(binary_and, _mm_or_si128(_mm_cmpeq_epi16(v, zero), _mm_cmpeq_epi16(v, ones)));
+      gray_or    = _mm_or_si128(gray_or, _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi64(v, 16)), gray_mask));
+      wide_or    = _mm_or_si128(wide_or, _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi16(v, 8)), low_bytes));
+    }
+  } else {
+    // Pixel = R G B A as bytes. Low 16 bits of (px ^ px >> 8) are R^G, G^B.
+    const __m128i gray_mask = _mm_set1_epi32(0x0000FFFF);
+    for(size_t i = 0; i < bytes; i += 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+      alpha_and  = _mm_and_si128(alpha_and, v);
+      binary_and = _mm_and_si128(binary_and, _mm_or_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(v, ones)));
+      gray_or    = _mm_or_si128(gray_or, _mm_and_si128(_mm_xor_si128(v, _mm_srli_epi32(v, 8)), gray_mask));
+    }
+  }
+
+  // Bytes that hold alpha: 3, 7, 11, 15, or 6-7 and 14-15.
+  const int alpha_bytes = wide ? 0xC0C0 : 0x8888;
+  flags.opaque    = (_mm_movemask_epi8(_mm_cmpeq_epi8(alpha_and, ones)) & alpha_bytes) == alpha_bytes;
+  flags.binary    = (_mm_movemask_epi8(binary_and) & alpha_bytes) == alpha_bytes;
+  flags.gray      = _mm_movemask_epi8(_mm_cmpeq_epi8(gray_or, zero)) == 0xFFFF;
+  flags.fits_8bit = _mm_movemask_epi8(_mm_cmpeq_epi8(wide_or, zero)) == 0xFFFF;
+  return bytes / px_size;
+}
+#endif
+
+auto spng::PixelStats::add_row(const std::span<const uint8_t> row) -> void {
+  const size_t px_size = wide_ ? 8 : 4;
+  const size_t count   = row.size() / px_size;
+  const uint8_t* data  = row.data();
+
+  RowFlags flags;
+  size_t done = 0;
+#ifdef SPNG_PIXSTATS_SSE2
+  done = reduce_sse2(data, count, wide_, flags);
+#endif
+  const RowFlags tail = reduce_scalar(data, done, count, wide_);
+  opaque_    &= flags.opaque && tail.opaque;
+  binary_    &= flags.binary && tail.binary;
+  gray_      &= flags.gray && tail.gray;
+  fits_8bit_ &= flags.fits_8bit && tail.fits_8bit;
+
+  // Histograms alternate between two tables so consecutive
+  // increments of the same bin don't wait on each other.
+  // Unique colours skip runs of the same colour, which is
+  // most of the pixels in a typical image.
+  uint64_t last = 0;
+  for(size_t x = 0; x < count; x++) {
+    const size_t tables = x & 1;
+    uint64_t color = 0;
+    if(wide_) {
+      uint16_t px[4];
+      std::memcpy(px, data + x * 8, sizeof(px));
+      for(size_t c = 0; c < 4; c++) {
+        ++hist_[c][tables][px[c] >> 8];
+      }
+      std::memcpy(&color, px, sizeof(color));
+    } else {
+      const uint8_t* px = data + x * 4;
+      for(size_t c = 0; c < 4; c++) {
+        ++hist_[c][tables][px[c]];
+      }
+      uint32_t packed = 0;
+      std::memcpy(&packed, px, sizeof(packed));
+      color = packed;
+    }
+
+    if(!colors_full_ && (x == 0 || color != last)) {
+      _add_unique(color);
+    }
+    last = color;
+  }
+
+  pixels_ += count;
+  merged_valid_ = false;
+}
+
+auto spng::PixelStats::_add_unique(const uint64_t color) -> void {
+  constexpr uint64_t empty = ~uint64_t(0);
+  if(color == empty) {
+    has_all_ones_ = true;
+    return;
+  }
+
+  const size_t mask = colors_.size() - 1;
+  size_t slot = static_cast<size_t>((color * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+  while(colors_[slot] != empty) {
+    if(colors_[slot] == color) {
+      return;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  colors_[slot] = color;
+  if(++num_colors_ >= max_unique) {
+    colors_full_ = true;
+    colors_.clear();
+    colors_.shrink_to_fit();
+  } else if(num_colors_ * 2 > colors_.size()) {
+    _grow();
+  }
+}
+
+auto spng::PixelStats::_grow() -> void {
+  constexpr uint64_t empty = ~uint64_t(0);
+  std::vector<uint64_t> old(colors_.size() * 2, empty);
+  old.swap(colors_);
+
+  const size_t mask = colors_.size() - 1;
+  for(const uint64_t color : old) {
+    if(color == empty) {
+      continue;
+    }
+    size_t slot = static_cast<size_t>((color * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while(colors_[slot] != empty) {
+      slot = (slot + 1) & mask;
+    }
+    colors_[slot] = color;
+  }
+}
+
+auto spng::PixelStats::histogram(const size_t channel) const -> const Histogram& {
+  ASSERT(channel < 4);
+  if(!merged_valid_) {
+    for(size_t c = 0; c < 4; c++) {
+      for(size_t v = 0; v < 256; v++) {
+        merged_[c][v] = hist_[c][0][v] + hist_[c][1][v];
+      }
+    }
+    merged_valid_ = true;
+  }
+  return merged_[channel];
+}
+
+auto spng::PixelStats::bits_used() const -> uint8_t {
+  if(wide_ && !fits_8bit_) {
+    return 16;
+  }
+
+  // A depth d is enough if every value used is a multiple of
+  // 255 / (2^d - 1), i.e. it's the scaled-up form of a d-bit sample.
+  for(const uint8_t depth : { 1, 2, 4 }) {
+    const size_t step = 255 / ((1U << depth) - 1);
+    bool fits = true;
+    for(size_t c = 0; c < 4 && fits; c++) {
+      const Histogram& hist = histogram(c);
+      for(size_t v = 0; v < 256; v++) {
+        if(hist[v] != 0 && v % step != 0) {
+          fits = false;
+          break;
+        }
+      }
+    }
+    if(fits) {
+      return depth;
+    }
+  }
+
+  return 8;
+}
+
+spng::PixelStats::PixelStats(const bool wide)
+  : wide_(wide), colors_(4096, ~uint64_t(0)) {}
@@ -0,0 +1,81 @@
+#include <PngWriter.hpp>
+#include <algorithm>
+#include <Crc.hpp>
+#include <stdexcept>
+
+static auto put_u32(spng::FlatBuffer::Buffer& out, const uint32_t val) -> void {
+  out.emplace_back(static_cast<uint8_t>(val >> 24));
+  out.emplace_back(static_cast<uint8_t>(val >> 16));
+  out.emplace_back(static_cast<uint8_t>(val >> 8));
+  out.emplace_back(static_cast<uint8_t>(val));
+}
+
+spng::PngWriter::PngWriter() {
+  out_ = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+}
+
+auto spng::PngWriter::chunk(const std::string_view type, const std::span<const uint8_t> data) -> PngWriter& {
+  if(type.size() != 4) {
+    throw std::invalid_argument("Chunk types are exactly 4 bytes.");
+  } if(data.size() > 0x7FFFFFFFU) {
+    throw std::invalid_argument("Chunk data exceeds 2^31 - 1 bytes.");
+  }
+
+  put_u32(out_, static_cast<uint32_t>(data.size()));
+  const size_t type_at = out_.size();
+  out_.insert(out_.end(), type.begin(), type.end());
+  out_.insert(out_.end(), data.begin(), data.end());
+
+  // CRC covers the type and the data.
+  put_u32(out_, crc32({ out_.data() + type_at, data.size() + type.size() }));
+  return *this;
+}
+
+auto spng::PngWriter::ihdr(const uint32_t width,
+  const uint32_t height,
+  const uint8_t bit_depth,
+  const Ihdr::ColorType color,
+  const Ihdr::Interlace interlace
+) -> PngWriter& {
+  FlatBuffer::Buffer data;
+  put_u32(data, width);
+  put_u32(data, height);
+  data.emplace_back(bit_depth);
+  data.emplace_back(static_cast<uint8_t>(color));
+  data.emplace_back(0); // Deflate
+  data.emplace_back(0); // Default filtering
+  data.emplace_back(static_cast<uint8_t>(interlace));
+  return chunk("IHDR", data);
+}
+
+auto spng::PngWriter::iend() -> PngWriter& {
+  return chunk("IEND", {});
+}
+
+auto spng::zlib_store(const std::span<const uint8_t> raw) -> FlatBuffer::Buffer {
+  constexpr size_t max_block = 65535;
+  FlatBuffer::Buffer out;
+  out.reserve(raw.size() + (raw.size() / max_block + 1) * 5 + 6);
+
+  // CMF: deflate, 32K window. FLG: no dictionary,
+  // check bits chosen so that (CMF * 256 + FLG) % 31 == 0.
+  out.emplace_back(0x78);
+  out.emplace_back(0x01);
+
+  size_t pos = 0;
+  do {
+    const size_t n    = std::min(max_block, raw.size() - pos);
+    const bool final  = pos + n == raw.size();
+    const auto len    = static_cast<uint16_t>(n);
+    out.emplace_back(final ? 1 : 0);  // BFINAL, BTYPE = 00 (stored)
+    out.emplace_back(static_cast<uint8_t>(len));
+    out.emplace_back(static_cast<uint8_t>(len >> 8));
+    out.emplace_back(static_cast<uint8_t>(~len));
+    out.emplace_back(static_cast<uint8_t>(~len >> 8));
+    out.insert(out.end(), raw.begin() + pos, raw.begin() + pos + n);
+    pos += n;
+  } while(pos < raw.size());
+
+  put_u32(out, adler32(raw));
+  return out;
+}
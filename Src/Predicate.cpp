@@ -0,0 +1,280 @@
+#include <Predicate.hpp>
+#include <Fmt.hpp>
+#include <array>
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+  // Chunk type bytes as a uint32_t in host order, as
+  // they would be read straight out of a chunk header.
+  auto type_word(const void* bytes) -> int64_t {
+    uint32_t word = 0;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+  }
+}
+
+// Recursive descent, emitting code as it goes. Tracks
+// the stack depth so matches() never has to grow it.
+class spng::Predicate::Parser {
+public:
+  auto parse() -> void {
+    _expr();
+    _skip_space();
+    if(pos_ != src_.size()) {
+      _fail("unexpected input");
+    }
+  }
+
+  Parser(Predicate& out, const std::string_view src)
+    : out_(out), src_(src) {}
+private:
+  static constexpr std::array<std::pair<std::string_view, Field>, 8> fields = {{
+    { "width",      Field::Width      },
+    { "height",     Field::Height     },
+    { "depth",      Field::Depth      },
+    { "color_type", Field::ColorType  },
+    { "interlaced", Field::Interlaced },
+    { "size",       Field::Size       },
+    { "chunks",     Field::Chunks     },
+    { "crc_ok",     Field::CrcOk      },
+  }};
+
+  [[noreturn]] auto _fail(const std::string_view what) const -> void {
+    throw std::runtime_error(fmt("{} at column {} of \"{}\"", what, pos_ + 1, src_));
+  }
+
+  auto _skip_space() -> void {
+    while(pos_ < src_.size() && std::isspace(static_cast<unsigned char>(src_[pos_]))) pos_++;
+  }
+
+  // Consumes tok if it comes next.
+  auto _accept(const std::string_view tok) -> bool {
+    _skip_space();
+    if(src_.substr(pos_, tok.size()) != tok) {
+      return false;
+    }
+    pos_ += tok.size();
+    return true;
+  }
+
+  auto _word() -> std::string_view {
+    _skip_space();
+    const size_t begin = pos_;
+    while(pos_ < src_.size() && (std::isalnum(static_cast<unsigned char>(src_[pos_])) || src_[pos_] == '_')) pos_++;
+    return src_.substr(begin, pos_ - begin);
+  }
+
+  auto _emit(const Op op, const int64_t value = 0) -> size_t {
+    switch(op) {
+      case Op::Push: case Op::Field: case Op::Has: case Op::Count: case Op::Bytes:
+        depth_++;
+        break;
+      case Op::Eq: case Op::Ne: case Op::Lt: case Op::Le: case Op::Gt: case Op::Ge:
+      case Op::AndJump: case Op::OrJump:
+        depth_--;
+        break;
+      default:
+        break;
+    }
+    out_.max_stack_ = std::max(out_.max_stack_, depth_);
+    out_.code_.emplace_back(Instr{ op, value });
+    return out_.code_.size() - 1;
+  }
+
+  // Both sides of && and || are emitted the same way, the
+  // jump lands on a Truth so either path leaves a 0 or 1.
+  auto _logical(const std::string_view tok, const Op jump, auto&& operand) -> void {
+    operand();
+    while(_accept(tok)) {
+      const size_t at = _emit(jump);
+      operand();
+      out_.code_[at].value = static_cast<int64_t>(_emit(Op::Truth));
+    }
+  }
+
+  auto _expr() -> void {
+    _logical("||", Op::OrJump, [this] { _and(); });
+  }
+
+  auto _and() -> void {
+    _logical("&&", Op::AndJump, [this] { _compare(); });
+  }
+
+  auto _compare() -> void {
+    static constexpr std::array<std::pair<std::string_view, Op>, 6> ops = {{
+      { "==", Op::Eq }, { "!=", Op::Ne }, { "<=", Op::Le }, { ">=", Op::Ge }, { "<", Op::Lt }, { ">", Op::Gt },
+    }};
+
+    _unary();
+    for(const auto& [tok, op] : ops) {
+      if(_accept(tok)) {
+        _unary();
+        _emit(op);
+        return;
+      }
+    }
+  }
+
+  auto _unary() -> void {
+    // '!' but not the start of "!=".
+    _skip_space();
+    if(src_.substr(pos_, 1) == "!" && src_.substr(pos_, 2) != "!=") {
+      pos_++;
+      _unary();
+      _emit(Op::Not);
+      return;
+    }
+
+    if(_accept("(")) {
+      _expr();
+      if(!_accept(")")) _fail("expected ')'");
+      return;
+    }
+
+    if(pos_ < src_.size() && std::isdigit(static_cast<unsigned char>(src_[pos_]))) {
+      _number();
+      return;
+    }
+
+    const size_t start = pos_;
+    const auto word = _word();
+    if(word.empty()) {
+      _fail("expected a value");
+    }
+
+    for(const auto& [name, field] : fields) {
+      if(word == name) {
+        _emit(Op::Field, static_cast<int64_t>(field));
+        return;
+      }
+    }
+
+    Op func = Op::Has;
+    if(word == "count") {
+      func = Op::Count;
+    } else if(word == "bytes") {
+      func = Op::Bytes;
+    } else if(word != "has") {
+      pos_ = start;
+      _fail("unknown name");
+    }
+
+    if(!_accept("(")) _fail("expected '('");
+    const auto type = _word();
+    if(type.size() != 4 || !std::ranges::all_of(type, [](const char ch) { return std::isalpha(static_cast<unsigned char>(ch)); })) {
+      _fail("expected a four letter chunk type");
+    }
+    if(!_accept(")")) _fail("expected ')'");
+    _emit(func, type_word(type.data()));
+  }
+
+  auto _number() -> void {
+    int64_t val = 0;
+    while(pos_ < src_.size() && std::isdigit(static_cast<unsigned char>(src_[pos_]))) {
+      if(val > (INT64_MAX - 9) / 10) _fail("number too large");
+      val = val * 10 + (src_[pos_++] - '0');
+    }
+
+    // Same suffixes as --rechunk-idat.
+    int shift = 0;
+    if(pos_ < src_.size() && (src_[pos_] == 'K' || src_[pos_] == 'k')) {
+      shift = 10;
+    } else if(pos_ < src_.size() && (src_[pos_] == 'M' || src_[pos_] == 'm')) {
+      shift = 20;
+    }
+    if(shift != 0) {
+      if(val > (INT64_MAX >> shift)) _fail("number too large");
+      val <<= shift;
+      pos_++;
+    }
+    _emit(Op::Push, val);
+  }
+
+  Predicate& out_;
+  std::string_view src_;
+  size_t pos_   = 0;
+  size_t depth_ = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+spng::Predicate::Predicate(const std::string_view source)
+  : source_(source) {
+  Parser(*this, source).parse();
+}
+
+auto spng::Predicate::matches(const Carrier& carrier) const -> bool {
+  const auto& chunks = carrier.chunks();
+  const auto bytes   = carrier.bytes();
+  const auto ihdr    = carrier.metadata();
+
+  auto field = [&](const Field which) -> int64_t {
+    switch(which) {
+      case Field::Width:      return ihdr.width();
+      case Field::Height:     return ihdr.height();
+      case Field::Depth:      return ihdr.bit_depth();
+      case Field::ColorType:  return static_cast<int64_t>(ihdr.color_type());
+      case Field::Interlaced: return ihdr.interlace_method() == Ihdr::Interlace::Adam7;
+      case Field::Size:       return static_cast<int64_t>(carrier.size());
+      case Field::Chunks:     return static_cast<int64_t>(chunks.size());
+      case Field::CrcOk:
+        return std::ranges::all_of(chunks, [](const Chunk& chunk) { return chunk.crc_ok(); });
+    }
+    return 0;
+  };
+
+  // Walks the chunk list, comparing the raw type bytes.
+  auto of_type = [&](const int64_t type, const bool sum_bytes) -> int64_t {
+    int64_t total = 0;
+    for(const auto& chunk : chunks) {
+      if(type_word(bytes.data() + chunk.offset_ + offsetof(Chunk::Header, type)) == type) {
+        total += sum_bytes ? chunk.length() : 1;
+      }
+    }
+    return total;
+  };
+
+  std::vector<int64_t> stack;
+  stack.reserve(max_stack_);
+  for(size_t pc = 0; pc < code_.size(); pc++) {
+    const auto& [op, value] = code_[pc];
+    switch(op) {
+      case Op::Push:  stack.emplace_back(value); break;
+      case Op::Field: stack.emplace_back(field(static_cast<Field>(value))); break;
+      case Op::Has:   stack.emplace_back(of_type(value, false) != 0); break;
+      case Op::Count: stack.emplace_back(of_type(value, false)); break;
+      case Op::Bytes: stack.emplace_back(of_type(value, true)); break;
+      case Op::Not:   stack.back() = !stack.back(); break;
+      case Op::Truth: stack.back() = stack.back() != 0; break;
+      case Op::AndJump:
+      case Op::OrJump:
+        if((stack.back() != 0) == (op == Op::OrJump)) {
+          pc = static_cast<size_t>(value) - 1;
+        } else {
+          stack.pop_back();
+        }
+        break;
+      default: {
+        const int64_t rhs = stack.back();
+        stack.pop_back();
+        int64_t& lhs = stack.back();
+        switch(op) {
+          case Op::Eq: lhs = lhs == rhs; break;
+          case Op::Ne: lhs = lhs != rhs; break;
+          case Op::Lt: lhs = lhs <  rhs; break;
+          case Op::Le: lhs = lhs <= rhs; break;
+          case Op::Gt: lhs = lhs >  rhs; break;
+          case Op::Ge: lhs = lhs >= rhs; break;
+          default: break;
+        }
+      }
+    }
+  }
+
+  return !stack.empty() && stack.back() != 0;
+}
@@ -0,0 +1,152 @@
+#include <Profiles.hpp>
+#include <Chunks.hpp>
+#include <ConManip.hpp>
+#include <Hash.hpp>
+#include <Fmt.hpp>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <limits>
+#include <optional>
+#include <algorithm>
+#include <print>
+
+namespace {
+  struct ProfileInfo {
+    std::string name;           // Chunk name where first seen.
+    spng::Iccp::Profile header;
+    size_t size         = 0;    // Decompressed.
+    uint64_t files      = 0;
+    uint64_t stored     = 0;    // Whole iCCP chunks, across all files.
+    uint64_t min_stored = std::numeric_limits<uint64_t>::max();
+  };
+
+  // Inflating dominates; the lock is only held for lookups.
+  struct Registry {
+    std::mutex lock;
+    std::unordered_map<uint64_t, uint64_t> by_stream;     // Compressed hash -> content hash.
+    std::unordered_map<uint64_t, ProfileInfo> profiles;   // Content hash -> profile.
+    uint64_t files     = 0;
+    uint64_t with_icc  = 0;
+  };
+
+  auto registry() -> Registry& {
+    static Registry reg;
+    return reg;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Profiles::add(const Carrier& carrier) -> void {
+  auto& reg = registry();
+  bool has_icc = false;
+
+  for(const auto& chunk : carrier.chunks()) {
+    if(chunk.type() != Chunk::Type::iCCP) continue;
+    has_icc = true;
+
+    const auto iccp   = chunk.as<Iccp>();
+    const auto stream = carrier.payload(chunk).subspan(iccp.compressed_offset());
+    const auto stream_hash = xxh64(stream);
+    const uint64_t stored  = sizeof(Chunk::Header) + chunk.length() + sizeof(uint32_t);
+
+    std::optional<uint64_t> content_hash;
+    {
+      std::lock_guard guard(reg.lock);
+      if(const auto it = reg.by_stream.find(stream_hash); it != reg.by_stream.end()) {
+        content_hash = it->second;
+      }
+    }
+
+    // New compressed stream: inflate and parse outside the lock.
+    ProfileInfo fresh;
+    if(!content_hash) {
+      const auto data = iccp.profile_data();
+      fresh.header = Iccp::parse_profile(data);
+      fresh.name   = iccp.name();
+      fresh.size   = data.size();
+      content_hash = xxh64(data);
+    }
+
+    std::lock_guard guard(reg.lock);
+    reg.by_stream.emplace(stream_hash, *content_hash);
+    auto [it, inserted] = reg.profiles.try_emplace(*content_hash, std::move(fresh));
+    auto& info = it->second;
+    info.files     += 1;
+    info.stored    += stored;
+    info.min_stored = std::min(info.min_stored, stored);
+  }
+
+  std::lock_guard guard(reg.lock);
+  reg.files    += 1;
+  reg.with_icc += has_icc;
+}
+
+auto spng::Profiles::print_report() -> void {
+  auto& reg = registry();
+  std::lock_guard guard(reg.lock);
+
+  // Keeping the smallest copy of each profile,
+  // the rest is duplicate. Most wasteful first.
+  std::vector<std::pair<uint64_t, const ProfileInfo*>> rows;
+  uint64_t stored = 0, wasted = 0, mismatched = 0;
+  for(const auto& [hash, info] : reg.profiles) {
+    rows.emplace_back(hash, &info);
+    mismatched += !info.header.size_ok;
+    stored += info.stored;
+    wasted += info.stored - info.min_stored;
+  }
+  std::ranges::sort(rows, [](const auto& a, const auto& b) {
+    const auto wa = a.second->stored - a.second->min_stored;
+    const auto wb = b.second->stored - b.second->min_stored;
+    return wa != wb ? wa > wb : a.first < b.first;
+  });
+
+  std::print("-- ");
+  set_console(ConFg::Magenta);
+  set_console(ConStyle::Bold);
+  std::println("ICC Profiles:");
+  reset_console();
+
+  set_console(ConFg::White);
+  set_console(ConStyle::Bold);
+  std::println("{:<16} {:>8} {:>10} {:>12} {:>12} {:<5} {:<5} {:<4} {}",
+    "Content Hash", "Files", "Size", "Stored", "Duplicate", "Class", "Space", "Ver", "Name");
+  reset_console();
+  std::println("{:=<16} {:=>8} {:=>10} {:=>12} {:=>12} {:=<5} {:=<5} {:=<4} {:=<4}",
+    "=", "=", "=", "=", "=", "=", "=", "=", "=");
+
+  for(const auto& [hash, info] : rows) {
+    set_console(ConFg::Magenta);
+    std::print("{:016x} ", hash);
+    reset_console();
+    std::println("{:>8} {:>10} {:>12} {:>12} {:<5} {:<5} {:<4} {}",
+      info->files,
+      info->size,
+      info->stored,
+      info->stored - info->min_stored,
+      info->header.device_class,
+      info->header.color_space,
+      fmt("{}.{}", info->header.version_major, info->header.version_minor),
+      info->header.size_ok ? info->name : fmt("{} (header says {} bytes)", info->name, info->header.size));
+  }
+
+  auto display_value = [&]<typename T>(const std::string_view name, T&& val) -> void {
+    set_console(ConFg::Yellow);
+    std::print("{:<18} ", name);
+    reset_console();
+    std::println(": {}", val);
+  };
+
+  std::println("");
+  display_value("Files", reg.files);
+  display_value("With Profile", reg.with_icc);
+  display_value("Distinct Profiles", reg.profiles.size());
+  display_value("Size Mismatches", mismatched);
+  display_value("Profile Bytes", stored);
+  display_value("Duplicate Bytes", fmt("{} ({:.2f}% of profile bytes)",
+    wasted,
+    static_cast<double>(wasted) * 100.0 / static_cast<double>(std::max<uint64_t>(stored, 1))));
+  std::println("");
+}
@@ -0,0 +1,81 @@
+#include <Rewrite.hpp>
+#include <Crc.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+  // Header (length + type) and CRC of one output chunk.
+  constexpr size_t meta_size  = sizeof(spng::Chunk::Header) + sizeof(uint32_t);
+
+  // Output chunks whose header/CRC bytes are kept
+  // before the OutFile has to be flushed.
+  constexpr size_t meta_batch = 256;
+
+  auto put_u32(uint8_t* dst, const uint32_t val) -> void {
+    dst[0] = static_cast<uint8_t>(val >> 24);
+    dst[1] = static_cast<uint8_t>(val >> 16);
+    dst[2] = static_cast<uint8_t>(val >> 8);
+    dst[3] = static_cast<uint8_t>(val);
+  }
+}
+
+auto spng::Rewrite::write_idat(const std::span<const std::span<const FlatBuffer::Byte>> parts,
+  const uint32_t idat_size,
+  OutFile& out) -> size_t {
+  if(idat_size == 0 || idat_size > 0x7FFFFFFFU) {
+    throw std::invalid_argument("IDAT size must be between 1 and 2^31 - 1 bytes.");
+  }
+
+  size_t left = 0;
+  for(const auto& part : parts) {
+    left += part.size();
+  }
+
+  // Only the generated headers and CRCs are stored, the data
+  // itself is queued straight from the parts. The OutFile
+  // holds pointers into meta, so it's flushed before reuse.
+  FlatBuffer::Buffer meta(meta_batch * meta_size);
+  size_t slot    = 0;
+  size_t part    = 0;
+  size_t pos     = 0;
+  size_t written = 0;
+
+  do {
+    if(slot == meta_batch) {
+      out.flush();
+      slot = 0;
+    }
+
+    const auto len = static_cast<uint32_t>(std::min<size_t>(left, idat_size));
+    uint8_t* hdr   = meta.data() + slot * meta_size;
+    put_u32(hdr, len);
+    std::ranges::copy(std::string_view("IDAT"), hdr + 4);
+    out.write({ hdr, sizeof(Chunk::Header) });
+
+    uint32_t crc = crc32({ hdr + 4, 4 });
+    for(size_t need = len; need != 0; ) {
+      if(pos == parts[part].size()) {
+        ++part;
+        pos = 0;
+        continue;
+      }
+
+      const auto piece = parts[part].subspan(pos, std::min(need, parts[part].size() - pos));
+      out.write(piece);
+      crc   = crc32(piece, crc);
+      pos  += piece.size();
+      need -= piece.size();
+    }
+
+    put_u32(hdr + sizeof(Chunk::Header), crc);
+    out.write({ hdr + sizeof(Chunk::Header), sizeof(uint32_t) });
+
+    left -= len;
+    ++slot;
+    ++written;
+  } while(left != 0);
+
+  out.flush();
+  return written;
+}
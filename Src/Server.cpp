@@ -0,0 +1,509 @@
+#include <Server.hpp>
+#include <FileCycle.hpp>
+#include <Context.hpp>
+#include <ConManip.hpp>
+#include <Carrier.hpp>
+#include <InFileRef.hpp>
+#include <Predicate.hpp>
+#include <Trace.hpp>
+#include <Fmt.hpp>
+#include <print>
+
+#if defined(SEE_PNG_POSIX)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <ios>
+#include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+  constexpr size_t max_inflight = 64;              // Pipelined requests per connection.
+  constexpr size_t max_line     = size_t(64) << 10;
+  constexpr size_t max_raw      = size_t(256) << 20;
+
+  // RAW payloads held at once, queued or being inspected.
+  constexpr size_t conn_raw_budget   = max_raw;
+  constexpr size_t global_raw_budget = size_t(1) << 30;
+
+  struct Job {
+    std::string name;
+    spng::FlatBuffer::Shared data;  // Null for a path on disk.
+    uint64_t id = 0;
+    std::promise<std::string> result;
+  };
+
+  // Blocks producers when full, and consumers when empty.
+  class JobQueue {
+  public:
+    auto push(Job job) -> void {
+      std::unique_lock guard(lock_);
+      not_full_.wait(guard, [&] { return jobs_.size() < capacity_; });
+      jobs_.emplace_back(std::move(job));
+      not_empty_.notify_one();
+    }
+
+    // Empty once stop is requested.
+    auto pop(const std::stop_token& stop) -> std::optional<Job> {
+      std::unique_lock guard(lock_);
+      if(!not_empty_.wait(guard, stop, [&] { return !jobs_.empty(); })) {
+        return std::nullopt;
+      }
+      Job job = std::move(jobs_.front());
+      jobs_.pop_front();
+      not_full_.notify_one();
+      return job;
+    }
+
+    explicit JobQueue(const size_t capacity)
+      : capacity_(capacity) {}
+  private:
+    std::mutex lock_;
+    std::condition_variable_any not_empty_;
+    std::condition_variable_any not_full_;
+    std::deque<Job> jobs_;
+    size_t capacity_;
+  };
+
+  // Bytes that may be held at once. take() blocks until
+  // enough has been given back, and never fails for a
+  // size up to the limit.
+  class ByteBudget {
+  public:
+    auto take(const size_t bytes) -> void {
+      std::unique_lock guard(lock_);
+      freed_.wait(guard, [&] { return limit_ - used_ >= bytes; });
+      used_ += bytes;
+    }
+
+    auto give_back(const size_t bytes) -> void {
+      {
+        std::lock_guard guard(lock_);
+        used_ -= bytes;
+      }
+      freed_.notify_all();
+    }
+
+    explicit ByteBudget(const size_t limit)
+      : limit_(limit) {}
+  private:
+    std::mutex lock_;
+    std::condition_variable freed_;
+    size_t used_ = 0;
+    size_t limit_;
+  };
+
+  // Same checks a default run makes: the signature and chunk
+  // structure, CRCs with --verify-crc, and the --where filter.
+  auto inspect(const Job& job) -> std::string {
+    using namespace spng;
+    static const std::optional<Predicate> where = Context::get().where_.empty()
+      ? std::nullopt
+      : std::optional<Predicate>(std::in_place, Context::get().where_);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed_us = [&] {
+      return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    auto failure = [&](const std::string_view kind, const char* what) {
+      return spng::fmt(R"({{"id":{},"file":"{}","ok":false,"error":"{}","message":"{}","us":{}}})",
+        job.id, Trace::json_escape(job.name), kind, Trace::json_escape(what), elapsed_us());
+    };
+
+    try {
+      FlatBuffer::Shared data = job.data;
+      if(!data) {
+        const InFileRef ref(job.name);
+        data = ref.read(ref.size());
+      }
+
+      const Carrier carrier(std::move(data));
+      const bool matched = !where || where->matches(carrier);
+      if(matched && Context::get().flags_ & Context::CrcCheck) {
+        verify_crcs(carrier);
+      }
+
+      // Distinct ancillary chunk types, in file order.
+      std::vector<std::string> ancillary;
+      for(const auto& chunk : carrier.chunks()) {
+        auto type = chunk.type_string();
+        if(type.size() == 4 && type.front() & 0x20 && std::ranges::find(ancillary, type) == ancillary.end()) {
+          ancillary.emplace_back(std::move(type));
+        }
+      }
+
+      std::string types;
+      for(const auto& type : ancillary) {
+        types += spng::fmt(R"({}"{}")", types.empty() ? "" : ",", Trace::json_escape(type));
+      }
+
+      const auto ihdr = carrier.metadata();
+      std::string out = spng::fmt(R"({{"id":{},"file":"{}","ok":true,"width":{},"height":{},"depth":{},"color_type":{},)",
+        job.id, Trace::json_escape(job.name), ihdr.width(), ihdr.height(), ihdr.bit_depth(),
+        static_cast<uint32_t>(ihdr.color_type()));
+      out += spng::fmt(R"("interlaced":{},"size":{},"chunks":{},"ancillary":[{}],)",
+        ihdr.interlace_method() == Ihdr::Interlace::Adam7, carrier.size(), carrier.chunks().size(), types);
+      if(where) {
+        out += spng::fmt(R"("matched":{},)", matched);
+      }
+      out += spng::fmt(R"("us":{}}})", elapsed_us());
+      return out;
+    }
+    catch(const std::ios_base::failure& e) {
+      return failure("io", e.what());
+    }
+    catch(const std::runtime_error& e) {
+      return failure("corruption", e.what());
+    }
+    catch(const std::exception& e) {
+      return failure("internal", e.what());
+    }
+  }
+
+  // One client. serve() reads and queues requests on the calling
+  // thread, while a second thread writes the results back in order.
+  class Connection {
+  public:
+    auto serve() -> void {
+      std::jthread writer([this] { _write_loop(); });
+      _read_loop();
+      {
+        std::lock_guard guard(lock_);
+        eof_ = true;
+      }
+      changed_.notify_all();
+      writer.join();
+
+      // The client sees EOF now, not when the fd is closed.
+      ::shutdown(fd_, SHUT_RDWR);
+      done_.store(true);
+    }
+
+    // Unblocks serve(), the connection is dropped.
+    auto abort() const -> void {
+      ::shutdown(fd_, SHUT_RDWR);
+    }
+
+    [[nodiscard]] auto done() const -> bool {
+      return done_.load();
+    }
+
+    Connection(const int fd, JobQueue& jobs, ByteBudget& global_raw)
+      : fd_(fd), jobs_(jobs), global_raw_(global_raw) {}
+
+    ~Connection() {
+      ::close(fd_);
+    }
+  private:
+    auto _read_loop() -> void {
+      std::string line;
+      while(_read_line(line)) {
+        if(line.empty()) continue;
+
+        Job job;
+        job.id = ++next_id_;
+        if(line.starts_with("RAW ")) {
+          size_t size = 0;
+          const auto [end, ec] = std::from_chars(line.data() + 4, line.data() + line.size(), size);
+          if(ec != std::errc() || end != line.data() + line.size() || size > max_raw) {
+            // The stream can't be resynchronized after this.
+            _reply(job.id, "Bad RAW request, expected \"RAW <size>\" of at most 256 MiB.");
+            return;
+          }
+          job.name = "<raw>";
+          job.data = _take_raw(size);
+          if(!_read_exact(job.data->data(), size)) return;
+        } else {
+          job.name = std::move(line);
+        }
+
+        {
+          std::unique_lock guard(lock_);
+          changed_.wait(guard, [&] { return inflight_.size() < max_inflight; });
+          inflight_.emplace_back(job.result.get_future());
+        }
+        changed_.notify_all();
+        jobs_.push(std::move(job));
+      }
+    }
+
+    auto _write_loop() -> void {
+      bool broken = false;
+      for(;;) {
+        std::future<std::string>* next = nullptr;
+        {
+          std::unique_lock guard(lock_);
+          changed_.wait(guard, [&] { return !inflight_.empty() || eof_; });
+          if(inflight_.empty()) return;
+          next = &inflight_.front();
+        }
+
+        // A deque's elements stay put while others are added.
+        std::string out = next->get();
+        {
+          std::lock_guard guard(lock_);
+          inflight_.pop_front();
+        }
+        changed_.notify_all();
+
+        // After a failed write the client is gone, but
+        // the remaining results are still waited for.
+        out += '\n';
+        broken = broken || !_send(out);
+      }
+    }
+
+    // Waits until both this connection and the whole server
+    // can hold size more bytes, so nothing more is read until
+    // earlier payloads have been inspected. The buffer gives
+    // its bytes back when the last reference to it is gone,
+    // which may be after this connection has closed.
+    auto _take_raw(const size_t size) -> spng::FlatBuffer::Shared {
+      own_raw_->take(size);
+      global_raw_.take(size);
+      return spng::FlatBuffer::Shared(new spng::FlatBuffer::Buffer(size),
+        [own = own_raw_, &global = global_raw_, size](const spng::FlatBuffer::Buffer* buff) {
+          delete buff;
+          global.give_back(size);
+          own->give_back(size);
+        });
+    }
+
+    // A request that fails before reaching a worker.
+    auto _reply(const uint64_t id, const std::string_view message) -> void {
+      std::promise<std::string> result;
+      result.set_value(spng::fmt(R"({{"id":{},"ok":false,"error":"request","message":"{}"}})",
+        id, spng::Trace::json_escape(message)));
+      {
+        std::unique_lock guard(lock_);
+        changed_.wait(guard, [&] { return inflight_.size() < max_inflight; });
+        inflight_.emplace_back(result.get_future());
+      }
+      changed_.notify_all();
+    }
+
+    auto _fill() -> bool {
+      if(begin_ > 0) {
+        std::memmove(buff_.data(), buff_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+      }
+
+      for(;;) {
+        const ssize_t got = ::read(fd_, buff_.data() + end_, buff_.size() - end_);
+        if(got > 0) {
+          end_ += static_cast<size_t>(got);
+          return true;
+        } if(got < 0 && errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+    }
+
+    auto _read_line(std::string& line) -> bool {
+      for(;;) {
+        const auto* first = buff_.data() + begin_;
+        const auto* newline = static_cast<const char*>(std::memchr(first, '\n', end_ - begin_));
+        if(newline != nullptr) {
+          line.assign(first, newline);
+          if(!line.empty() && line.back() == '\r') line.pop_back();
+          begin_ += static_cast<size_t>(newline - first) + 1;
+          return true;
+        } if(end_ - begin_ >= max_line || !_fill()) {
+          return false;
+        }
+      }
+    }
+
+    auto _read_exact(uint8_t* out, size_t size) -> bool {
+      // Whatever is already buffered first.
+      const size_t buffered = std::min(size, end_ - begin_);
+      std::memcpy(out, buff_.data() + begin_, buffered);
+      begin_ += buffered;
+      out    += buffered;
+      size   -= buffered;
+
+      while(size > 0) {
+        const ssize_t got = ::read(fd_, out, size);
+        if(got < 0 && errno == EINTR) {
+          continue;
+        } if(got <= 0) {
+          return false;
+        }
+        out  += got;
+        size -= static_cast<size_t>(got);
+      }
+      return true;
+    }
+
+    auto _send(const std::string_view data) const -> bool {
+      size_t sent = 0;
+      while(sent < data.size()) {
+        const ssize_t put = ::write(fd_, data.data() + sent, data.size() - sent);
+        if(put < 0 && errno == EINTR) {
+          continue;
+        } if(put <= 0) {
+          return false;
+        }
+        sent += static_cast<size_t>(put);
+      }
+      return true;
+    }
+
+    int fd_;
+    JobQueue& jobs_;
+    ByteBudget& global_raw_;
+    std::shared_ptr<ByteBudget> own_raw_ = std::make_shared<ByteBudget>(conn_raw_budget);
+    uint64_t next_id_ = 0;
+    std::array<char, max_line> buff_{};
+    size_t begin_ = 0;
+    size_t end_   = 0;
+
+    std::mutex lock_;
+    std::condition_variable changed_;
+    std::deque<std::future<std::string>> inflight_;
+    bool eof_ = false;
+    std::atomic<bool> done_ = false;
+  };
+
+  struct Client {
+    std::unique_ptr<Connection> conn;
+    std::jthread thread;
+  };
+
+  // Removed on exit, including after Ctrl+C.
+  std::string bound_path;
+  auto unlink_socket() -> void {
+    ::unlink(bound_path.c_str());
+  }
+
+  auto socket_error(const std::string& path, const std::string_view what) -> bool {
+    spng::set_console(spng::ConFg::Red);
+    spng::set_console(spng::ConStyle::Bold);
+    std::print("SOCKET :: ");
+    spng::reset_console();
+    std::println("For {} :: {}: {}", path, what, std::strerror(errno));
+    return false;
+  }
+}
+
+auto spng::Server::run(const std::string& socket_path) -> bool {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  if(socket_path.size() >= sizeof(addr.sun_path)) {
+    errno = ENAMETOOLONG;
+    return socket_error(socket_path, "bind");
+  }
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+  // A socket left behind by an earlier run would make bind() fail.
+  // It's only removed if nothing answers on it: one that another
+  // server is still listening on isn't ours to take over.
+  std::error_code ec;
+  if(std::filesystem::is_socket(socket_path, ec)) {
+    const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    const bool live = probe >= 0 && ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    if(probe >= 0) ::close(probe);
+    if(live) {
+      errno = EADDRINUSE;
+      return socket_error(socket_path, "another server is listening");
+    }
+    std::filesystem::remove(socket_path, ec);
+  }
+
+  const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listener < 0) {
+    return socket_error(socket_path, "socket");
+  } if(::bind(listener, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(listener);
+    return socket_error(socket_path, "bind");
+  }
+  bound_path = socket_path;
+  std::atexit(unlink_socket);
+  if(::listen(listener, SOMAXCONN) != 0) {
+    ::close(listener);
+    return socket_error(socket_path, "listen");
+  }
+
+  // Clients that hang up mid-reply shouldn't kill the server.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  size_t workers = Context::get().jobs_;
+  if(workers == 0) {
+    workers = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  // Declared first: queued jobs give their bytes back to it.
+  ByteBudget raw_budget(global_raw_budget);
+  JobQueue jobs(workers * 4);
+  std::vector<std::jthread> pool;
+  pool.reserve(workers);
+  for(size_t i = 0; i < workers; i++) {
+    pool.emplace_back([&jobs](const std::stop_token& stop) {
+      while(auto job = jobs.pop(stop)) {
+        job->result.set_value(inspect(*job));
+      }
+    });
+  }
+
+  if(!(Context::get().flags_ & Context::Silent)) {
+    std::println("Listening on {} ({} workers).", socket_path, workers);
+    std::fflush(stdout);
+  }
+
+  std::list<Client> clients;
+  for(;;) {
+    const int fd = ::accept(listener, nullptr, nullptr);
+    if(fd < 0) {
+      if(errno == EINTR || errno == ECONNABORTED) continue;
+      break;
+    }
+
+    // Finished clients are cleaned up as new ones arrive.
+    clients.remove_if([](const Client& client) { return client.conn->done(); });
+    auto& client = clients.emplace_back(Client{ std::make_unique<Connection>(fd, jobs, raw_budget), {} });
+    client.thread = std::jthread([conn = client.conn.get()] { conn->serve(); });
+  }
+
+  socket_error(socket_path, "accept");
+  for(auto& client : clients) {
+    client.conn->abort();
+  }
+  clients.clear();
+  ::close(listener);
+  return false;
+}
+
+#else
+
+auto spng::Server::run(const std::string& socket_path) -> bool {
+  set_console(ConFg::Red);
+  std::print("UNSUPPORTED ");
+  reset_console();
+  std::println(":: --serve {} needs Unix domain sockets, which this platform doesn't have.", socket_path);
+  return false;
+}
+
+#endif
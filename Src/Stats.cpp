@@ -0,0 +1,235 @@
+#include <Stats.hpp>
+#include <ConManip.hpp>
+#include <Fmt.hpp>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <print>
+
+namespace {
+  using namespace spng::Stats;
+
+  struct alignas(64) ThreadStats {
+    std::array<uint64_t, size_t(Phase::Count)> phase_ns{};
+    std::array<uint64_t, size_t(Phase::Count)> phase_calls{};
+    std::array<uint64_t, size_t(Counter::Count)> counters{};
+    std::array<uint64_t, size_t(Error::Count)> errors{};
+    std::array<spng::Perf::Sample, size_t(Phase::Count)> perf{};
+    std::array<uint64_t, size_t(Phase::Count)> perf_calls{};
+    std::vector<uint64_t> file_ns;
+  };
+
+  // Every thread's block, kept alive here
+  // even after the thread itself has exited.
+  struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadStats>> threads;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  auto registry() -> Registry& {
+    static Registry reg;
+    return reg;
+  }
+
+  auto local() -> ThreadStats& {
+    thread_local ThreadStats* tls = nullptr;
+    if(tls == nullptr) {
+      auto& reg = registry();
+      std::lock_guard guard(reg.lock);
+      tls = reg.threads.emplace_back(std::make_unique<ThreadStats>()).get();
+    }
+    return *tls;
+  }
+
+  constexpr std::array phase_names = {
+    "read", "parse", "verify", "print", "hexdump", "extract", "export", "rewrite", "decode", "hash", "search", "filter"
+  };
+
+  constexpr std::array counter_names = {
+    "files", "bytes read", "chunks parsed", "bytes hexdumped", "bytes extracted", "bytes saved", "bytes decoded", "files skipped"
+  };
+
+  constexpr std::array error_names = {
+    "file i/o", "corruption", "internal"
+  };
+
+  static_assert(phase_names.size() == size_t(Phase::Count));
+  static_assert(counter_names.size() == size_t(Counter::Count));
+  static_assert(error_names.size() == size_t(Error::Count));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Stats::enable() -> void {
+  registry().start = std::chrono::steady_clock::now();
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+auto spng::Stats::add(const Counter counter, const uint64_t amnt) -> void {
+  if(!enabled()) return;
+  local().counters[size_t(counter)] += amnt;
+}
+
+auto spng::Stats::add_error(const Error kind) -> void {
+  if(!enabled()) return;
+  local().errors[size_t(kind)] += 1;
+}
+
+auto spng::Stats::add_phase_time(const Phase phase, const uint64_t ns) -> void {
+  if(!enabled()) return;
+  auto& tls = local();
+  tls.phase_ns[size_t(phase)] += ns;
+  tls.phase_calls[size_t(phase)] += 1;
+}
+
+auto spng::Stats::add_phase_counters(const Phase phase,
+  const Perf::Sample& begin,
+  const Perf::Sample& end
+) -> void {
+  if(!enabled()) return;
+  auto& tls = local();
+  for(size_t i = 0; i < begin.size(); i++) {
+    // Scaled values can jitter backwards slightly.
+    tls.perf[size_t(phase)][i] += end[i] > begin[i] ? end[i] - begin[i] : 0;
+  }
+  tls.perf_calls[size_t(phase)] += 1;
+}
+
+auto spng::Stats::add_file_time(const uint64_t ns) -> void {
+  if(!enabled()) return;
+  local().file_ns.emplace_back(ns);
+}
+
+auto spng::Stats::phase_name(const Phase phase) -> const char* {
+  return phase_names.at(size_t(phase));
+}
+
+auto spng::Stats::print_report() -> void {
+  if(!enabled()) return;
+
+  auto& reg = registry();
+  std::lock_guard guard(reg.lock);
+  const auto wall = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - reg.start).count();
+
+  ThreadStats total;
+  for(const auto& ts : reg.threads) {
+    for(size_t i = 0; i < total.phase_ns.size(); i++) {
+      total.phase_ns[i]    += ts->phase_ns[i];
+      total.phase_calls[i] += ts->phase_calls[i];
+    }
+    for(size_t i = 0; i < total.perf.size(); i++) {
+      for(size_t j = 0; j < total.perf[i].size(); j++) total.perf[i][j] += ts->perf[i][j];
+      total.perf_calls[i] += ts->perf_calls[i];
+    }
+    for(size_t i = 0; i < total.counters.size(); i++) total.counters[i] += ts->counters[i];
+    for(size_t i = 0; i < total.errors.size(); i++)   total.errors[i]   += ts->errors[i];
+    total.file_ns.insert(total.file_ns.end(), ts->file_ns.begin(), ts->file_ns.end());
+  }
+
+  auto header = [](const char* title) -> void {
+    std::print("-- ");
+    set_console(ConFg::Magenta);
+    set_console(ConStyle::Bold);
+    std::println("{}", title);
+    reset_console();
+  };
+
+  auto display_value = [&]<typename T>(const std::string_view name, T&& val) -> void {
+    set_console(ConFg::Yellow);
+    std::print("{:<16} ", name);
+    reset_console();
+    std::println(": {}", val);
+  };
+
+  header("Run Statistics:");
+  display_value("wall time (ms)", fmt("{:.3f}", wall));
+  display_value("threads", reg.threads.size());
+  for(size_t i = 0; i < counter_names.size(); i++) {
+    display_value(counter_names[i], total.counters[i]);
+  }
+
+  std::println("");
+  header("Phase Timings:");
+  set_console(ConFg::White);
+  set_console(ConStyle::Bold);
+  std::println("{:<8} {:>12} {:>10} {:>12} {:>7}", "Phase", "Total (ms)", "Calls", "Avg (us)", "Share");
+  reset_console();
+  std::println("{:=<8} {:=>12} {:=>10} {:=>12} {:=>7}", "=", "=", "=", "=", "=");
+
+  uint64_t phase_sum = 0;
+  for(const auto ns : total.phase_ns) phase_sum += ns;
+  for(size_t i = 0; i < phase_names.size(); i++) {
+    const auto ns    = static_cast<double>(total.phase_ns[i]);
+    const auto calls = total.phase_calls[i];
+    std::println("{:<8} {:>12.3f} {:>10} {:>12.3f} {:>6.1f}%",
+      phase_names[i],
+      ns / 1e6,
+      calls,
+      calls ? ns / 1e3 / static_cast<double>(calls) : 0.0,
+      phase_sum ? ns * 100.0 / static_cast<double>(phase_sum) : 0.0);
+  }
+
+  if(Perf::enabled()) {
+    using Perf::Event;
+    const auto files = static_cast<double>(std::max<uint64_t>(1, total.counters[size_t(Counter::Files)]));
+    const auto bytes = static_cast<double>(std::max<uint64_t>(1, total.counters[size_t(Counter::BytesRead)]));
+
+    std::println("");
+    header("Hardware Counters:");
+    set_console(ConFg::White);
+    set_console(ConStyle::Bold);
+    std::println("{:<8} {:<14} {:>16} {:>14} {:>12}", "Phase", "Event", "Total", "Per File", "Per Byte");
+    reset_console();
+    std::println("{:=<8} {:=<14} {:=>16} {:=>14} {:=>12}", "=", "=", "=", "=", "=");
+
+    for(const auto phase : { Phase::Parse, Phase::Verify }) {
+      if(total.perf_calls[size_t(phase)] == 0) continue;
+      const auto& vals = total.perf[size_t(phase)];
+      for(size_t i = 0; i < vals.size(); i++) {
+        const auto ev = static_cast<Event>(i);
+        if(!Perf::supported(ev)) {
+          std::println("{:<8} {:<14} {:>16}", phase_name(phase), Perf::event_name(ev), "n/a");
+          continue;
+        }
+        const auto val = static_cast<double>(vals[i]);
+        std::println("{:<8} {:<14} {:>16} {:>14.1f} {:>12.4f}",
+          phase_name(phase), Perf::event_name(ev), vals[i], val / files, val / bytes);
+      }
+
+      const auto cycles = vals[size_t(Event::Cycles)];
+      if(cycles && Perf::supported(Event::Instructions)) {
+        std::println("{:<8} {:<14} {:>16.3f}", phase_name(phase), "IPC",
+          static_cast<double>(vals[size_t(Event::Instructions)]) / static_cast<double>(cycles));
+      }
+    }
+  }
+
+  std::println("");
+  header("Errors:");
+  for(size_t i = 0; i < error_names.size(); i++) {
+    display_value(error_names[i], total.errors[i]);
+  }
+
+  // Percentiles of per-file latency.
+  auto& lat = total.file_ns;
+  if(!lat.empty()) {
+    std::ranges::sort(lat);
+    auto pct = [&](const double p) -> double {
+      const auto idx = static_cast<size_t>(p / 100.0 * static_cast<double>(lat.size() - 1) + 0.5);
+      return static_cast<double>(lat.at(idx)) / 1e3;
+    };
+
+    std::println("");
+    header("Per-File Latency (us):");
+    display_value("p50", fmt("{:.3f}", pct(50)));
+    display_value("p90", fmt("{:.3f}", pct(90)));
+    display_value("p99", fmt("{:.3f}", pct(99)));
+    display_value("max", fmt("{:.3f}", static_cast<double>(lat.back()) / 1e3));
+  }
+
+  std::println("");
+}
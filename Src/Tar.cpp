@@ -0,0 +1,179 @@
+#include <Tar.hpp>
+#include <Fmt.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+
+namespace {
+  constexpr size_t block_size = 512;
+
+  // Offsets of the header fields we read.
+  constexpr size_t name_off     = 0,   name_len     = 100;
+  constexpr size_t size_off     = 124, size_len     = 12;
+  constexpr size_t checksum_off = 148, checksum_len = 8;
+  constexpr size_t type_off     = 156;
+  constexpr size_t magic_off    = 257;
+  constexpr size_t prefix_off   = 345, prefix_len   = 155;
+
+  auto round_up(const uint64_t val) -> uint64_t {
+    return (val + block_size - 1) / block_size * block_size;
+  }
+
+  // A NUL terminated (or field-filling) string.
+  auto field(const std::span<const uint8_t> header, const size_t off, const size_t len) -> std::string_view {
+    const auto* str = reinterpret_cast<const char*>(header.data() + off);
+    return { str, static_cast<size_t>(std::find(str, str + len, '\0') - str) };
+  }
+
+  // Octal, padded with spaces or NULs. Sizes of 8 GiB
+  // and up are base-256 instead, flagged by the high bit.
+  auto number(const std::span<const uint8_t> header, const size_t off, const size_t len) -> uint64_t {
+    if(header[off] & 0x80) {
+      uint64_t val = header[off] & 0x7F;
+      for(size_t i = 1; i < len; i++) {
+        if(val >> 56) throw std::runtime_error("Tar size field overflows");
+        val = val << 8 | header[off + i];
+      }
+      return val;
+    }
+
+    uint64_t val = 0;
+    for(size_t i = 0; i < len; i++) {
+      const uint8_t ch = header[off + i];
+      if(ch == ' ' && val == 0) {
+        continue;
+      } if(ch < '0' || ch > '7') {
+        break;
+      }
+      val = val << 3 | (ch - '0');
+    }
+    return val;
+  }
+
+  // Sum of every header byte, with the checksum field counted as spaces.
+  auto checksum(const std::span<const uint8_t> header) -> uint64_t {
+    uint64_t sum = 0;
+    for(size_t i = 0; i < block_size; i++) {
+      sum += (i >= checksum_off && i < checksum_off + checksum_len) ? ' ' : header[i];
+    }
+    return sum;
+  }
+
+  auto is_zero_block(const std::span<const uint8_t> header) -> bool {
+    return std::ranges::all_of(header, [](const uint8_t b) { return b == 0; });
+  }
+
+  // Pax records are "<length> <key>=<value>\n", the length
+  // counting the whole record.
+  struct PaxOverrides {
+    std::optional<std::string> path;
+    std::optional<uint64_t>    size;
+  };
+
+  auto parse_pax(const std::string_view data, PaxOverrides& out) -> void {
+    size_t pos = 0;
+    while(pos < data.size()) {
+      size_t len = 0;
+      const auto [end, ec] = std::from_chars(data.data() + pos, data.data() + data.size(), len);
+      if(ec != std::errc() || end == data.data() + data.size() || *end != ' ' || len == 0 || len > data.size() - pos) {
+        throw std::runtime_error(spng::fmt("Malformed pax record at offset {}", pos));
+      }
+
+      const auto record = data.substr(pos, len);
+      const size_t key_start = static_cast<size_t>(end - data.data()) - pos + 1;
+      const size_t eq = record.find('=', key_start);
+      if(eq == std::string_view::npos || record.back() != '\n') {
+        throw std::runtime_error(spng::fmt("Malformed pax record at offset {}", pos));
+      }
+
+      const auto key   = record.substr(key_start, eq - key_start);
+      const auto value = record.substr(eq + 1, record.size() - eq - 2);
+      if(key == "path") {
+        out.path = std::string(value);
+      } else if(key == "size") {
+        uint64_t size = 0;
+        if(std::from_chars(value.data(), value.data() + value.size(), size).ec == std::errc()) {
+          out.size = size;
+        }
+      }
+      pos += len;
+    }
+  }
+}
+
+auto spng::Tar::members(const std::span<const uint8_t> archive) -> std::vector<Member> {
+  std::vector<Member> res;
+  PaxOverrides pax;
+  std::optional<std::string> long_name;
+
+  size_t pos = 0;
+  while(archive.size() - pos >= block_size) {
+    const auto header = archive.subspan(pos, block_size);
+    if(is_zero_block(header)) {
+      break;
+    }
+
+    const uint64_t stored = number(header, checksum_off, checksum_len);
+    if(stored != checksum(header)) {
+      throw std::runtime_error(fmt("Bad tar header checksum at offset 0x{:X}", pos));
+    }
+
+    const char type = static_cast<char>(header[type_off]);
+    const uint64_t size = (type == '0' || type == '\0' || type == '7') && pax.size
+      ? *pax.size
+      : number(header, size_off, size_len);
+
+    const size_t data_off = pos + block_size;
+    if(size > archive.size() - data_off) {
+      throw std::runtime_error(fmt("Tar member at offset 0x{:X} runs past the end of the archive", pos));
+    }
+    const auto data = std::string_view(reinterpret_cast<const char*>(archive.data() + data_off), size);
+
+    switch(type) {
+      case 'x':
+        parse_pax(data, pax);
+        break;
+      case 'L':
+        long_name = std::string(data.substr(0, data.find('\0')));
+        break;
+      case 'K': case 'g':
+        // Long link names and global pax headers.
+        break;
+      case '0': case '\0': case '7': {
+        Member member;
+        if(pax.path) {
+          member.name = *pax.path;
+        } else if(long_name) {
+          member.name = *long_name;
+        } else {
+          // Only POSIX ustar has a name prefix, old GNU
+          // archives keep other fields in the same place.
+          const auto prefix = field(header, prefix_off, prefix_len);
+          const auto name   = field(header, name_off, name_len);
+          const bool ustar  = field(header, magic_off, 6) == "ustar";
+          member.name = ustar && !prefix.empty() ? fmt("{}/{}", prefix, name) : std::string(name);
+        }
+        member.offset = data_off;
+        member.size   = size;
+        res.emplace_back(std::move(member));
+        [[fallthrough]];
+      }
+      default:
+        // Directories, links, devices... carry nothing
+        // for us, but do use up the one-shot overrides.
+        pax = {};
+        long_name.reset();
+        break;
+    }
+
+    const uint64_t next = data_off + round_up(size);
+    if(next > archive.size()) {
+      break;
+    }
+    pos = next;
+  }
+
+  return res;
+}
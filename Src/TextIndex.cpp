@@ -0,0 +1,480 @@
+#include <TextIndex.hpp>
+#include <TextSearch.hpp>
+#include <Inflate.hpp>
+#include <OutFile.hpp>
+#include <Fmt.hpp>
+#include <filesystem>
+#include <unordered_map>
+#include <map>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+
+static auto align8(const uint64_t val) -> uint64_t {
+  return (val + 7) & ~uint64_t(7);
+}
+
+// Appends every trigram of a string, call sort_unique() after.
+static auto append_trigrams(const std::string_view str, std::vector<uint32_t>& out) -> void {
+  for(size_t i = 0; i + 3 <= str.size(); i++) {
+    out.emplace_back(uint32_t(uint8_t(str[i])) << 16
+      | uint32_t(uint8_t(str[i + 1])) << 8
+      | uint32_t(uint8_t(str[i + 2])));
+  }
+}
+
+static auto sort_unique(std::vector<uint32_t>& list) -> void {
+  std::ranges::sort(list);
+  list.erase(std::ranges::unique(list).begin(), list.end());
+}
+
+// Both inputs sorted, result sorted.
+static auto intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) -> std::vector<uint32_t> {
+  std::vector<uint32_t> out;
+  std::ranges::set_intersection(a, b, std::back_inserter(out));
+  return out;
+}
+
+static auto unite(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) -> std::vector<uint32_t> {
+  std::vector<uint32_t> out;
+  std::ranges::set_union(a, b, std::back_inserter(out));
+  return out;
+}
+
+auto spng::TextIndex::mtime_of(const std::string& path) -> int64_t {
+  std::error_code ec;
+  const auto time = std::filesystem::last_write_time(path, ec);
+  return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::TextIndex::Writer::add(const std::string& path, const Carrier& carrier) -> void {
+  constexpr size_t max_text = size_t(16) << 20;
+
+  // Gather (and inflate) everything first, so
+  // the lock is only held for the append.
+  PendingFile file;
+  file.path      = path;
+  file.file_size = carrier.size();
+  file.mtime     = mtime_of(path);
+
+  for(const auto& chunk : carrier.chunks()) {
+    const auto found = split_text(chunk.type(), carrier.payload(chunk));
+    if(!found) continue;
+
+    PendingText text;
+    text.keyword.assign(reinterpret_cast<const char*>(found->keyword.data()), found->keyword.size());
+    if(found->compressed) {
+      const auto inflated = inflate_zlib(found->value, max_text);
+      text.value.assign(reinterpret_cast<const char*>(inflated.data()), inflated.size());
+    } else {
+      text.value.assign(reinterpret_cast<const char*>(found->value.data()), found->value.size());
+    }
+    file.texts.emplace_back(std::move(text));
+  }
+
+  std::lock_guard guard(lock_);
+  files_.emplace_back(std::move(file));
+}
+
+auto spng::TextIndex::Writer::carry(const Reader& old, const uint32_t id) -> void {
+  const File rec = old.file(id);
+  PendingFile file;
+  file.path      = std::string(rec.path);
+  file.file_size = rec.file_size;
+  file.mtime     = rec.mtime;
+
+  for(uint64_t i = rec.first_text; i < rec.first_text + rec.text_count; i++) {
+    const Text text = old.text(i);
+    file.texts.emplace_back(PendingText{ std::string(text.keyword), std::string(text.value) });
+  }
+
+  std::lock_guard guard(lock_);
+  files_.emplace_back(std::move(file));
+}
+
+auto spng::TextIndex::Writer::clear() -> void {
+  std::lock_guard guard(lock_);
+  files_.clear();
+}
+
+auto spng::TextIndex::Writer::write(const std::string& out_path) const -> void {
+  std::lock_guard guard(lock_);
+
+  // Files are added from several threads, sort
+  // them so the output doesn't depend on timing.
+  std::vector<const PendingFile*> files;
+  for(const auto& file : files_) files.emplace_back(&file);
+  std::ranges::sort(files, [](const PendingFile* a, const PendingFile* b) { return a->path < b->path; });
+
+  std::string strings;
+  std::vector<FileRecord> file_recs;
+  std::vector<TextRecord> text_recs;
+  std::map<std::string_view, std::vector<uint32_t>> keys;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> grams;
+  std::vector<uint32_t> file_grams;
+
+  for(uint32_t id = 0; id < files.size(); id++) {
+    const auto& file = *files[id];
+    FileRecord rec = {};
+    rec.path_offset = strings.size();
+    rec.path_length = static_cast<uint32_t>(file.path.size());
+    rec.text_count  = static_cast<uint32_t>(file.texts.size());
+    rec.first_text  = text_recs.size();
+    rec.file_size   = file.file_size;
+    rec.mtime       = file.mtime;
+    strings.append(file.path);
+    file_recs.emplace_back(rec);
+
+    file_grams.clear();
+    for(const auto& text : file.texts) {
+      TextRecord trec = {};
+      trec.file           = id;
+      trec.keyword_length = static_cast<uint32_t>(text.keyword.size());
+      trec.keyword_offset = strings.size();
+      strings.append(text.keyword);
+      trec.value_offset   = strings.size();
+      trec.value_length   = text.value.size();
+      strings.append(text.value);
+      text_recs.emplace_back(trec);
+
+      auto& key_list = keys[text.keyword];
+      if(key_list.empty() || key_list.back() != id) key_list.emplace_back(id);
+      append_trigrams(text.value, file_grams);
+    }
+
+    sort_unique(file_grams);
+    for(const uint32_t gram : file_grams) {
+      grams[gram].emplace_back(id);
+    }
+  }
+
+  std::vector<uint32_t> gram_order;
+  gram_order.reserve(grams.size());
+  for(const auto& [gram, _] : grams) gram_order.emplace_back(gram);
+  std::ranges::sort(gram_order);
+
+  // Keyword strings are written after the values, postings in key then gram order.
+  std::vector<KeyRecord> key_recs;
+  std::vector<GramRecord> gram_recs;
+  std::vector<uint32_t> postings;
+  for(const auto& [keyword, list] : keys) {
+    KeyRecord rec = {};
+    rec.string_offset = strings.size();
+    rec.string_length = static_cast<uint32_t>(keyword.size());
+    rec.posting_count = static_cast<uint32_t>(list.size());
+    rec.first_posting = postings.size();
+    strings.append(keyword);
+    postings.insert(postings.end(), list.begin(), list.end());
+    key_recs.emplace_back(rec);
+  }
+  for(const uint32_t gram : gram_order) {
+    const auto& list = grams.at(gram);
+    GramRecord rec = {};
+    rec.gram          = gram;
+    rec.posting_count = static_cast<uint32_t>(list.size());
+    rec.first_posting = postings.size();
+    postings.insert(postings.end(), list.begin(), list.end());
+    gram_recs.emplace_back(rec);
+  }
+
+  Header hdr = {};
+  std::memcpy(hdr.magic, magic, sizeof(magic));
+  hdr.version         = version;
+  hdr.num_files       = file_recs.size();
+  hdr.num_texts       = text_recs.size();
+  hdr.num_keys        = key_recs.size();
+  hdr.num_grams       = gram_recs.size();
+  hdr.num_postings    = postings.size();
+  hdr.files_offset    = align8(sizeof(Header));
+  hdr.texts_offset    = align8(hdr.files_offset + file_recs.size() * sizeof(FileRecord));
+  hdr.keys_offset     = align8(hdr.texts_offset + text_recs.size() * sizeof(TextRecord));
+  hdr.grams_offset    = align8(hdr.keys_offset + key_recs.size() * sizeof(KeyRecord));
+  hdr.postings_offset = align8(hdr.grams_offset + gram_recs.size() * sizeof(GramRecord));
+  hdr.strings_offset  = align8(hdr.postings_offset + postings.size() * sizeof(uint32_t));
+  hdr.strings_size    = strings.size();
+
+  // Built in memory, then written in one go.
+  std::vector<uint8_t> out;
+  out.reserve(hdr.strings_offset + strings.size());
+  auto pad_to = [&](const uint64_t off) -> void {
+    out.resize(std::max<uint64_t>(out.size(), off), 0);
+  };
+  auto put = [&]<typename T>(const T val) -> void {
+    const T le = maybe_bitswap(val, Endian::Little);
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&le);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+  };
+
+  out.insert(out.end(), hdr.magic, hdr.magic + sizeof(hdr.magic));
+  put(hdr.version);
+  put(hdr.reserved);
+  put(hdr.num_files);
+  put(hdr.num_texts);
+  put(hdr.num_keys);
+  put(hdr.num_grams);
+  put(hdr.num_postings);
+  put(hdr.files_offset);
+  put(hdr.texts_offset);
+  put(hdr.keys_offset);
+  put(hdr.grams_offset);
+  put(hdr.postings_offset);
+  put(hdr.strings_offset);
+  put(hdr.strings_size);
+
+  pad_to(hdr.files_offset);
+  for(const auto& rec : file_recs) {
+    put(rec.path_offset);
+    put(rec.path_length);
+    put(rec.text_count);
+    put(rec.first_text);
+    put(rec.file_size);
+    put(rec.mtime);
+  }
+
+  pad_to(hdr.texts_offset);
+  for(const auto& rec : text_recs) {
+    put(rec.file);
+    put(rec.keyword_length);
+    put(rec.keyword_offset);
+    put(rec.value_offset);
+    put(rec.value_length);
+  }
+
+  pad_to(hdr.keys_offset);
+  for(const auto& rec : key_recs) {
+    put(rec.string_offset);
+    put(rec.string_length);
+    put(rec.posting_count);
+    put(rec.first_posting);
+  }
+
+  pad_to(hdr.grams_offset);
+  for(const auto& rec : gram_recs) {
+    put(rec.gram);
+    put(rec.posting_count);
+    put(rec.first_posting);
+  }
+
+  pad_to(hdr.postings_offset);
+  for(const uint32_t val : postings) put(val);
+
+  pad_to(hdr.strings_offset);
+  out.insert(out.end(), strings.begin(), strings.end());
+
+  OutFile file(out_path, true);
+  file.write(out);
+  file.commit();
+}
+
+auto spng::TextIndex::Writer::num_files() const -> size_t {
+  std::lock_guard guard(lock_);
+  return files_.size();
+}
+
+auto spng::TextIndex::Writer::num_texts() const -> size_t {
+  std::lock_guard guard(lock_);
+  size_t count = 0;
+  for(const auto& file : files_) count += file.texts.size();
+  return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::TextIndex::Reader::file(const uint64_t i) const -> File {
+  if(i >= header_.num_files) {
+    throw std::out_of_range("File index out of range.");
+  }
+
+  const uint64_t at = header_.files_offset + i * sizeof(FileRecord);
+  File file;
+  file.path       = _string(_read<uint64_t>(at), _read<uint32_t>(at + 8));
+  file.text_count = _read<uint32_t>(at + 12);
+  file.first_text = _read<uint64_t>(at + 16);
+  file.file_size  = _read<uint64_t>(at + 24);
+  file.mtime      = _read<int64_t>(at + 32);
+  if(file.first_text > header_.num_texts || file.text_count > header_.num_texts - file.first_text) {
+    throw std::runtime_error("Text index is truncated or corrupted.");
+  }
+  return file;
+}
+
+auto spng::TextIndex::Reader::text(const uint64_t i) const -> Text {
+  if(i >= header_.num_texts) {
+    throw std::out_of_range("Text index out of range.");
+  }
+
+  const uint64_t at = header_.texts_offset + i * sizeof(TextRecord);
+  Text text;
+  text.file    = _read<uint32_t>(at);
+  text.keyword = _string(_read<uint64_t>(at + 8), _read<uint32_t>(at + 4));
+  text.value   = _string(_read<uint64_t>(at + 16), _read<uint64_t>(at + 24));
+  return text;
+}
+
+auto spng::TextIndex::Reader::find_file(const std::string_view path) const -> int64_t {
+  uint64_t lo = 0, hi = header_.num_files;
+  while(lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    const auto here = file(mid).path;
+    if(here == path) {
+      return static_cast<int64_t>(mid);
+    }
+    here < path ? lo = mid + 1 : hi = mid;
+  }
+  return -1;
+}
+
+auto spng::TextIndex::Reader::_string(const uint64_t offset, const uint64_t length) const -> std::string_view {
+  if(offset > header_.strings_size || length > header_.strings_size - offset) {
+    throw std::runtime_error("Text index is truncated or corrupted.");
+  }
+  return { reinterpret_cast<const char*>(map_.bytes().data()) + header_.strings_offset + offset, length };
+}
+
+auto spng::TextIndex::Reader::_postings(const uint64_t first, const uint32_t count) const -> std::vector<uint32_t> {
+  if(first > header_.num_postings || count > header_.num_postings - first) {
+    throw std::runtime_error("Text index is truncated or corrupted.");
+  }
+
+  std::vector<uint32_t> list(count);
+  for(uint32_t i = 0; i < count; i++) {
+    list[i] = _read<uint32_t>(header_.postings_offset + (first + i) * sizeof(uint32_t));
+  }
+  return list;
+}
+
+auto spng::TextIndex::Reader::_key_postings(const std::string_view keyword) const -> std::vector<uint32_t> {
+  uint64_t lo = 0, hi = header_.num_keys;
+  while(lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    const uint64_t at  = header_.keys_offset + mid * sizeof(KeyRecord);
+    const auto here = _string(_read<uint64_t>(at), _read<uint32_t>(at + 8));
+    if(here == keyword) {
+      return _postings(_read<uint64_t>(at + 16), _read<uint32_t>(at + 12));
+    }
+    here < keyword ? lo = mid + 1 : hi = mid;
+  }
+  return {};
+}
+
+auto spng::TextIndex::Reader::_gram_postings(const uint32_t gram) const -> std::vector<uint32_t> {
+  uint64_t lo = 0, hi = header_.num_grams;
+  while(lo < hi) {
+    const uint64_t mid = lo + (hi - lo) / 2;
+    const uint64_t at  = header_.grams_offset + mid * sizeof(GramRecord);
+    const auto here = _read<uint32_t>(at);
+    if(here == gram) {
+      return _postings(_read<uint64_t>(at + 8), _read<uint32_t>(at + 4));
+    }
+    here < gram ? lo = mid + 1 : hi = mid;
+  }
+  return {};
+}
+
+auto spng::TextIndex::Reader::query(const std::string_view pattern) const -> std::vector<Hit> {
+  const size_t eq = pattern.find('=');
+  const std::string_view key  = eq == std::string_view::npos ? std::string_view() : pattern.substr(0, eq);
+  const std::string_view text = eq == std::string_view::npos ? pattern : pattern.substr(eq + 1);
+  const std::span needle(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+  auto bytes_of = [](const std::string_view str) {
+    return std::span(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+  };
+
+  // Candidate files, std::nullopt meaning all of them. A value
+  // containing the text has every trigram of the text.
+  std::optional<std::vector<uint32_t>> candidates;
+  if(!key.empty()) {
+    candidates = _key_postings(key);
+  } if(text.size() >= 3) {
+    std::vector<uint32_t> grams;
+    append_trigrams(text, grams);
+    sort_unique(grams);
+    for(const uint32_t gram : grams) {
+      const auto list = _gram_postings(gram);
+      candidates = candidates ? intersect(*candidates, list) : list;
+      if(candidates->empty()) break;
+    }
+
+    // Without a keyword, the text may also be in a keyword. There
+    // are few distinct keywords, so they're simply all checked.
+    if(key.empty()) {
+      for(uint64_t i = 0; i < header_.num_keys; i++) {
+        const uint64_t at = header_.keys_offset + i * sizeof(KeyRecord);
+        if(find_bytes(bytes_of(_string(_read<uint64_t>(at), _read<uint32_t>(at + 8))), needle) != npos) {
+          candidates = unite(*candidates, _postings(_read<uint64_t>(at + 16), _read<uint32_t>(at + 12)));
+        }
+      }
+    }
+  }
+
+  std::vector<Hit> hits;
+  auto check_file = [&](const uint32_t id) -> void {
+    const File rec = file(id);
+    for(uint64_t t = rec.first_text; t < rec.first_text + rec.text_count; t++) {
+      const Text entry = this->text(t);
+      if(!key.empty() && entry.keyword != key) {
+        continue;
+      } if(key.empty() && find_bytes(bytes_of(entry.keyword), needle) != npos) {
+        hits.emplace_back(Hit{ id, t, 0, true });
+      } else if(const size_t at = find_bytes(bytes_of(entry.value), needle); at != npos) {
+        hits.emplace_back(Hit{ id, t, at, false });
+      }
+    }
+  };
+
+  if(candidates) {
+    for(const uint32_t id : *candidates) check_file(id);
+  } else {
+    for(uint64_t id = 0; id < header_.num_files; id++) check_file(static_cast<uint32_t>(id));
+  }
+  return hits;
+}
+
+spng::TextIndex::Reader::Reader(const std::string& in_path)
+  : map_(in_path) {
+  const auto bytes = map_.bytes();
+  if(bytes.size() < sizeof(Header)) {
+    throw std::runtime_error("Text index is too small.");
+  }
+
+  std::memcpy(&header_, bytes.data(), sizeof(Header));
+  if(std::memcmp(header_.magic, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Invalid text index signature.");
+  }
+
+  auto& h = header_;
+  h.version         = maybe_bitswap(h.version, Endian::Little);
+  h.num_files       = maybe_bitswap(h.num_files, Endian::Little);
+  h.num_texts       = maybe_bitswap(h.num_texts, Endian::Little);
+  h.num_keys        = maybe_bitswap(h.num_keys, Endian::Little);
+  h.num_grams       = maybe_bitswap(h.num_grams, Endian::Little);
+  h.num_postings    = maybe_bitswap(h.num_postings, Endian::Little);
+  h.files_offset    = maybe_bitswap(h.files_offset, Endian::Little);
+  h.texts_offset    = maybe_bitswap(h.texts_offset, Endian::Little);
+  h.keys_offset     = maybe_bitswap(h.keys_offset, Endian::Little);
+  h.grams_offset    = maybe_bitswap(h.grams_offset, Endian::Little);
+  h.postings_offset = maybe_bitswap(h.postings_offset, Endian::Little);
+  h.strings_offset  = maybe_bitswap(h.strings_offset, Endian::Little);
+  h.strings_size    = maybe_bitswap(h.strings_size, Endian::Little);
+
+  if(h.version != version) {
+    throw std::runtime_error(fmt("Unsupported text index version ({}).", h.version));
+  }
+
+  // Validate every section once, up front. After this the
+  // accessors only need to check indices and string ranges.
+  auto check_section = [&](const uint64_t off, const uint64_t count, const uint64_t width) -> void {
+    if(count != 0 && (count > bytes.size() / width || off > bytes.size() - count * width)) {
+      throw std::runtime_error("Text index is truncated or corrupted.");
+    }
+  };
+
+  check_section(h.files_offset,    h.num_files,    sizeof(FileRecord));
+  check_section(h.texts_offset,    h.num_texts,    sizeof(TextRecord));
+  check_section(h.keys_offset,     h.num_keys,     sizeof(KeyRecord));
+  check_section(h.grams_offset,    h.num_grams,    sizeof(GramRecord));
+  check_section(h.postings_offset, h.num_postings, sizeof(uint32_t));
+  check_section(h.strings_offset,  h.strings_size, 1);
+}
@@ -0,0 +1,99 @@
+#include <TextSearch.hpp>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SPNG_TEXTSEARCH_SSE2
+#endif
+
+auto spng::find_bytes(const std::span<const uint8_t> haystack, const std::span<const uint8_t> needle) -> size_t {
+  const size_t h = haystack.size();
+  const size_t n = needle.size();
+  if(n == 0) {
+    return 0;
+  } if(n > h) {
+    return npos;
+  }
+
+  const uint8_t* hay = haystack.data();
+  const uint8_t* ndl = needle.data();
+  if(n == 1) {
+    const auto* hit = static_cast<const uint8_t*>(std::memchr(hay, ndl[0], h));
+    return hit == nullptr ? npos : static_cast<size_t>(hit - hay);
+  }
+
+  size_t i = 0;
+#ifdef SPNG_TEXTSEARCH_SSE2
+  const __m128i first = _mm_set1_epi8(static_cast<char>(ndl[0]));
+  const __m128i last  = _mm_set1_epi8(static_cast<char>(ndl[n - 1]));
+  for(; i + n - 1 + 16 <= h; i += 16) {
+    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i));
+    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hay + i + n - 1));
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last))));
+    while(mask != 0) {
+      const auto bit = static_cast<size_t>(std::countr_zero(mask));
+      if(std::memcmp(hay + i + bit + 1, ndl + 1, n - 2) == 0) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for(; i + n <= h; i++) {
+    if(hay[i] == ndl[0] && hay[i + n - 1] == ndl[n - 1] && std::memcmp(hay + i + 1, ndl + 1, n - 2) == 0) {
+      return i;
+    }
+  }
+  return npos;
+}
+
+auto spng::split_text(const Chunk::Type type, const std::span<const uint8_t> payload) -> std::optional<TextChunk> {
+  if(type != Chunk::Type::tEXt && type != Chunk::Type::zTXt && type != Chunk::Type::iTXt) {
+    return std::nullopt;
+  }
+
+  // All three start with a 1-79 byte keyword and a null terminator.
+  const auto* data = payload.data();
+  const auto* nul  = static_cast<const uint8_t*>(std::memchr(data, '\0', std::min<size_t>(payload.size(), 80)));
+  if(nul == nullptr || nul == data) {
+    throw std::runtime_error("Text chunk has an invalid keyword.");
+  }
+
+  TextChunk text;
+  const auto kw_len = static_cast<size_t>(nul - data);
+  text.keyword = payload.first(kw_len);
+  auto rest    = payload.subspan(kw_len + 1);
+
+  if(type == Chunk::Type::zTXt) {
+    // Compression method, then the compressed text.
+    if(rest.empty() || rest[0] != 0) {
+      throw std::runtime_error("zTXt chunk has an invalid compression method.");
+    }
+    text.value      = rest.subspan(1);
+    text.compressed = true;
+  } else if(type == Chunk::Type::iTXt) {
+    // Compression flag and method, then a language tag
+    // and a translated keyword, both null terminated.
+    if(rest.size() < 2 || rest[0] > 1 || (rest[0] == 1 && rest[1] != 0)) {
+      throw std::runtime_error("iTXt chunk has an invalid compression flag or method.");
+    }
+    text.compressed = rest[0] == 1;
+    rest = rest.subspan(2);
+    for(int field = 0; field < 2; field++) {
+      const auto* end = static_cast<const uint8_t*>(std::memchr(rest.data(), '\0', rest.size()));
+      if(end == nullptr) {
+        throw std::runtime_error("iTXt chunk is truncated.");
+      }
+      rest = rest.subspan(static_cast<size_t>(end - rest.data()) + 1);
+    }
+    text.value = rest;
+  } else {
+    text.value = rest;
+  }
+
+  return text;
+}
@@ -0,0 +1,155 @@
+#include <Trace.hpp>
+#include <Fmt.hpp>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <ios>
+
+namespace {
+  using spng::Trace::Clock;
+
+  struct Event {
+    const char* name = nullptr;
+    Clock::time_point begin;
+    Clock::time_point end;
+    std::string detail;
+  };
+
+  struct ThreadRing {
+    std::vector<Event> events;  // Fixed capacity, used as a ring.
+    size_t next    = 0;         // Slot the next event goes into.
+    size_t dropped = 0;         // Events overwritten so far.
+    uint32_t tid   = 0;
+  };
+
+  struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadRing>> threads;
+    Clock::time_point origin;
+    size_t capacity = 0;
+  };
+
+  auto registry() -> Registry& {
+    static Registry reg;
+    return reg;
+  }
+
+  auto local() -> ThreadRing& {
+    thread_local ThreadRing* tls = nullptr;
+    if(tls == nullptr) {
+      auto& reg = registry();
+      std::lock_guard guard(reg.lock);
+      auto& ring = reg.threads.emplace_back(std::make_unique<ThreadRing>());
+      ring->events.reserve(reg.capacity);
+      ring->tid = static_cast<uint32_t>(reg.threads.size());
+      tls = ring.get();
+    }
+    return *tls;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+auto spng::Trace::json_escape(const std::string_view str) -> std::string {
+  std::string out;
+  out.reserve(str.size());
+  for(const char ch : str) {
+    switch(ch) {
+      case '"':  out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n";  break;
+      case '\t': out += "\\t";  break;
+      default:
+        if(static_cast<uint8_t>(ch) < 0x20) {
+          out += fmt("\\u{:04x}", static_cast<uint32_t>(ch));
+        } else {
+          out += ch;
+        }
+    }
+  }
+  return out;
+}
+
+auto spng::Trace::enable(const size_t capacity) -> void {
+  auto& reg = registry();
+  {
+    std::lock_guard guard(reg.lock);
+    reg.origin   = Clock::now();
+    reg.capacity = std::max<size_t>(capacity, 1);
+  }
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+auto spng::Trace::record(const char* name,
+  const Clock::time_point begin,
+  const Clock::time_point end,
+  std::string detail
+) -> void {
+  if(!enabled()) return;
+
+  auto& ring = local();
+  const size_t cap = ring.events.capacity();
+  Event ev = { name, begin, end, std::move(detail) };
+
+  if(ring.events.size() < cap) {
+    ring.events.emplace_back(std::move(ev));
+  } else {
+    ring.events[ring.next] = std::move(ev);
+    ++ring.dropped;
+  }
+  ring.next = (ring.next + 1) % cap;
+}
+
+auto spng::Trace::write_json(const std::string& path) -> void {
+  auto& reg = registry();
+  std::lock_guard guard(reg.lock);
+
+  std::ofstream of(path, std::ios::trunc);
+  if(!of.is_open()) {
+    throw std::ios_base::failure(fmt("Failed to open output file \"{}\".", path));
+  }
+
+  auto us = [&](const Clock::time_point tp) -> double {
+    return std::chrono::duration<double, std::micro>(tp - reg.origin).count();
+  };
+
+  of << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  bool first = true;
+  auto sep = [&] {
+    if(!first) of << ",\n";
+    first = false;
+  };
+
+  for(const auto& ring : reg.threads) {
+    sep();
+    of << fmt(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"worker {}"}}}})",
+      ring->tid, ring->tid);
+
+    if(ring->dropped) {
+      sep();
+      of << fmt(R"({{"name":"dropped {} events","ph":"i","s":"t","ts":0,"pid":1,"tid":{}}})",
+        ring->dropped, ring->tid);
+    }
+
+    for(const auto& ev : ring->events) {
+      sep();
+      of << fmt(R"({{"name":"{}","cat":"see_png","ph":"X","ts":{:.3f},"dur":{:.3f},"pid":1,"tid":{})",
+        ev.name,
+        us(ev.begin),
+        us(ev.end) - us(ev.begin),
+        ring->tid);
+      if(!ev.detail.empty()) {
+        of << fmt(R"(,"args":{{"file":"{}"}})", json_escape(ev.detail));
+      }
+      of << '}';
+    }
+  }
+
+  of << "\n]}\n";
+  of.flush();
+  if(!of.good()) {
+    throw std::ios_base::failure(fmt("Failed to write \"{}\".", path));
+  }
+}
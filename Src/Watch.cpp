@@ -0,0 +1,200 @@
+#include <Watch.hpp>
+#include <FileCycle.hpp>
+#include <Context.hpp>
+#include <ConManip.hpp>
+#include <print>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  // How long a file has to be left alone before it's inspected.
+  constexpr auto debounce = std::chrono::milliseconds(250);
+
+  constexpr uint32_t dir_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+
+  auto is_png_name(const std::filesystem::path& path) -> bool {
+    auto ext = path.extension().string();
+    std::ranges::transform(ext, ext.begin(), [](const char ch) { return std::tolower(ch); });
+    return ext == ".png";
+  }
+
+  auto watch_error(const std::string& path, const std::string_view what) -> bool {
+    spng::set_console(spng::ConFg::Red);
+    spng::set_console(spng::ConStyle::Bold);
+    std::print("FILE I/O :: ");
+    spng::reset_console();
+    std::println("For {} :: {}: {}", path, what, std::strerror(errno));
+    return false;
+  }
+
+  class Watcher {
+  public:
+    // Watches dir and everything below it. With queue_existing,
+    // .png files already there are queued as well: they may have
+    // been written before the watch on a new directory was added.
+    auto add_tree(const std::string& dir, const bool queue_existing) -> bool {
+      if(!_add_dir(dir)) {
+        return false;
+      }
+
+      std::error_code ec;
+      auto it = std::filesystem::recursive_directory_iterator(dir, ec);
+      for( ; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if(it->is_directory(ec)) {
+          _add_dir(it->path().string());
+        } else if(queue_existing && is_png_name(it->path()) && it->is_regular_file(ec)) {
+          _touch(it->path().string());
+        }
+      }
+      return true;
+    }
+
+    // Handles whatever events are ready.
+    auto read_events() -> void {
+      alignas(inotify_event) std::array<char, 64 * 1024> buff;
+      const ssize_t got = ::read(fd_, buff.data(), buff.size());
+      if(got <= 0) {
+        return;
+      }
+
+      for(ssize_t off = 0; off < got; ) {
+        const auto* event = reinterpret_cast<const inotify_event*>(buff.data() + off);
+        off += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+        if(event->mask & IN_Q_OVERFLOW) {
+          spng::set_console(spng::ConFg::Yellow);
+          std::print("Events lost ");
+          spng::reset_console();
+          std::println(":: the inotify queue overflowed, some files may have been missed.");
+          continue;
+        } if(event->mask & IN_IGNORED) {
+          dirs_.erase(event->wd);
+          continue;
+        }
+
+        const auto dir = dirs_.find(event->wd);
+        if(dir == dirs_.end() || event->len == 0) {
+          continue;
+        }
+
+        const auto path = (std::filesystem::path(dir->second) / event->name).string();
+        if(event->mask & IN_ISDIR) {
+          if(event->mask & (IN_CREATE | IN_MOVED_TO)) add_tree(path, true);
+        } else if(event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO) && is_png_name(path)) {
+          _touch(path);
+        }
+      }
+    }
+
+    // Removes and returns the files that have been quiet long enough.
+    auto take_due() -> std::vector<std::string> {
+      const auto now = Clock::now();
+      std::vector<std::string> due;
+      std::erase_if(pending_, [&](const auto& entry) {
+        if(entry.second > now) return false;
+        due.emplace_back(entry.first);
+        return true;
+      });
+      std::ranges::sort(due);
+      return due;
+    }
+
+    // Until the next file is due, or -1 (forever) if none is pending.
+    [[nodiscard]] auto poll_timeout() const -> int {
+      if(pending_.empty()) {
+        return -1;
+      }
+      auto next = Clock::time_point::max();
+      for(const auto& [_, deadline] : pending_) next = std::min(next, deadline);
+      const auto wait = std::chrono::ceil<std::chrono::milliseconds>(next - Clock::now()).count();
+      return static_cast<int>(std::max<decltype(wait)>(wait, 0));
+    }
+
+    [[nodiscard]] auto fd() const -> int {
+      return fd_;
+    }
+
+    Watcher()
+      : fd_(::inotify_init1(IN_CLOEXEC)) {}
+
+    ~Watcher() {
+      if(fd_ >= 0) ::close(fd_);
+    }
+  private:
+    auto _add_dir(const std::string& dir) -> bool {
+      const int wd = ::inotify_add_watch(fd_, dir.c_str(), dir_mask);
+      if(wd < 0) {
+        return watch_error(dir, "inotify_add_watch");
+      }
+      dirs_[wd] = dir;
+      return true;
+    }
+
+    // Every event for a file pushes its deadline back.
+    auto _touch(const std::string& path) -> void {
+      pending_[path] = Clock::now() + debounce;
+    }
+
+    int fd_;
+    std::unordered_map<int, std::string> dirs_;  // Watch descriptor to directory.
+    std::unordered_map<std::string, Clock::time_point> pending_;
+  };
+}
+
+auto spng::Watch::run(const std::string& dir) -> bool {
+  Watcher watcher;
+  if(watcher.fd() < 0) {
+    return watch_error(dir, "inotify_init1");
+  } if(!watcher.add_tree(dir, false)) {
+    return false;
+  }
+
+  if(!(Context::get().flags_ & Context::Silent)) {
+    std::println("Watching {} for new or modified .png files.", dir);
+    std::fflush(stdout);
+  }
+
+  for(;;) {
+    pollfd pfd = { watcher.fd(), POLLIN, 0 };
+    const int ready = ::poll(&pfd, 1, watcher.poll_timeout());
+    if(ready < 0 && errno != EINTR) {
+      return watch_error(dir, "poll");
+    } if(ready > 0) {
+      watcher.read_events();
+    }
+
+    // Bad files are reported, and watching goes on.
+    if(const auto due = watcher.take_due(); !due.empty()) {
+      run_file_cycles(due);
+      std::fflush(stdout);
+    }
+  }
+}
+
+#else
+
+auto spng::Watch::run(const std::string& dir) -> bool {
+  set_console(ConFg::Red);
+  std::print("UNSUPPORTED ");
+  reset_console();
+  std::println(":: --watch {} needs inotify, which is only available on Linux.", dir);
+  return false;
+}
+
+#endif
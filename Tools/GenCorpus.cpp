@@ -0,0 +1,414 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Writes a deterministic corpus of synthetic PNG files, for
+// benchmarking multi-file throughput and memory use at scale.
+// The same options and seed always produce byte-identical files.
+//
+// Files are spread over subdirectories of 1000 files each
+// (<out>/0000/00000000.png, ...), and a manifest.tsv listing
+// every file, its size, chunk mix and injected corruption is
+// written next to them.
+//
+// Usage: see_png_gencorpus --out DIR [options], see --help.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include <PngWriter.hpp>
+#include <Chunks.hpp>
+#include <FlatBuffer.hpp>
+#include <Fmt.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <print>
+
+using namespace spng;
+namespace fs = std::filesystem;
+
+namespace {
+  // What goes into each file, besides IHDR/IDAT/IEND.
+  enum class Mix : uint8_t {
+    Plain,     // Just the image.
+    ManyIdat,  // Image data split over many IDAT chunks.
+    BigIccp,   // A large iCCP profile.
+    ManyText,  // Thousands of tEXt chunks.
+    Apng,      // acTL + fcTL/fdAT frames.
+    Mixed,     // Cycle through all of the above.
+  };
+
+  // Corruption injected into a fraction of the files.
+  enum class Corruption : uint8_t {
+    None,
+    BadCrc,        // One chunk's CRC is flipped.
+    Truncated,     // The file is cut short.
+    BadSignature,  // The PNG signature is damaged.
+    MissingIend,   // The IEND chunk is dropped.
+    BadLength,     // A chunk length points past the end of the file.
+  };
+
+  struct Options {
+    fs::path out;
+    uint64_t count       = 1000;
+    uint64_t seed        = 1;
+    uint32_t width       = 64;
+    uint32_t height      = 64;
+    uint32_t idat_chunks = 256;   // For Mix::ManyIdat.
+    uint32_t text_chunks = 2000;  // For Mix::ManyText.
+    uint32_t iccp_size   = 65536; // For Mix::BigIccp.
+    uint32_t apng_frames = 8;     // For Mix::Apng.
+    uint32_t corrupt_pct = 0;     // Percentage of corrupted files.
+    Mix mix              = Mix::Mixed;
+  };
+
+  struct Rng {
+    uint64_t state;
+    explicit Rng(const uint64_t seed)
+      : state(seed * 0x9E3779B97F4A7C15ULL + 0x632BE59BD9B4E019ULL) {}
+
+    // splitmix64
+    auto next() -> uint64_t {
+      uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+    auto below(const uint64_t n) -> uint64_t {
+      return n ? next() % n : 0;
+    }
+  };
+
+  constexpr std::array mix_names = {
+    "plain", "many-idat", "big-iccp", "many-text", "apng", "mixed"
+  };
+
+  constexpr std::array corruption_names = {
+    "none", "bad-crc", "truncated", "bad-signature", "missing-iend", "bad-length"
+  };
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static auto put_u32(FlatBuffer::Buffer& out, const uint32_t val) -> void {
+  out.emplace_back(static_cast<uint8_t>(val >> 24));
+  out.emplace_back(static_cast<uint8_t>(val >> 16));
+  out.emplace_back(static_cast<uint8_t>(val >> 8));
+  out.emplace_back(static_cast<uint8_t>(val));
+}
+
+static auto put_u16(FlatBuffer::Buffer& out, const uint16_t val) -> void {
+  out.emplace_back(static_cast<uint8_t>(val >> 8));
+  out.emplace_back(static_cast<uint8_t>(val));
+}
+
+// Filtered (filter type 0) RGBA8 scanlines with a
+// cheap per-file pattern, so files aren't all identical.
+static auto make_scanlines(Rng& rng, const uint32_t width, const uint32_t height) -> FlatBuffer::Buffer {
+  FlatBuffer::Buffer raw;
+  raw.reserve(static_cast<size_t>(height) * (width * 4 + 1));
+  const auto tint = static_cast<uint8_t>(rng.next());
+
+  for(uint32_t y = 0; y < height; y++) {
+    raw.emplace_back(0);
+    for(uint32_t x = 0; x < width; x++) {
+      raw.emplace_back(static_cast<uint8_t>(x ^ tint));
+      raw.emplace_back(static_cast<uint8_t>(y + tint));
+      raw.emplace_back(static_cast<uint8_t>(x + y));
+      raw.emplace_back(0xFF);
+    }
+  }
+
+  return raw;
+}
+
+// Splits a zlib stream over "parts" chunks of the given type.
+// For fdAT, each chunk is prefixed with a sequence number.
+static auto split_data(PngWriter& png,
+  const std::string_view type,
+  const FlatBuffer::Buffer& zdata,
+  const uint32_t parts,
+  uint32_t* seq = nullptr
+) -> void {
+  const size_t n    = std::max<size_t>(1, std::min<size_t>(parts, zdata.size()));
+  const size_t step = (zdata.size() + n - 1) / n;
+
+  for(size_t pos = 0; pos < zdata.size(); pos += step) {
+    const size_t len = std::min(step, zdata.size() - pos);
+    FlatBuffer::Buffer part;
+    if(seq != nullptr) {
+      put_u32(part, (*seq)++);
+    }
+    part.insert(part.end(), zdata.begin() + pos, zdata.begin() + pos + len);
+    png.chunk(type, part);
+  }
+}
+
+// An ICC profile with a plausible 128 byte header
+// followed by pseudo-random tag data.
+static auto make_icc_profile(Rng& rng, const uint32_t size) -> FlatBuffer::Buffer {
+  FlatBuffer::Buffer icc;
+  const uint32_t total = std::max<uint32_t>(size, 132);
+  put_u32(icc, total);                       // Profile size
+  icc.insert(icc.end(), { 's', 'p', 'n', 'g' }); // CMM
+  put_u32(icc, 0x04300000);                  // Version 4.3
+  icc.insert(icc.end(), { 'm', 'n', 't', 'r' }); // Device class
+  icc.insert(icc.end(), { 'R', 'G', 'B', ' ' }); // Colour space
+  icc.insert(icc.end(), { 'X', 'Y', 'Z', ' ' }); // PCS
+  icc.resize(36, 0);                         // Date/time
+  icc.insert(icc.end(), { 'a', 'c', 's', 'p' }); // Signature
+  icc.resize(128, 0);
+  put_u32(icc, 0);                           // Tag count
+
+  // A handful of distinct profiles per corpus, like real
+  // data where the same few profiles get embedded everywhere.
+  Rng prof(rng.below(4) + 1);
+  while(icc.size() < total) {
+    icc.emplace_back(static_cast<uint8_t>(prof.next()));
+  }
+
+  return icc;
+}
+
+static auto add_text(PngWriter& png, Rng& rng, const uint32_t count) -> void {
+  constexpr std::array keywords = {
+    "Title", "Author", "Description", "Copyright", "Software", "Comment", "Source"
+  };
+
+  for(uint32_t i = 0; i < count; i++) {
+    const std::string kw = keywords.at(rng.below(keywords.size()));
+    std::string value = spng::fmt("entry {} ", i);
+    const size_t len = 8 + rng.below(120);
+    while(value.size() < len) {
+      value += static_cast<char>('a' + rng.below(26));
+    }
+
+    FlatBuffer::Buffer data(kw.begin(), kw.end());
+    data.emplace_back(0);
+    data.insert(data.end(), value.begin(), value.end());
+    png.chunk("tEXt", data);
+  }
+}
+
+static auto make_file(const Options& opts, Rng& rng, const Mix mix) -> FlatBuffer::Buffer {
+  PngWriter png;
+  png.ihdr(opts.width, opts.height, 8, Ihdr::ColorType::TruecolorAlpha);
+
+  if(mix == Mix::BigIccp) {
+    const auto icc = make_icc_profile(rng, opts.iccp_size);
+    constexpr std::string_view name = "ICC Profile";
+    FlatBuffer::Buffer data(name.begin(), name.end());
+    data.emplace_back(0); // Name terminator
+    data.emplace_back(0); // Compression method
+    const auto z = zlib_store(icc);
+    data.insert(data.end(), z.begin(), z.end());
+    png.chunk("iCCP", data);
+  }
+
+  add_text(png, rng, mix == Mix::ManyText ? opts.text_chunks : 2);
+
+  uint32_t seq = 0;
+  auto fctl = [&] {
+    FlatBuffer::Buffer data;
+    put_u32(data, seq++);
+    put_u32(data, opts.width);
+    put_u32(data, opts.height);
+    put_u32(data, 0);   // x offset
+    put_u32(data, 0);   // y offset
+    put_u16(data, 1);   // delay numerator
+    put_u16(data, 10);  // delay denominator
+    data.emplace_back(0); // dispose op
+    data.emplace_back(0); // blend op
+    png.chunk("fcTL", data);
+  };
+
+  if(mix == Mix::Apng) {
+    FlatBuffer::Buffer actl;
+    put_u32(actl, opts.apng_frames);
+    put_u32(actl, 0); // Loop forever
+    png.chunk("acTL", actl);
+    fctl();
+  }
+
+  const auto zdata = zlib_store(make_scanlines(rng, opts.width, opts.height));
+  split_data(png, "IDAT", zdata, mix == Mix::ManyIdat ? opts.idat_chunks : 1);
+
+  if(mix == Mix::Apng) {
+    for(uint32_t f = 1; f < opts.apng_frames; f++) {
+      fctl();
+      split_data(png, "fdAT", zlib_store(make_scanlines(rng, opts.width, opts.height)), 1, &seq);
+    }
+  }
+
+  png.iend();
+  return png.take();
+}
+
+// Damages "file" in place. The chunk picked for
+// BadCrc/BadLength is chosen among the chunks after IHDR.
+static auto corrupt(FlatBuffer::Buffer& file, Rng& rng, const Corruption kind) -> void {
+  // Offsets of every chunk header after the signature.
+  std::vector<size_t> headers;
+  for(size_t off = 8; off + 12 <= file.size(); ) {
+    headers.emplace_back(off);
+    const uint32_t len = uint32_t(file[off]) << 24
+      | uint32_t(file[off + 1]) << 16
+      | uint32_t(file[off + 2]) << 8
+      | uint32_t(file[off + 3]);
+    off += 12 + static_cast<size_t>(len);
+  }
+
+  const size_t victim = headers.at(1 + rng.below(headers.size() - 1));
+  switch(kind) {
+    case Corruption::BadCrc: {
+      const uint32_t len = uint32_t(file[victim]) << 24
+        | uint32_t(file[victim + 1]) << 16
+        | uint32_t(file[victim + 2]) << 8
+        | uint32_t(file[victim + 3]);
+      file.at(victim + 8 + len) ^= 0xFF;
+      break;
+    }
+    case Corruption::Truncated:
+      file.resize(9 + rng.below(file.size() - 9));
+      break;
+    case Corruption::BadSignature:
+      file.at(rng.below(8)) ^= 0x20;
+      break;
+    case Corruption::MissingIend:
+      file.resize(headers.back());
+      break;
+    case Corruption::BadLength:
+      file.at(victim) = 0x7F;
+      break;
+    default: break;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static auto print_usage() -> void {
+  std::println("Usage: see_png_gencorpus --out DIR [options]");
+  std::println("  --count N          Number of files (default 1000)");
+  std::println("  --seed N           Seed for all generated content (default 1)");
+  std::println("  --size WxH         Image dimensions (default 64x64)");
+  std::println("  --mix NAME         plain, many-idat, big-iccp, many-text, apng, mixed (default)");
+  std::println("  --idat-chunks N    IDAT chunks per file for many-idat (default 256)");
+  std::println("  --text-chunks N    tEXt chunks per file for many-text (default 2000)");
+  std::println("  --iccp-size N      Uncompressed iCCP profile size for big-iccp (default 65536)");
+  std::println("  --apng-frames N    Frames per file for apng (default 8)");
+  std::println("  --corrupt-pct N    Percentage of files to corrupt (default 0)");
+}
+
+static auto parse_options(const int argc, char** argv, Options& opts) -> bool {
+  for(int i = 1; i < argc; i++) {
+    const std::string_view arg = argv[i];
+    if(arg == "--help" || arg == "-h") {
+      return false;
+    } if(i + 1 >= argc) {
+      std::println("Expected a value after \"{}\".", arg);
+      return false;
+    }
+
+    const std::string val = argv[++i];
+    if(arg == "--out")              opts.out = val;
+    else if(arg == "--count")       opts.count = std::stoull(val);
+    else if(arg == "--seed")        opts.seed = std::stoull(val);
+    else if(arg == "--idat-chunks") opts.idat_chunks = std::stoul(val);
+    else if(arg == "--text-chunks") opts.text_chunks = std::stoul(val);
+    else if(arg == "--iccp-size")   opts.iccp_size = std::stoul(val);
+    else if(arg == "--apng-frames") opts.apng_frames = std::max(1UL, std::stoul(val));
+    else if(arg == "--corrupt-pct") opts.corrupt_pct = std::min(100UL, std::stoul(val));
+    else if(arg == "--size") {
+      const auto x = val.find('x');
+      if(x == std::string::npos) {
+        std::println("Invalid size \"{}\", expected WxH.", val);
+        return false;
+      }
+      opts.width  = std::max(1UL, std::stoul(val.substr(0, x)));
+      opts.height = std::max(1UL, std::stoul(val.substr(x + 1)));
+    }
+    else if(arg == "--mix") {
+      const auto it = std::ranges::find(mix_names, val);
+      if(it == mix_names.end()) {
+        std::println("Unknown mix \"{}\".", val);
+        return false;
+      }
+      opts.mix = static_cast<Mix>(it - mix_names.begin());
+    }
+    else {
+      std::println("Unknown option \"{}\".", arg);
+      return false;
+    }
+  }
+
+  if(opts.out.empty()) {
+    std::println("--out is required.");
+    return false;
+  }
+
+  return true;
+}
+
+int main(const int argc, char** argv) {
+  Options opts;
+  try {
+    if(!parse_options(argc, argv, opts)) {
+      print_usage();
+      return 1;
+    }
+  } catch(const std::exception&) {
+    std::println("Invalid numeric argument.");
+    return 1;
+  }
+
+  try {
+    fs::create_directories(opts.out);
+    std::ofstream manifest(opts.out / "manifest.tsv");
+    manifest << "path\tbytes\tmix\tcorruption\n";
+
+    uint64_t total_bytes = 0;
+    for(uint64_t i = 0; i < opts.count; i++) {
+      // Every file gets its own stream, so a file's contents
+      // only depend on the seed and its index, not on what
+      // was generated before it.
+      Rng rng(opts.seed ^ (i * 0xD1B54A32D192ED03ULL));
+
+      const auto mix = opts.mix == Mix::Mixed
+        ? static_cast<Mix>(i % static_cast<uint64_t>(Mix::Mixed))
+        : opts.mix;
+
+      auto file = make_file(opts, rng, mix);
+      auto kind = Corruption::None;
+      if(rng.below(100) < opts.corrupt_pct) {
+        kind = static_cast<Corruption>(1 + rng.below(corruption_names.size() - 1));
+        corrupt(file, rng, kind);
+      }
+
+      const auto dir = opts.out / spng::fmt("{:04}", i / 1000);
+      if(i % 1000 == 0) {
+        fs::create_directories(dir);
+      }
+
+      const auto path = dir / spng::fmt("{:08}.png", i);
+      std::ofstream of(path, std::ios::binary | std::ios::trunc);
+      of.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+      if(!of.good()) {
+        std::println("Failed to write {}.", path.string());
+        return 1;
+      }
+
+      manifest << fs::relative(path, opts.out).generic_string() << '\t'
+        << file.size() << '\t'
+        << mix_names.at(static_cast<size_t>(mix)) << '\t'
+        << corruption_names.at(static_cast<size_t>(kind)) << '\n';
+      total_bytes += file.size();
+    }
+
+    std::println("Wrote {} files ({} bytes) to {}.", opts.count, total_bytes, opts.out.string());
+  } catch(const std::exception& e) {
+    std::println("Error :: {}", e.what());
+    return 1;
+  }
+
+  return 0;
+}